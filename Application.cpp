@@ -1,156 +1,563 @@
 #include <zconf.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
 #include "Application.h"
 #include "base/vulkan/VulkanShader.h"
+#include "base/log/Logger.h"
+#include "base/log/Profiler.h"
+
+namespace {
+    // Waits for a job counter on every way out of a scope. An exception the jobs left is dropped, the scope either
+    // waited on the counter itself already or is being left by an exception of its own.
+    struct JobCounterGuard {
+        vtr::JobSystem &jobSystem;
+        vtr::JobCounter &counter;
+
+        ~JobCounterGuard() {
+            try {
+                jobSystem.wait(&counter);
+            } catch (...) {
+            }
+        }
+    };
+}
 
-Application::Application() : windowManager(WIDTH, HEIGHT) {
+Application::Application(const BatchOptions &batch) : batch(batch) {
+    startup.stage("window", [this, &batch]() {
+        if (batch.frameCount > 0) {
+            for (uint32_t i = 0; i < batch.viewCount; i++) {
+                windowManagers.push_back(new HeadlessWindowManager(batch.width, batch.height));
+            }
+        } else {
+            windowManagers.push_back(new GLFWWindowManager(WIDTH, HEIGHT));
+        }
+    });
+
+    // Stages below that only need the device, or nothing Vulkan at all, run on job workers meanwhile. Their
+    // exceptions are rethrown once the main thread has caught up. The jobs reference this stack frame and write
+    // members, any stage throwing before that still waits for them on the way out.
+    vtr::JobCounter meshCounter;
+    vtr::JobCounter shaderCounter;
+    JobCounterGuard meshGuard{jobSystem, meshCounter};
+    JobCounterGuard shaderGuard{jobSystem, shaderCounter};
+
+    if (access(MESH_PATH, R_OK) == 0) {
+        jobSystem.run([this]() {
+            vtr::StartupTimeline::Scope stage(startup, "mesh load");
+            preloadedMesh = VulkanAssetStreamer::loadFile(MESH_PATH);
+        }, &meshCounter);
+    }
 
-    //Dont use a stack based VulkanHandler, copy constructor is problematic
-    vulkanHandler = new VulkanHandler(&windowManager);
-    device = vulkanHandler->device.logicalDevice;
+    // Shader modules and the driver pipeline cache are built while the swapchain is created.
+    auto deviceReady = [this, &shaderCounter](VulkanDevice &vulkanDevice) {
+        device = vulkanDevice.logicalDevice;
 
-    windowManager.setResizeCallback(this, (void *) Application::resizeCallback);
+        jobSystem.run([this, &vulkanDevice]() {
+            vtr::StartupTimeline::Scope stage(startup, "shaders");
+            loadShaders();
+            pipelineCache = new VulkanPipelineCache(vulkanDevice, PIPELINE_CACHE_PATH);
+        }, &shaderCounter);
+    };
+
+    //Dont use a stack based VulkanHandler, copy constructor is problematic
+    vulkanHandler = new VulkanHandler(windowManagers, batch.frameCount == 0, startup, deviceReady);
+
+    vulkanHandler->device.memoryTracker.setSoftBudget(MEMORY_SOFT_BUDGET);
+    vulkanHandler->device.memoryTracker.setDumpInterval(MEMORY_DUMP_INTERVAL);
+
+    windowManagers[0]->setResizeCallback(this, (void *) Application::resizeCallback);
+    windowManagers[0]->setKeyCallback((void *) Application::keyCallback);
+    windowExtent = windowManagers[0]->getWindowExtent();
+
+    views.resize(vulkanHandler->views.size());
+
+    startup.stage("gpu profiler", [this, &batch]() {
+        if (vtr::Profiler::instance().isEnabled() || (HUD_OVERLAY && batch.frameCount == 0)) {
+            gpuProfiler = new VulkanGpuProfiler(vulkanHandler->device, vulkanHandler->commandPool);
+        }
+    });
+    startup.stage("readback", [this]() { createReadback(); });
+    startup.stage("render graph", [this]() {
+        // Sampled as well, by the occlusion culler.
+        depthFormat = vtr::findSupportedFormat({VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM},
+                                               vulkanHandler->device.physicalDevice,
+                                               VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                               VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+
+        for (uint32_t view = 0; view < views.size(); view++) {
+            createRenderGraph(view);
+        }
+    });
+
+    jobSystem.wait(&shaderCounter);
+
+    startup.stage("particles", [this]() {
+        if (GPU_PARTICLES) {
+            particleSystem = new VulkanParticleSystem(vulkanHandler->device, PARTICLE_CAPACITY);
+        }
+    });
+    startup.stage("pipelines", [this]() { createGraphicsPipeline(); });
+    startup.stage("vertex buffers", [this]() { createVertexBuffers(); });
+
+    // A mesh that fails to load is not fatal, the placeholder is drawn instead.
+    try {
+        jobSystem.wait(&meshCounter);
+    } catch (const std::exception &exception) {
+        LOG_ERROR("Failed to stream %s: %s", MESH_PATH, exception.what());
+    }
 
-    loadShaders();
-    createGraphicsPipeline();
-    createVertexBuffers();
-    createCommandBuffers();
-    createSyncPrimitives();
+    startup.stage("scene", [this]() { createScene(); });
+    startup.stage("hud", [this]() { createHud(); });
+    startup.stage("instance buffers", [this]() { createInstanceBuffers(); });
+    startup.stage("occlusion culler", [this]() { createOcclusionCuller(); });
+    startup.stage("command buffers", [this]() {
+        for (uint32_t view = 0; view < views.size(); view++) {
+            createCommandBuffers(view);
+        }
+    });
+    startup.stage("sync primitives", [this]() { createSyncPrimitives(); });
+
+    constructed = vtr::StartupTimeline::Clock::now();
 }
 
 Application::~Application() {
     cleanup();
     delete vulkanHandler;
+
+    for (auto windowManager: windowManagers) {
+        delete windowManager;
+    }
 }
 
 void Application::mainLoop() {
-    while (!windowManager.shouldClose()) {
-        windowManager.pollEvents();
+    if (batch.frameCount > 0) {
+        batchLoop();
+        return;
+    }
+
+    renderRunning = true;
+    renderThread = std::thread(&Application::renderLoop, this);
+
+    // The main thread only pumps window events, GLFW requires that. Rendering never waits on it.
+    while (!windowManagers[0]->shouldClose() && renderRunning) {
+        PROFILE_ZONE("wait events");
+        windowManagers[0]->waitEvents();
+    }
+
+    closeRequested.store(true, std::memory_order_release);
+
+    renderThread.join();
+
+    if (renderException) {
+        std::rethrow_exception(renderException);
+    }
+}
+
+void Application::renderLoop() {
+    vtr::Profiler::instance().setThreadName("render");
+
+    try {
+        while (processEvents()) {
+            draw();
+        }
+
+        vkDeviceWaitIdle(device);
+        logDrawStats();
+    } catch (...) {
+        renderException = std::current_exception();
+    }
+
+    renderRunning = false;
+    windowManagers[0]->postEmptyEvent();
+}
+
+void Application::batchLoop() {
+    // No window events to pump, frames are rendered on the calling thread. The GPU works on the frames in
+    // flight while readback hands the oldest finished one to the writer thread.
+    auto start = std::chrono::steady_clock::now();
+
+    while (frameNumber < batch.frameCount) {
         draw();
     }
+
+    // The last frames in flight still have to be read back.
+    vkDeviceWaitIdle(device);
+    readback->update();
+    frameWriter->finish();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    vtr::FrameWriterStats stats = frameWriter->getStats();
+
+    LOG_INFO("Rendered %u frames in %.2f s, %.1f frames/s", batch.frameCount, seconds, batch.frameCount / seconds);
+    LOG_INFO("Wrote %llu frames, %.1f MB to %s, %.2f s waiting on the disk, writer idle for %.2f s",
+             (unsigned long long) stats.frames, stats.bytes / (1024.0 * 1024.0), batch.outputPath.c_str(),
+             stats.producerStallSeconds, stats.writerIdleSeconds);
+
+    vulkanHandler->device.memoryTracker.dump();
+    logDrawStats();
 }
 
-void Application::createGraphicsPipeline() {
+bool Application::processEvents() {
+    PROFILE_ZONE("process events");
 
-    VkPipelineShaderStageCreateInfo vertexStageCreateInfo = {};
-    vertexStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertexStageCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertexStageCreateInfo.pName = "main";
-    vertexStageCreateInfo.module = vertShaderModule;
-
-    VkPipelineShaderStageCreateInfo fragShaderCreateInfo = {};
-    fragShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragShaderCreateInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderCreateInfo.pName = "main";
-    fragShaderCreateInfo.module = fragShaderModule;
-
-    VkPipelineShaderStageCreateInfo shaderStages[] = {vertexStageCreateInfo, fragShaderCreateInfo};
-
-    VkVertexInputBindingDescription bindingDescription = {};
-    bindingDescription.binding = 0;
-    bindingDescription.stride = sizeof(glm::vec3);
-    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-    VkVertexInputAttributeDescription attributeDescription = {};
-    attributeDescription.format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescription.binding = 0;
-    attributeDescription.location = 0;
-    attributeDescription.offset = 0;
-
-    VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo = {};
-    vertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputStateCreateInfo.vertexBindingDescriptionCount = 1;
-    vertexInputStateCreateInfo.pVertexBindingDescriptions = &bindingDescription;
-    vertexInputStateCreateInfo.vertexAttributeDescriptionCount = 1;
-    vertexInputStateCreateInfo.pVertexAttributeDescriptions = &attributeDescription;
-
-    VkPipelineInputAssemblyStateCreateInfo assemblyStateCreateInfo = {};
-    assemblyStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    assemblyStateCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    assemblyStateCreateInfo.primitiveRestartEnable = VK_FALSE;
+    // Only the latest extent matters, any in between was never presented at.
+    if (resizeChanged.exchange(false, std::memory_order_acq_rel)) {
+        uint64_t extent = resizeExtent.load(std::memory_order_acquire);
+        windowExtent = {static_cast<uint32_t>(extent >> 32), static_cast<uint32_t>(extent)};
+        framebufferResized = true;
+    }
 
-    VkViewport viewport = {};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = vulkanHandler->windowExtent.width;
-    viewport.height = vulkanHandler->windowExtent.height;
-    viewport.maxDepth = 1.0f;
-    viewport.minDepth = 0.0f;
+    WindowEvent event = {};
 
-    VkRect2D scissor = {};
-    scissor.offset = {0, 0};
-    scissor.extent = vulkanHandler->windowExtent;
-
-    VkPipelineViewportStateCreateInfo viewportStateCreateInfo = {};
-    viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportStateCreateInfo.scissorCount = 1;
-    viewportStateCreateInfo.pScissors = &scissor;
-    viewportStateCreateInfo.viewportCount = 1;
-    viewportStateCreateInfo.pViewports = &viewport;
-
-    VkPipelineRasterizationStateCreateInfo rasterizationStateCreateInfo = {};
-    rasterizationStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizationStateCreateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterizationStateCreateInfo.lineWidth = 1.0f;
-    rasterizationStateCreateInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-    rasterizationStateCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizationStateCreateInfo.rasterizerDiscardEnable = VK_FALSE;
-    rasterizationStateCreateInfo.depthBiasEnable = VK_FALSE;
-
-    VkPipelineDepthStencilStateCreateInfo depthStencil = {};
-    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    depthStencil.depthTestEnable = VK_TRUE;
-    depthStencil.depthWriteEnable = VK_TRUE;
-    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
-    depthStencil.depthBoundsTestEnable = VK_FALSE;
-    depthStencil.stencilTestEnable = VK_FALSE;
-
-    VkPipelineMultisampleStateCreateInfo multisampling = {};
-    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_FALSE;
-    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-
-    VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-    colorBlendAttachment.colorWriteMask =
-            VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE;
-
-    VkPipelineColorBlendStateCreateInfo colorBlending = {};
-    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlending.logicOpEnable = VK_FALSE;
-    colorBlending.logicOp = VK_LOGIC_OP_COPY;
-    colorBlending.attachmentCount = 1;
-    colorBlending.pAttachments = &colorBlendAttachment;
-    colorBlending.blendConstants[0] = 0.0f;
-    colorBlending.blendConstants[1] = 0.0f;
-    colorBlending.blendConstants[2] = 0.0f;
-    colorBlending.blendConstants[3] = 0.0f;
+    while (events.pop(event)) {
+        switch (event.type) {
+            case WindowEventType::Key:
+                LOG_VERBOSE("key %d action %d", event.key, event.action);
+
+                if (event.key == GLFW_KEY_F12 && event.action == GLFW_PRESS) {
+                    captureRequested = true;
+                }
+
+                if (event.key == GLFW_KEY_F3 && event.action == GLFW_PRESS) {
+                    hudVisible = !hudVisible;
+                }
+                break;
+        }
+    }
+
+    return !closeRequested.load(std::memory_order_acquire);
+}
+
+void Application::pushEvent(const WindowEvent &event) {
+    if (!events.push(event)) {
+        LOG_WARNING("render thread event queue is full, dropping input event");
+    }
+}
+
+void Application::createReadback() {
+    const VulkanView &primaryView = vulkanHandler->views[0];
+
+    if (!primaryView.swapChain.transferSource) {
+        if (batch.frameCount > 0) {
+            throw std::runtime_error("batch mode needs swapchain images that can be copied from!");
+        }
+
+        LOG_WARNING("Swapchain images can not be copied from, screenshots are disabled");
+        return;
+    }
+
+    VulkanReadback::Consumer consumer = Application::writeScreenshot;
+
+    if (batch.frameCount > 0) {
+        auto framesPerSecond = static_cast<uint32_t>(1.0 / batch.timestep + 0.5);
+        frameWriter = new vtr::FrameWriter(batch.outputPath, primaryView.windowExtent.width,
+                                           primaryView.windowExtent.height, framesPerSecond, WRITER_QUEUE_DEPTH);
+
+        consumer = [this](const ReadbackFrame &frame) {
+            frameWriter->push(frame.pixels, frame.format == VK_FORMAT_B8G8R8A8_UNORM ||
+                                            frame.format == VK_FORMAT_B8G8R8A8_SRGB);
+        };
+    }
+
+    // One slot more than frames in flight, so a capture is never refused while the oldest one is consumed.
+    readback = new VulkanReadback(vulkanHandler->device, MAX_FRAMES_IN_FLIGHT + 1, consumer);
+}
+
+void Application::writeScreenshot(const ReadbackFrame &frame) {
+    bool bgra = frame.format == VK_FORMAT_B8G8R8A8_UNORM || frame.format == VK_FORMAT_B8G8R8A8_SRGB;
+
+    if (VulkanReadback::texelSize(frame.format) != 4) {
+        LOG_WARNING("Screenshots of format %d are not supported", frame.format);
+        return;
+    }
+
+    std::string path = "screenshot_" + std::to_string(frame.frameNumber) + ".ppm";
+    FILE *file = fopen(path.c_str(), "wb");
+
+    if (file == nullptr) {
+        LOG_ERROR("Failed to open %s", path.c_str());
+        return;
+    }
+
+    fprintf(file, "P6\n%u %u\n255\n", frame.width, frame.height);
+
+    std::vector<uint8_t> row(frame.width * 3);
+    for (uint32_t y = 0; y < frame.height; y++) {
+        const uint8_t *texel = frame.pixels + size_t(y) * frame.width * 4;
+
+        for (uint32_t x = 0; x < frame.width; x++, texel += 4) {
+            row[x * 3 + 0] = bgra ? texel[2] : texel[0];
+            row[x * 3 + 1] = texel[1];
+            row[x * 3 + 2] = bgra ? texel[0] : texel[2];
+        }
+
+        fwrite(row.data(), 1, row.size(), file);
+    }
+
+    fclose(file);
+
+    LOG_INFO("Saved %s", path.c_str());
+}
+
+void Application::createRenderGraph(uint32_t view) {
+    ViewState &state = views[view];
+    const VulkanSwapChain &swapChain = vulkanHandler->views[view].swapChain;
+
+    if (state.renderGraph == nullptr) {
+        state.renderGraph = new VulkanRenderGraph(vulkanHandler->device);
+        state.renderGraph->setGpuProfiler(gpuProfiler);
+    }
+
+    VulkanRenderGraph *renderGraph = state.renderGraph;
+    renderGraph->reset();
+
+    VkExtent2D extent = vulkanHandler->views[view].windowExtent;
+    state.backbuffer = renderGraph->importImage("backbuffer", swapChain.format, extent,
+                                                VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    state.depthBuffer = renderGraph->createImage("depth", {depthFormat, extent, 0});
+
+    VkClearValue clearValue = {0.0f, 0.0f, 0.0f};
+    VkClearValue depthClearValue = {};
+    depthClearValue.depthStencil = {1.0f, 0};
+
+    bool culled = OCCLUSION_CULLING && view == 0;
+
+    if (!culled) {
+        state.scenePass = renderGraph->addPass("scene", [this, view](VkCommandBuffer commandBuffer) {
+            drawScene(views[view], commandBuffer, ScenePhase::Direct);
+        });
+
+        renderGraph->addColorAttachment(state.scenePass, state.backbuffer, VK_ATTACHMENT_LOAD_OP_CLEAR, clearValue);
+        renderGraph->addDepthAttachment(state.scenePass, state.depthBuffer, VK_ATTACHMENT_LOAD_OP_CLEAR,
+                                        depthClearValue);
+    } else {
+        // Last frame's visible set is drawn first, its depth reduced to a pyramid and everything else tested
+        // against that. The culler owns the buffers, importing them lets the graph place the barriers.
+        RenderGraphResource instances = renderGraph->importBuffer("occlusion instances");
+        RenderGraphResource commands = renderGraph->importBuffer("occlusion commands");
+
+        for (ScenePhase phase: {ScenePhase::Early, ScenePhase::Late}) {
+            bool late = phase == ScenePhase::Late;
+
+            RenderGraphPass cullPass = renderGraph->addPass(late ? "late cull" : "early cull",
+                                                            [this, late](VkCommandBuffer commandBuffer) {
+                occlusionCuller->recordCull(commandBuffer, late, viewProjection);
+            });
+
+            renderGraph->write(cullPass, instances, RenderGraphUsage::Storage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+            renderGraph->read(cullPass, commands, RenderGraphUsage::Storage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+            renderGraph->write(cullPass, commands, RenderGraphUsage::Storage, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+            RenderGraphPass scenePass = renderGraph->addPass(late ? "late scene" : "early scene",
+                                                             [this, phase](VkCommandBuffer commandBuffer) {
+                drawScene(views[0], commandBuffer, phase);
+            });
+
+            VkAttachmentLoadOp loadOp = late ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+            renderGraph->addColorAttachment(scenePass, state.backbuffer, loadOp, clearValue);
+            renderGraph->addDepthAttachment(scenePass, state.depthBuffer, loadOp, depthClearValue);
+            renderGraph->read(scenePass, instances, RenderGraphUsage::VertexBuffer);
+            renderGraph->read(scenePass, commands, RenderGraphUsage::IndirectBuffer);
+
+            if (late) {
+                continue;
+            }
+
+            state.scenePass = scenePass;
+
+            // Synchronizes with the late cull itself, only the depth read is up to the graph.
+            RenderGraphPass pyramidPass = renderGraph->addPass("depth pyramid", [this](VkCommandBuffer commandBuffer) {
+                occlusionCuller->recordPyramid(commandBuffer);
+            });
+
+            renderGraph->read(pyramidPass, state.depthBuffer, RenderGraphUsage::DepthRead,
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+            renderGraph->setSideEffects(pyramidPass);
+        }
+    }
+
+    // Depth tested against the scene without writing it, the graphics submit waits for the simulation.
+    if (GPU_PARTICLES) {
+        state.particlePass = renderGraph->addPass("particles", [this, view](VkCommandBuffer commandBuffer) {
+            drawParticles(views[view], commandBuffer);
+        });
+
+        renderGraph->addColorAttachment(state.particlePass, state.backbuffer, VK_ATTACHMENT_LOAD_OP_LOAD,
+                                        clearValue);
+        renderGraph->addDepthAttachment(state.particlePass, state.depthBuffer, VK_ATTACHMENT_LOAD_OP_LOAD,
+                                        depthClearValue);
+    }
+
+    // Blended over everything else, the pass records nothing while the HUD is hidden.
+    if (HUD_OVERLAY && batch.frameCount == 0 && view == 0) {
+        state.hudPass = renderGraph->addPass("hud", [this, view](VkCommandBuffer commandBuffer) {
+            drawHud(views[view], commandBuffer);
+        });
+
+        renderGraph->addColorAttachment(state.hudPass, state.backbuffer, VK_ATTACHMENT_LOAD_OP_LOAD, clearValue);
+    }
+
+    // Only the primary view is ever captured.
+    if (readback != nullptr && view == 0) {
+        RenderGraphPass readbackPass = renderGraph->addPass("readback", [this](VkCommandBuffer commandBuffer) {
+            if (capturing) {
+                readback->recordCopy(commandBuffer, vulkanHandler->views[0].swapChain.images[views[0].imageIndex]);
+            }
+        });
+
+        renderGraph->read(readbackPass, state.backbuffer, RenderGraphUsage::TransferSource);
+        renderGraph->setSideEffects(readbackPass);
+    }
+
+    renderGraph->compile();
+
+    // Created after the first graph, createOcclusionCuller() sets the first target.
+    if (culled && occlusionCuller != nullptr) {
+        occlusionCuller->setDepthTarget(renderGraph->getImageView(state.depthBuffer), extent);
+    }
+}
+
+void Application::createGraphicsPipeline() {
     VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutInfo.setLayoutCount = 0;
-    pipelineLayoutInfo.pushConstantRangeCount = 0;
+
+    // Position dequantization, offset and scale.
+    VkPushConstantRange pushConstantRange = {};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(glm::vec4) * 2;
+
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
     VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout))
 
-    VkGraphicsPipelineCreateInfo pipelineInfo = {};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
-    pipelineInfo.pStages = shaderStages;
-    pipelineInfo.pVertexInputState = &vertexInputStateCreateInfo;
-    pipelineInfo.pInputAssemblyState = &assemblyStateCreateInfo;
-    pipelineInfo.pViewportState = &viewportStateCreateInfo;
-    pipelineInfo.pRasterizationState = &rasterizationStateCreateInfo;
-    pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.layout = pipelineLayout;
-    pipelineInfo.renderPass = vulkanHandler->renderPass;
-    pipelineInfo.subpass = 0;
-    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    VkVertexInputBindingDescription bindingDescriptions[2] = {};
+    bindingDescriptions[0].binding = 0;
+    bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-    VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline))
+    bindingDescriptions[1].binding = 1;
+    bindingDescriptions[1].stride = sizeof(glm::mat4);
+    bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+    VkVertexInputAttributeDescription attributeDescriptions[7] = {};
+
+    // The world matrix takes one location per column.
+    for (uint32_t column = 0; column < 4; column++) {
+        attributeDescriptions[column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+        attributeDescriptions[column].binding = 1;
+        attributeDescriptions[column].location = 1 + column;
+        attributeDescriptions[column].offset = sizeof(glm::vec4) * column;
+    }
+
+    // One pipeline per mesh vertex format, they only differ in vertex input and vertex shader. Views with the
+    // same swapchain format end up with equal descriptions and share the pipelines.
+    for (uint32_t format = 0; format < vtr::MESH_VERTEX_FORMAT_COUNT; format++) {
+        bindingDescriptions[0].stride = vtr::meshVertexStride(format);
+        uint32_t attributeCount = 4 + vertexAttributes(format, attributeDescriptions + 4);
+
+        for (uint32_t view = 0; view < views.size(); view++) {
+            GraphicsPipelineDesc &desc = views[view].scenePipelines[format];
+
+            desc.vertexShader = vertShaderModules[format];
+            desc.fragmentShader = fragShaderModule;
+            desc.vertexBindings.assign(bindingDescriptions, bindingDescriptions + 2);
+            desc.vertexAttributes.assign(attributeDescriptions, attributeDescriptions + attributeCount);
+            desc.depthTest = true;
+            desc.depthWrite = true;
+            desc.colorFormats = {vulkanHandler->views[view].swapChain.format};
+            desc.depthFormat = depthFormat;
+            desc.layout = pipelineLayout;
+            desc.renderPass = views[view].renderGraph->getRenderPass(views[view].scenePass);
+
+            // Compiles start now in the background, batch runs need every frame drawn so they wait for them.
+            if (batch.frameCount > 0) {
+                pipelineCache->getPipelineBlocking(desc);
+            } else {
+                pipelineCache->getPipeline(desc);
+            }
+        }
+    }
+
+    if (particleSystem == nullptr) {
+        return;
+    }
+
+    // Quads are expanded from the particle buffer, so there is no vertex input. Both sides face the camera.
+    for (uint32_t view = 0; view < views.size(); view++) {
+        GraphicsPipelineDesc &desc = views[view].particlePipeline;
+
+        desc.vertexShader = particleSystem->getVertexShader();
+        desc.fragmentShader = particleSystem->getFragmentShader();
+        desc.cullMode = VK_CULL_MODE_NONE;
+        desc.depthTest = true;
+        desc.depthWrite = false;
+        desc.blendEnable = true;
+        desc.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        desc.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        desc.colorFormats = {vulkanHandler->views[view].swapChain.format};
+        desc.depthFormat = depthFormat;
+        desc.layout = particleSystem->getDrawLayout();
+        desc.renderPass = views[view].renderGraph->getRenderPass(views[view].particlePass);
+
+        if (batch.frameCount > 0) {
+            pipelineCache->getPipelineBlocking(desc);
+        } else {
+            pipelineCache->getPipeline(desc);
+        }
+    }
 }
 
-void Application::createCommandBuffers() {
-    commandBuffers.resize(vulkanHandler->swapChain.imageCount);
+uint32_t Application::vertexAttributes(uint32_t vertexFormat, VkVertexInputAttributeDescription *attributes) {
+    // Location 0 is the position, 1 to 4 the world matrix, 5 the normal and 6 the uv.
+    VkFormat formats[3];
+    uint32_t offsets[3];
+    uint32_t count;
+
+    switch (vertexFormat) {
+        case vtr::MESH_VERTEX_STANDARD_F32:
+            formats[0] = VK_FORMAT_R32G32B32_SFLOAT;
+            formats[1] = VK_FORMAT_R32G32B32_SFLOAT;
+            formats[2] = VK_FORMAT_R32G32_SFLOAT;
+            offsets[0] = offsetof(vtr::MeshVertexStandard, position);
+            offsets[1] = offsetof(vtr::MeshVertexStandard, normal);
+            offsets[2] = offsetof(vtr::MeshVertexStandard, uv);
+            count = 3;
+            break;
+        case vtr::MESH_VERTEX_QUANTIZED:
+            formats[0] = VK_FORMAT_R16G16B16A16_UNORM;
+            formats[1] = VK_FORMAT_R16G16_SNORM;
+            formats[2] = VK_FORMAT_R16G16_SFLOAT;
+            offsets[0] = offsetof(vtr::MeshVertexQuantized, position);
+            offsets[1] = offsetof(vtr::MeshVertexQuantized, normal);
+            offsets[2] = offsetof(vtr::MeshVertexQuantized, uv);
+            count = 3;
+            break;
+        default:
+            formats[0] = VK_FORMAT_R32G32B32_SFLOAT;
+            offsets[0] = 0;
+            count = 1;
+            break;
+    }
+
+    const uint32_t locations[] = {0, 5, 6};
+    for (uint32_t i = 0; i < count; i++) {
+        attributes[i] = {};
+        attributes[i].location = locations[i];
+        attributes[i].binding = 0;
+        attributes[i].format = formats[i];
+        attributes[i].offset = offsets[i];
+    }
+
+    return count;
+}
+
+void Application::createCommandBuffers(uint32_t view) {
+    std::vector<VkCommandBuffer> &commandBuffers = views[view].commandBuffers;
+    commandBuffers.resize(vulkanHandler->views[view].swapChain.imageCount);
 
     VkCommandBufferAllocateInfo allocateInfo = {};
     allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -159,145 +566,755 @@ void Application::createCommandBuffers() {
     allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
 
     VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &allocateInfo, commandBuffers.data()))
+}
 
-    for (uint32_t i = 0; i < commandBuffers.size(); i++) {
-        VkCommandBufferBeginInfo beginInfo = {};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+void Application::recordCommandBuffer(uint32_t view) {
+    PROFILE_ZONE("record view");
 
-        VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffers[i], &beginInfo))
+    const ViewState &state = views[view];
+    const VulkanSwapChain &swapChain = vulkanHandler->views[view].swapChain;
+    VkCommandBuffer commandBuffer = state.commandBuffers[state.imageIndex];
 
-        VkRenderPassBeginInfo renderPassBeginInfo = {};
-        renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassBeginInfo.renderPass = vulkanHandler->renderPass;
-        renderPassBeginInfo.framebuffer = vulkanHandler->framebuffers[i];
-        renderPassBeginInfo.renderArea.extent = vulkanHandler->windowExtent;
-        renderPassBeginInfo.renderArea.offset = {0, 0};
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-        VkClearValue clearValue = {0.0f, 0.0f, 0.0f};
-        renderPassBeginInfo.clearValueCount = 1;
-        renderPassBeginInfo.pClearValues = &clearValue;
+    VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &beginInfo))
 
-        vkCmdBeginRenderPass(commandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-        vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+    state.renderGraph->bindImage(state.backbuffer, swapChain.images[state.imageIndex],
+                                 swapChain.imageViews[state.imageIndex]);
+    state.renderGraph->execute(commandBuffer);
 
-        VkBuffer buffers[] = {vertexBuffer};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, buffers, offsets);
-        vkCmdDraw(commandBuffers[i], vertices.size(), 1, 0, 0);
-        vkCmdEndRenderPass(commandBuffers[i]);
+    VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer))
+}
 
-        VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffers[i]))
+void Application::buildDrawList(const StreamedMesh &mesh) {
+    PROFILE_ZONE("draw list");
+
+    drawList.clear();
+    sceneDraws.clear();
+
+    // There are no materials yet, and the instances of one draw are not depth sorted among each other. Levels of
+    // detail go in the depth field, so the draws of one mesh stay next to each other.
+    uint32_t meshIndex = &mesh == &placeholderMesh ? 0 : sceneMesh + 1;
+    uint32_t firstInstance = 0;
+
+    for (uint32_t lod = 0; lod < mesh.lodCount; lod++) {
+        uint32_t instanceCount = lodInstanceCounts[lod];
+        if (instanceCount == 0) {
+            continue;
+        }
+
+        drawList.add(vtr::DrawKey::pack(0, mesh.vertexFormat, 0, meshIndex, lod),
+                     static_cast<uint32_t>(sceneDraws.size()));
+        sceneDraws.push_back({&mesh, lod, firstInstance, instanceCount});
+        firstInstance += instanceCount;
+    }
+
+    drawList.sort();
+}
+
+void Application::drawScene(const ViewState &view, VkCommandBuffer commandBuffer, ScenePhase phase) {
+    if (drawList.size() == 0) {
+        return;
+    }
+
+    VkExtent2D extent = view.renderGraph->getExtent(view.scenePass);
+
+    // Occlusion culled phases draw indirectly, with the culler's instances.
+    VkBuffer instanceBuffer = instanceBuffers[currentFrame];
+    VkDeviceSize instanceOffset = 0;
+    if (phase != ScenePhase::Direct) {
+        instanceBuffer = occlusionCuller->getInstanceBuffer();
+        instanceOffset = occlusionCuller->getInstanceOffset(phase == ScenePhase::Late);
+    }
+
+    setViewport(commandBuffer, extent);
+
+    // Draws come sorted by state, so a bind is only needed where the state changes between neighbours.
+    vtr::DrawListStats stats = {};
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    const StreamedMesh *boundMesh = nullptr;
+
+    for (const vtr::DrawPacket &packet: drawList) {
+        const SceneDraw &draw = sceneDraws[packet.index];
+        const StreamedMesh &mesh = *draw.mesh;
+
+        // Still compiling, the draw is skipped.
+        VkPipeline pipeline = pipelineCache->getPipeline(view.scenePipelines[mesh.vertexFormat]);
+        if (pipeline == VK_NULL_HANDLE) {
+            continue;
+        }
+
+        if (pipeline != boundPipeline) {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            boundPipeline = pipeline;
+            stats.pipelineBinds++;
+        } else {
+            stats.pipelineBindsAvoided++;
+        }
+
+        // Push constants survive pipeline binds, every scene pipeline shares the layout.
+        if (&mesh != boundMesh) {
+            glm::vec4 dequantization[] = {mesh.positionOffset, mesh.positionScale};
+            vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(dequantization),
+                               dequantization);
+
+            VkBuffer buffers[] = {mesh.vertexBuffer, instanceBuffer};
+            VkDeviceSize offsets[] = {0, instanceOffset};
+            vkCmdBindVertexBuffers(commandBuffer, 0, 2, buffers, offsets);
+            vkCmdBindIndexBuffer(commandBuffer, mesh.indexBuffer, 0, mesh.indexType);
+
+            boundMesh = &mesh;
+            stats.meshBinds++;
+        } else {
+            stats.meshBindsAvoided++;
+        }
+
+        const vtr::MeshLod &lod = mesh.lods[draw.lod];
+        if (phase == ScenePhase::Direct) {
+            vkCmdDrawIndexed(commandBuffer, lod.indexCount, draw.instanceCount, lod.indexOffset, 0,
+                             draw.firstInstance);
+        } else {
+            vkCmdDrawIndexedIndirect(commandBuffer, occlusionCuller->getIndirectBuffer(),
+                                     occlusionCuller->getIndirectOffset(phase == ScenePhase::Late, draw.lod), 1,
+                                     sizeof(VkDrawIndexedIndirectCommand));
+        }
+        stats.draws++;
+    }
+
+    drawStats += stats;
+}
+
+void Application::drawParticles(const ViewState &view, VkCommandBuffer commandBuffer) {
+    if (particleSystem == nullptr) {
+        return;
+    }
+
+    // Still compiling, the particles are skipped.
+    VkPipeline pipeline = pipelineCache->getPipeline(view.particlePipeline);
+    if (pipeline == VK_NULL_HANDLE) {
+        return;
+    }
+
+    setViewport(commandBuffer, view.renderGraph->getExtent(view.particlePass));
+    particleSystem->recordDraw(commandBuffer, pipeline, viewProjection);
+}
+
+void Application::createHud() {
+    if (!HUD_OVERLAY || batch.frameCount > 0) {
+        return;
+    }
+
+    SamplerState samplerState;
+    samplerState.magFilter = VK_FILTER_NEAREST;
+    samplerState.minFilter = VK_FILTER_NEAREST;
+    samplerState.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerState.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerState.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerState.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+    hud = new VulkanHud(vulkanHandler->device, vulkanHandler->commandPool, samplerCache->getSampler(samplerState));
+
+    GraphicsPipelineDesc &desc = views[0].hudPipeline;
+
+    desc.vertexShader = hud->getVertexShader();
+    desc.fragmentShader = hud->getFragmentShader();
+    desc.vertexBindings = {VulkanHud::getVertexBinding()};
+    desc.vertexAttributes = VulkanHud::getVertexAttributes();
+    desc.cullMode = VK_CULL_MODE_NONE;
+    desc.blendEnable = true;
+    desc.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    desc.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    desc.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    desc.colorFormats = {vulkanHandler->views[0].swapChain.format};
+    desc.layout = hud->getDrawLayout();
+    desc.renderPass = views[0].renderGraph->getRenderPass(views[0].hudPass);
+
+    pipelineCache->getPipeline(desc);
+
+    hudRefreshTime = std::chrono::steady_clock::now();
+}
+
+void Application::buildHud(double deltaSeconds) {
+    if (hud == nullptr) {
+        return;
+    }
+
+    PROFILE_ZONE("hud");
+    auto start = std::chrono::steady_clock::now();
+
+    // The GPU time is that of the frame last read back, MAX_FRAMES_IN_FLIGHT frames behind.
+    auto cpuMilliseconds = static_cast<float>(deltaSeconds * 1000.0);
+    auto gpuMilliseconds = gpuProfiler != nullptr ? static_cast<float>(gpuProfiler->getFrameMilliseconds()) : 0.0f;
+
+    hudCpuHistory[hudHistoryIndex] = cpuMilliseconds;
+    hudGpuHistory[hudHistoryIndex] = gpuMilliseconds;
+    hudHistoryIndex = (hudHistoryIndex + 1) % HUD_HISTORY;
+
+    hudFrames++;
+    hudCpuSum += cpuMilliseconds;
+    hudGpuSum += gpuMilliseconds;
+
+    double sinceRefresh = std::chrono::duration<double>(start - hudRefreshTime).count();
+
+    if (sinceRefresh >= HUD_REFRESH_INTERVAL) {
+        MemoryStats memoryStats = vulkanHandler->device.memoryTracker.getStats();
+        VkDeviceSize memoryUsage = 0;
+        VkDeviceSize memoryBudget = 0;
+
+        for (const MemoryHeapStats &heap: memoryStats.heaps) {
+            if (heap.deviceLocal) {
+                memoryUsage += heap.usage;
+                memoryBudget += heap.budget;
+            }
+        }
+
+        // Draw stats are summed over every recorded scene pass, shown per frame.
+        double frames = hudFrames;
+        char text[512];
+        int length = snprintf(text, sizeof(text),
+                              "%.0f fps  cpu %.2f ms  gpu %.2f ms\n"
+                              "%.0f draws  %.0f pipeline binds  %.0f mesh binds\n"
+                              "device memory %.0f / %.0f MB\n"
+                              "hud %.3f ms, F3 hides",
+                              frames / sinceRefresh, hudCpuSum / frames, hudGpuSum / frames,
+                              (drawStats.draws - hudDrawStats.draws) / frames,
+                              (drawStats.pipelineBinds - hudDrawStats.pipelineBinds) / frames,
+                              (drawStats.meshBinds - hudDrawStats.meshBinds) / frames,
+                              memoryUsage / (1024.0 * 1024.0), memoryBudget / (1024.0 * 1024.0), hudBuildMilliseconds);
+
+        if (particleSystem != nullptr && length > 0 && length < static_cast<int>(sizeof(text))) {
+            snprintf(text + length, sizeof(text) - length, "\n%u particles", particleSystem->getAliveCount());
+        }
+
+        hudText = text;
+        hudTextColumns = 0;
+
+        for (size_t begin = 0; begin < hudText.size();) {
+            size_t end = std::min(hudText.find('\n', begin), hudText.size());
+            hudTextColumns = std::max(hudTextColumns, static_cast<uint32_t>(end - begin));
+            begin = end + 1;
+        }
+
+        hudRefreshTime = start;
+        hudFrames = 0;
+        hudCpuSum = 0.0;
+        hudGpuSum = 0.0;
+        hudDrawStats = drawStats;
+    }
+
+    if (!hudVisible) {
+        return;
+    }
+
+    // Panel, text, then a graph each for CPU and GPU time. Quads are drawn in the order they are added.
+    const float margin = 8.0f;
+    const float padding = 6.0f;
+    const float graphWidth = 2.0f * HUD_HISTORY;
+    const float graphHeight = 40.0f;
+    // Graphs top out at two 60 Hz frames, a line marks one.
+    const float graphMax = 1000.0f / 30.0f;
+
+    float glyphWidth = VulkanHud::GLYPH_WIDTH * HUD_TEXT_SCALE;
+    float lineHeight = VulkanHud::GLYPH_HEIGHT * HUD_TEXT_SCALE;
+    float labelWidth = 4 * glyphWidth;
+    float textHeight = lineHeight * static_cast<float>(std::count(hudText.begin(), hudText.end(), '\n') + 1);
+
+    float panelWidth = std::max(hudTextColumns * glyphWidth, labelWidth + graphWidth) + 2 * padding;
+    float panelHeight = textHeight + 2 * graphHeight + 4 * padding;
+
+    hud->beginFrame(static_cast<uint32_t>(currentFrame));
+    hud->addRect(margin, margin, panelWidth, panelHeight, 0xB0000000);
+    hud->addText(margin + padding, margin + padding, hudText.c_str(), 0xFFFFFFFF, HUD_TEXT_SCALE);
+
+    const char *labels[] = {"cpu", "gpu"};
+    const float *histories[] = {hudCpuHistory, hudGpuHistory};
+    const uint32_t colors[] = {0xFF40FF40, 0xFF30A0FF};
+
+    float x = margin + padding;
+    float y = margin + 2 * padding + textHeight;
+
+    for (uint32_t i = 0; i < 2; i++) {
+        hud->addText(x, y + (graphHeight - lineHeight) * 0.5f, labels[i], colors[i], HUD_TEXT_SCALE);
+        hud->addGraph(x + labelWidth, y, graphWidth, graphHeight, histories[i], HUD_HISTORY, hudHistoryIndex,
+                      graphMax, colors[i]);
+        hud->addRect(x + labelWidth, y + graphHeight * 0.5f, graphWidth, 1.0f, 0x80FFFFFF);
+        y += graphHeight + padding;
+    }
+
+    hudBuildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Application::drawHud(const ViewState &view, VkCommandBuffer commandBuffer) {
+    if (hud == nullptr || !hudVisible) {
+        return;
+    }
+
+    VkPipeline pipeline = pipelineCache->getPipeline(view.hudPipeline);
+    if (pipeline == VK_NULL_HANDLE) {
+        return;
+    }
+
+    VkExtent2D extent = view.renderGraph->getExtent(view.hudPass);
+    setViewport(commandBuffer, extent);
+    hud->recordDraw(commandBuffer, pipeline, extent);
+}
+
+void Application::setViewport(VkCommandBuffer commandBuffer, VkExtent2D extent) {
+    VkViewport viewport = {};
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.maxDepth = 1.0f;
+
+    VkRect2D scissor = {};
+    scissor.extent = extent;
+
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+void Application::logDrawStats() {
+    LOG_INFO("Recorded %llu draws, %llu pipeline binds (%llu avoided), %llu mesh binds (%llu avoided)",
+             (unsigned long long) drawStats.draws, (unsigned long long) drawStats.pipelineBinds,
+             (unsigned long long) drawStats.pipelineBindsAvoided, (unsigned long long) drawStats.meshBinds,
+             (unsigned long long) drawStats.meshBindsAvoided);
+
+    if (occlusionCuller != nullptr) {
+        LOG_INFO("Occlusion tested %llu objects, culled %llu (%.1f%%)", (unsigned long long) occlusionTested,
+                 (unsigned long long) occlusionCulled,
+                 occlusionTested > 0 ? 100.0 * occlusionCulled / occlusionTested : 0.0);
+    }
+
+    const SubmitStats &submitStats = vulkanHandler->device.submitScheduler.getStats();
+    LOG_INFO("Submitted %llu command buffers in %llu batches and %llu vkQueueSubmit calls, %.2f calls per frame",
+             (unsigned long long) submitStats.commandBuffers, (unsigned long long) submitStats.batches,
+             (unsigned long long) submitStats.submits,
+             submitStats.flushes > 0 ? static_cast<double>(submitStats.submits) / submitStats.flushes : 0.0);
+
+    if (particleSystem != nullptr) {
+        LOG_INFO("Particles: %u of %u alive, simulated on the %s queue", particleSystem->getAliveCount(),
+                 particleSystem->getCapacity(), vulkanHandler->device.asyncCompute ? "async compute" : "graphics");
+    }
+
+    uint64_t instanceTotal = 0;
+    for (uint64_t count: lodInstanceTotals) {
+        instanceTotal += count;
+    }
+
+    for (uint32_t lod = 0; lod < vtr::MESH_MAX_LODS && instanceTotal > 0; lod++) {
+        if (lodInstanceTotals[lod] > 0) {
+            LOG_INFO("LOD %u drew %llu instances (%.1f%%)", lod, (unsigned long long) lodInstanceTotals[lod],
+                     100.0 * lodInstanceTotals[lod] / instanceTotal);
+        }
     }
 }
 
 void Application::createVertexBuffers() {
+    // The built in vertices stand in for streamed meshes until they are resident.
+    std::vector<uint16_t> indices(vertices.size());
+    for (size_t i = 0; i < indices.size(); i++) {
+        indices[i] = static_cast<uint16_t>(i);
+    }
+
+    const void *vertexData = vertices.data();
+    const void *indexData = indices.data();
+    VkDeviceSize vertexSize = sizeof(glm::vec3) * vertices.size();
+    VkDeviceSize indexSize = sizeof(uint16_t) * indices.size();
+
+    placeholderMesh.vertexFormat = vtr::MESH_VERTEX_POSITION_F32;
+    placeholderMesh.lodCount = 1;
+    placeholderMesh.lods[0] = {0, static_cast<uint32_t>(indices.size()), 0.0f, 0};
+    placeholderMesh.indexType = VK_INDEX_TYPE_UINT16;
+    placeholderMesh.positionOffset = glm::vec4(0.0f);
+    placeholderMesh.positionScale = glm::vec4(1.0f);
+
+    glm::vec3 min = vertices[0], max = vertices[0];
+    for (const auto &vertex: vertices) {
+        min = glm::min(min, vertex);
+        max = glm::max(max, vertex);
+    }
+
+    glm::vec3 center = (min + max) * 0.5f;
+    float radius = 0.0f;
+    for (const auto &vertex: vertices) {
+        radius = std::max(radius, glm::length(vertex - center));
+    }
+
+    placeholderMesh.bounds = glm::vec4(center, radius);
+
+    // Both streams go through one host visible staging buffer.
+    VkDeviceSize indexStagingOffset = (vertexSize + 3) & ~VkDeviceSize(3);
+    VkDeviceSize stagingSize = indexStagingOffset + indexSize;
+    VkPhysicalDevice physicalDevice = vulkanHandler->device.physicalDevice;
+    VulkanMemoryTracker &memoryTracker = vulkanHandler->device.memoryTracker;
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    vtr::createBuffer(device, physicalDevice, memoryTracker, MemoryCategory::Staging, stagingSize,
+                      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer,
+                      stagingBufferMemory);
+
+    void *data;
+    VK_CHECK_RESULT(vkMapMemory(device, stagingBufferMemory, 0, stagingSize, 0, &data))
+    memcpy(data, vertexData, (size_t) vertexSize);
+    memcpy(static_cast<uint8_t *>(data) + indexStagingOffset, indexData, (size_t) indexSize);
+    vkUnmapMemory(device, stagingBufferMemory);
+
+    vtr::createBuffer(device, physicalDevice, memoryTracker, MemoryCategory::Buffer, vertexSize,
+                      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, placeholderMesh.vertexBuffer,
+                      placeholderMesh.vertexBufferMemory);
+    vtr::createBuffer(device, physicalDevice, memoryTracker, MemoryCategory::Buffer, indexSize,
+                      VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, placeholderMesh.indexBuffer,
+                      placeholderMesh.indexBufferMemory);
+
+    VkCommandBuffer commandBuffer = vtr::beginSingleTimeCommands(device, vulkanHandler->commandPool);
+
+    VkBufferCopy vertexCopy = {0, 0, vertexSize};
+    vkCmdCopyBuffer(commandBuffer, stagingBuffer, placeholderMesh.vertexBuffer, 1, &vertexCopy);
+
+    VkBufferCopy indexCopy = {indexStagingOffset, 0, indexSize};
+    vkCmdCopyBuffer(commandBuffer, stagingBuffer, placeholderMesh.indexBuffer, 1, &indexCopy);
+
+    vtr::endSingleTimeCommands(device, vulkanHandler->commandPool, vulkanHandler->device.graphicsQueue,
+                               commandBuffer);
+
+    vkDestroyBuffer(device, stagingBuffer, nullptr);
+    memoryTracker.free(stagingBufferMemory);
+}
+
+void Application::createScene() {
+    assetStreamer = new VulkanAssetStreamer(vulkanHandler->device, jobSystem, UPLOAD_BUDGET);
+
+    // Mapped during startup, without a converted mesh the placeholder is drawn for good.
+    if (preloadedMesh) {
+        sceneMesh = assetStreamer->requestMesh(MESH_PATH, std::move(preloadedMesh));
+    }
+
+    textureManager = new VulkanTextureManager(vulkanHandler->device, jobSystem, UPLOAD_BUDGET);
+    samplerCache = new VulkanSamplerCache(vulkanHandler->device);
+
+    if (VulkanTextureManager::hasVariant(TEXTURE_PATH)) {
+        sceneTexture = textureManager->requestTexture(TEXTURE_PATH);
+    }
+
+    SamplerState samplerState;
+    samplerState.maxAnisotropy = 16.0f;
+    sceneSampler = samplerCache->getSampler(samplerState);
+
+    transforms.add(vtr::TransformStore::NO_PARENT, glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+                   glm::vec3(1.0f));
+
+    lastFrameTime = std::chrono::steady_clock::now();
+}
+
+void Application::simulate(double deltaSeconds) {
+    PROFILE_ZONE("simulate");
+
+    simulationTime += deltaSeconds;
+
+    // Spins half a radian per second around the view axis.
+    transforms.setRotation(0, glm::angleAxis(static_cast<float>(simulationTime * 0.5), glm::vec3(0.0f, 0.0f, 1.0f)));
+}
+
+void Application::createInstanceBuffers() {
+    instanceBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    instanceBufferMemories.resize(MAX_FRAMES_IN_FLIGHT);
+    instanceBufferMappings.resize(MAX_FRAMES_IN_FLIGHT);
+
     VkBufferCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    createInfo.size = sizeof(glm::vec3) * vertices.size();
+    createInfo.size = sizeof(glm::mat4) * transforms.size();
     createInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
     createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    VK_CHECK_RESULT(vkCreateBuffer(device, &createInfo, nullptr, &vertexBuffer))
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        VK_CHECK_RESULT(vkCreateBuffer(device, &createInfo, nullptr, &instanceBuffers[i]))
 
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(device, vertexBuffer, &memRequirements);
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(device, instanceBuffers[i], &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = vtr::findMemoryType(memRequirements.memoryTypeBits,
-                                                    vulkanHandler->device.physicalDevice,
-                                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = vtr::findMemoryType(memRequirements.memoryTypeBits,
+                                                        vulkanHandler->device.physicalDevice,
+                                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-    VK_CHECK_RESULT(vkAllocateMemory(device, &allocInfo, nullptr, &vertexBufferMemory))
+        instanceBufferMemories[i] = vulkanHandler->device.memoryTracker.allocate(MemoryCategory::Buffer, allocInfo);
 
-    vkBindBufferMemory(device, vertexBuffer, vertexBufferMemory, 0);
+        vkBindBufferMemory(device, instanceBuffers[i], instanceBufferMemories[i], 0);
 
-    void *data;
-    vkMapMemory(device, vertexBufferMemory, 0, createInfo.size, 0, &data);
-    memcpy(data, vertices.data(), (size_t) createInfo.size);
-    vkUnmapMemory(device, vertexBufferMemory);
+        VK_CHECK_RESULT(vkMapMemory(device, instanceBufferMemories[i], 0, createInfo.size, 0,
+                                    &instanceBufferMappings[i]))
+    }
+}
+
+void Application::createOcclusionCuller() {
+    if (!OCCLUSION_CULLING) {
+        return;
+    }
+
+    occlusionCuller = new VulkanOcclusionCuller(vulkanHandler->device, transforms.size());
+    occlusionCuller->setDepthTarget(views[0].renderGraph->getImageView(views[0].depthBuffer),
+                                    vulkanHandler->views[0].windowExtent);
+}
+
+void Application::cullInstances(void *instanceData, const StreamedMesh &mesh) {
+    PROFILE_ZONE("cull");
+
+    const glm::mat4 *worldMatrices = transforms.getWorldMatrices();
+
+    vtr::FrustumCuller::transformSpheres(mesh.bounds, worldMatrices, transforms.size(), worldBounds);
+    visibleCount = vtr::FrustumCuller::cullSpheres(vtr::Frustum::fromViewProjection(viewProjection), worldBounds,
+                                                   visibleInstances);
+
+    selectLods(mesh);
+
+    // Visible instances are packed to the front grouped by level of detail, so one instanced draw covers a level.
+    uint32_t lodFirst[vtr::MESH_MAX_LODS];
+    for (uint32_t lod = 0, first = 0; lod < vtr::MESH_MAX_LODS; lod++) {
+        lodFirst[lod] = first;
+        first += lodInstanceCounts[lod];
+    }
+
+    auto *instances = static_cast<glm::mat4 *>(instanceData);
+    for (uint32_t i = 0; i < visibleCount; i++) {
+        instances[lodFirst[visibleLods[i]]++] = worldMatrices[visibleInstances[i]];
+    }
+}
+
+void Application::selectLods(const StreamedMesh &mesh) {
+    visibleLods.resize(visibleCount);
+    std::fill(std::begin(lodInstanceCounts), std::end(lodInstanceCounts), 0);
+
+    // Every view shares the camera, the primary one decides how large an error is on screen. Clip w and the
+    // largest clip space y a world unit can move are rows of the view projection.
+    const glm::mat4 &vp = viewProjection;
+    glm::vec4 wRow(vp[0][3], vp[1][3], vp[2][3], vp[3][3]);
+    float pixelsPerUnit = glm::length(glm::vec3(vp[0][1], vp[1][1], vp[2][1])) * 0.5f *
+                          static_cast<float>(vulkanHandler->views[0].windowExtent.height);
+
+    for (uint32_t i = 0; i < visibleCount; i++) {
+        uint32_t index = visibleInstances[i];
+        uint32_t selected = 0;
+
+        float w = glm::dot(wRow, glm::vec4(worldBounds.centerX[index], worldBounds.centerY[index],
+                                           worldBounds.centerZ[index], 1.0f));
+
+        // Errors are in object space, instances are scaled uniformly. Near the camera plane LOD 0 is kept.
+        if (w > 0.0f && mesh.bounds.w > 0.0f) {
+            float scale = worldBounds.radius[index] / mesh.bounds.w * pixelsPerUnit / w;
+
+            while (selected + 1 < mesh.lodCount && mesh.lods[selected + 1].error * scale <= LOD_ERROR_PIXELS) {
+                selected++;
+            }
+        }
+
+        visibleLods[i] = selected;
+        lodInstanceCounts[selected]++;
+        lodInstanceTotals[selected]++;
+    }
 }
 
 void Application::draw() {
-    vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    PROFILE_ZONE("draw");
 
-    uint32_t imageIndex;
-    VkResult result = vkAcquireNextImageKHR(device, vulkanHandler->swapChain.swapChain,
-                                            UINT64_MAX,
-                                            imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE,
-                                            &imageIndex);
+    {
+        PROFILE_ZONE("wait frame fence");
+        vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    }
+
+    // A view whose swapchain went out of date is rebuilt and sits this frame out, the others still present.
+    std::vector<uint32_t> acquiredViews;
+    for (uint32_t view = 0; view < views.size(); view++) {
+        PROFILE_ZONE("acquire");
+
+        ViewState &state = views[view];
+        state.imageIndex = UINT32_MAX;
+
+        uint32_t imageIndex;
+        VkResult result = vkAcquireNextImageKHR(device, vulkanHandler->views[view].swapChain.swapChain, UINT64_MAX,
+                                                state.imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE,
+                                                &imageIndex);
+
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            LOG_VERBOSE("out of date first %zu, view %u", currentFrame, view);
+            resizeView(view);
+            continue;
+        } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+            throw std::runtime_error("failed to acquire swap chain image!");
+        }
+
+        if (state.imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
+            vkWaitForFences(device, 1, &state.imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+        }
+
+        state.imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+        state.imageIndex = imageIndex;
+        acquiredViews.push_back(view);
+    }
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-        resizeApplication();
-        std::cout << "out of date first " << currentFrame << std::endl;
+    if (acquiredViews.empty()) {
         return;
-    } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-        throw std::runtime_error("failed to acquire swap chain image!");
     }
 
-    if (imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
-        vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+    {
+        PROFILE_ZONE("streaming");
+        assetStreamer->update();
+        textureManager->update();
+        vulkanHandler->device.memoryTracker.update();
     }
 
-    imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+    // Captures submitted with this frame's fence are done, hand them over before the fence is reset.
+    if (readback != nullptr) {
+        readback->update();
+    }
 
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    if (gpuProfiler != nullptr) {
+        gpuProfiler->beginFrame(static_cast<uint32_t>(currentFrame));
+    }
+
+    const StreamedMesh *streamedMesh = assetStreamer->getMesh(sceneMesh);
+    const StreamedMesh &mesh = streamedMesh != nullptr ? *streamedMesh : placeholderMesh;
+
+    double deltaSeconds = batch.timestep;
+    if (batch.frameCount == 0) {
+        auto now = std::chrono::steady_clock::now();
+        deltaSeconds = std::chrono::duration<double>(now - lastFrameTime).count();
+        lastFrameTime = now;
+    }
+
+    simulate(deltaSeconds);
+
+    transforms.update();
+
+    // Views share the camera, so culling runs once and every view draws the same instances.
+    cullInstances(instanceBufferMappings[currentFrame], mesh);
+    buildDrawList(mesh);
+
+    // The primary view tests the frustum visible instances again on the GPU.
+    if (occlusionCuller != nullptr &&
+        occlusionCuller->beginFrame(static_cast<uint32_t>(currentFrame), mesh.lods, mesh.lodCount,
+                                    transforms.getWorldMatrices(), worldBounds, visibleInstances.data(),
+                                    visibleLods.data(), visibleCount)) {
+        const OcclusionStats &stats = occlusionCuller->getStats();
+        occlusionTested += stats.objects;
+        occlusionCulled += stats.occluded;
+
+        LOG_VERBOSE("occlusion %u objects, %u drawn early, %u late, %u culled", stats.objects, stats.early,
+                    stats.late, stats.occluded);
+    }
 
-    VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
+    buildHud(deltaSeconds);
 
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+    const VulkanView &primaryView = vulkanHandler->views[0];
+    capturing = (captureRequested || batch.frameCount > 0) && readback != nullptr &&
+                views[0].imageIndex != UINT32_MAX &&
+                readback->beginCapture(primaryView.windowExtent, primaryView.swapChain.format);
 
-    VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
+    if (batch.frameCount > 0 && !capturing) {
+        throw std::runtime_error("no readback slot left for a batch frame!");
+    }
+
+    // Enqueued ahead of the frame's graphics work, with async compute it overlaps the previous frame's.
+    if (particleSystem != nullptr) {
+        particleSystem->simulate(static_cast<uint32_t>(currentFrame), static_cast<float>(deltaSeconds));
+    }
+
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<VkPipelineStageFlags> waitStages;
+    std::vector<VkCommandBuffer> submitCommandBuffers;
+    std::vector<VkSemaphore> signalSemaphores;
+    std::vector<VkSwapchainKHR> swapChains;
+    std::vector<uint32_t> imageIndices;
+
+    for (uint32_t view: acquiredViews) {
+        recordCommandBuffer(view);
+
+        const ViewState &state = views[view];
+        waitSemaphores.push_back(state.imageAvailableSemaphores[currentFrame]);
+        waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        submitCommandBuffers.push_back(state.commandBuffers[state.imageIndex]);
+        signalSemaphores.push_back(state.renderFinishedSemaphores[currentFrame]);
+        swapChains.push_back(vulkanHandler->views[view].swapChain.swapChain);
+        imageIndices.push_back(state.imageIndex);
+    }
+
+    if (particleSystem != nullptr) {
+        waitSemaphores.push_back(particleSystem->getSemaphore());
+        waitStages.push_back(particleSystem->getWaitStages());
+    }
 
     vkResetFences(device, 1, &inFlightFences[currentFrame]);
 
-    if (vkQueueSubmit(vulkanHandler->device.graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) !=
-        VK_SUCCESS) {
-        throw std::runtime_error("failed to submit draw command buffer!");
+    // Every view goes out in one batch, together with whatever the streamers and the particles enqueued before,
+    // and in one present.
+    {
+        PROFILE_ZONE("submit");
+        VulkanSubmitScheduler &submitScheduler = vulkanHandler->device.submitScheduler;
+        submitScheduler.enqueue(vulkanHandler->device.graphicsQueue,
+                                {submitCommandBuffers, waitSemaphores, waitStages, signalSemaphores,
+                                 inFlightFences[currentFrame]});
+        submitScheduler.flush();
+    }
+
+    if (capturing) {
+        readback->endCapture(inFlightFences[currentFrame], frameNumber);
+        captureRequested = false;
+        capturing = false;
     }
 
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
-    presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores;
-
-    VkSwapchainKHR swapChains[] = {vulkanHandler->swapChain.swapChain};
-    presentInfo.swapchainCount = 1;
-    presentInfo.pSwapchains = swapChains;
+    presentInfo.waitSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+    presentInfo.pWaitSemaphores = signalSemaphores.data();
 
-    presentInfo.pImageIndices = &imageIndex;
+    std::vector<VkResult> presentResults(swapChains.size());
+    presentInfo.swapchainCount = static_cast<uint32_t>(swapChains.size());
+    presentInfo.pSwapchains = swapChains.data();
+    presentInfo.pImageIndices = imageIndices.data();
+    presentInfo.pResults = presentResults.data();
 
-    result = vkQueuePresentKHR(vulkanHandler->device.presentQueue, &presentInfo);
+    VkResult result;
+    {
+        PROFILE_ZONE("present");
+        result = vkQueuePresentKHR(vulkanHandler->device.presentQueue, &presentInfo);
+    }
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
-        framebufferResized = false;
+    if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR && result != VK_ERROR_OUT_OF_DATE_KHR) {
+        throw std::runtime_error("failed to present swap chain image!");
+    }
 
-        std::cout << "out of date second " << currentFrame << std::endl;
+    for (size_t i = 0; i < acquiredViews.size(); i++) {
+        uint32_t view = acquiredViews[i];
+        VkResult viewResult = presentResults[i];
+
+        if (viewResult == VK_ERROR_OUT_OF_DATE_KHR || viewResult == VK_SUBOPTIMAL_KHR ||
+            (view == 0 && framebufferResized)) {
+            LOG_VERBOSE("out of date second %zu, view %u", currentFrame, view);
+            resizeView(view);
+        } else if (viewResult != VK_SUCCESS) {
+            throw std::runtime_error("failed to present swap chain image!");
+        }
+    }
 
-        resizeApplication();
-    } else if (result != VK_SUCCESS) {
-        throw std::runtime_error("failed to present swap chain image!");
+    if (frameNumber == 0) {
+        startup.record("first frame", constructed, vtr::StartupTimeline::Clock::now());
+        startup.report();
     }
 
     currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    frameNumber++;
 }
 
 void Application::createSyncPrimitives() {
-    imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
     inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-    imagesInFlight.resize(vulkanHandler->swapChain.imageCount, VK_NULL_HANDLE);
 
     VkSemaphoreCreateInfo semaphoreCreateInfo = {};
     semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -307,60 +1324,145 @@ void Application::createSyncPrimitives() {
     fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
     for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-        VK_CHECK_RESULT(
-                vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr,
-                                  &imageAvailableSemaphores[i]))
-        VK_CHECK_RESULT(
-                vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr,
-                                  &renderFinishedSemaphores[i]))
         VK_CHECK_RESULT(
                 vkCreateFence(device, &fenceCreateInfo, nullptr, &inFlightFences[i]))
     }
+
+    for (uint32_t view = 0; view < views.size(); view++) {
+        ViewState &state = views[view];
+        state.imagesInFlight.assign(vulkanHandler->views[view].swapChain.imageCount, VK_NULL_HANDLE);
+
+        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+            VK_CHECK_RESULT(
+                    vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr,
+                                      &state.imageAvailableSemaphores[i]))
+            VK_CHECK_RESULT(
+                    vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr,
+                                      &state.renderFinishedSemaphores[i]))
+        }
+    }
 }
 
 void Application::cleanup() {
-    resizeCleanup();
+    // A frame that threw halfway may have left uploads with fences behind, they must signal before teardown.
+    vulkanHandler->device.submitScheduler.flush();
+
+    for (uint32_t view = 0; view < views.size(); view++) {
+        resizeCleanup(view);
+        delete views[view].renderGraph;
+    }
+
+    for (size_t i = 0; i < instanceBuffers.size(); i++) {
+        vkDestroyBuffer(device, instanceBuffers[i], nullptr);
+        vulkanHandler->device.memoryTracker.free(instanceBufferMemories[i]);
+    }
+
+    delete occlusionCuller;
+    delete gpuProfiler;
+    delete readback;
+    delete frameWriter;
+    delete assetStreamer;
+    delete textureManager;
+    delete hud;
+    delete samplerCache;
+
+    vkDestroyBuffer(device, placeholderMesh.indexBuffer, nullptr);
+    vulkanHandler->device.memoryTracker.free(placeholderMesh.indexBufferMemory);
+    vkDestroyBuffer(device, placeholderMesh.vertexBuffer, nullptr);
+    vulkanHandler->device.memoryTracker.free(placeholderMesh.vertexBufferMemory);
+
+    // Joins the compile thread, which may still be using the shader modules and the layout.
+    delete pipelineCache;
+    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+    delete particleSystem;
 
     vkDestroyShaderModule(device, fragShaderModule, nullptr);
-    vkDestroyShaderModule(device, vertShaderModule, nullptr);
+    for (auto &vertShaderModule: vertShaderModules) {
+        vkDestroyShaderModule(device, vertShaderModule, nullptr);
+    }
 }
 
-void Application::resizeCleanup() {
+void Application::resizeCleanup(uint32_t view) {
+    std::vector<VkCommandBuffer> &commandBuffers = views[view].commandBuffers;
+
     vkDeviceWaitIdle(device);
     vkFreeCommandBuffers(device, vulkanHandler->commandPool, commandBuffers.size(),
                          commandBuffers.data());
-    vkDestroyPipeline(device, graphicsPipeline, nullptr);
-    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-
 }
 
-void Application::resizeApplication() {
-    resizeCleanup();
+void Application::resizeView(uint32_t view) {
+    // Only the primary window gets events, the other views are headless and keep their extent.
+    VkExtent2D extent = vulkanHandler->views[view].windowExtent;
+
+    if (view == 0) {
+        // Minimized, wait for the event thread to hand over a usable extent.
+        while (windowExtent.width == 0 || windowExtent.height == 0) {
+            if (!processEvents()) {
+                return;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        framebufferResized = false;
+        extent = windowExtent;
+    }
+
+    resizeCleanup(view);
+
+    vulkanHandler->resizeCallback(view, extent);
+
+    // Queued pipelines may still be built against the render pass the graph is about to destroy.
+    pipelineCache->waitIdle();
+    createRenderGraph(view);
 
-    VkExtent2D extent = windowManager.getWindowExtent();
-    while (extent.width == 0 || extent.height == 0) {
-        extent = windowManager.getWindowExtent();
-        windowManager.waitEvents();
+    ViewState &state = views[view];
+    for (auto &desc: state.scenePipelines) {
+        desc.colorFormats = {vulkanHandler->views[view].swapChain.format};
+        desc.renderPass = state.renderGraph->getRenderPass(state.scenePass);
     }
 
-    vulkanHandler->resizeCallback(windowManager.getWindowExtent());
+    state.particlePipeline.colorFormats = {vulkanHandler->views[view].swapChain.format};
+    state.particlePipeline.renderPass = state.renderGraph->getRenderPass(state.particlePass);
+    state.hudPipeline.colorFormats = {vulkanHandler->views[view].swapChain.format};
+    state.hudPipeline.renderPass = state.renderGraph->getRenderPass(state.hudPass);
 
-    createGraphicsPipeline();
-    createCommandBuffers();
+    // Nothing is in flight after the wait in resizeCleanup(), and the image count may have changed.
+    state.imagesInFlight.assign(vulkanHandler->views[view].swapChain.imageCount, VK_NULL_HANDLE);
+    createCommandBuffers(view);
 }
 
 void Application::resizeCallback(GLFWwindow *window, int width, int height) {
     auto app = reinterpret_cast<Application *>(glfwGetWindowUserPointer(window));
 
-    app->framebufferResized = true;
+    app->resizeExtent.store(static_cast<uint64_t>(width) << 32 | static_cast<uint32_t>(height),
+                            std::memory_order_release);
+    app->resizeChanged.store(true, std::memory_order_release);
 
-    std::cout << "Resized" << std::endl;
+    LOG_INFO("Resized %dx%d", width, height);
+}
+
+void Application::keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+    auto app = reinterpret_cast<Application *>(glfwGetWindowUserPointer(window));
+
+    WindowEvent event = {};
+    event.type = WindowEventType::Key;
+    event.key = key;
+    event.scancode = scancode;
+    event.action = action;
+    event.mods = mods;
+    app->pushEvent(event);
 }
 
 void Application::loadShaders() {
-    auto vertShaderCode = readFile("visual/shaders/vert.spv");
-    auto fragShaderCode = readFile("visual/shaders/frag.spv");
+    // Indexed by mesh vertex format.
+    const char *vertShaderNames[] = {"shader.vert", "shader_standard.vert", "shader_quantized.vert"};
+    static_assert(sizeof(vertShaderNames) / sizeof(vertShaderNames[0]) == vtr::MESH_VERTEX_FORMAT_COUNT,
+                  "a vertex shader is missing for a mesh vertex format");
+
+    for (uint32_t format = 0; format < vtr::MESH_VERTEX_FORMAT_COUNT; format++) {
+        vertShaderModules[format] = createShaderModule(device, vtr::getShader(vertShaderNames[format]));
+    }
 
-    vertShaderModule = createShaderModule(device, vertShaderCode);
-    fragShaderModule = createShaderModule(device, fragShaderCode);
+    fragShaderModule = createShaderModule(device, vtr::getShader("shader.frag"));
 }
@@ -3,18 +3,114 @@
 
 
 #include "base/vulkan/VulkanHandler.h"
+#include "base/vulkan/VulkanAssetStreamer.h"
+#include "base/vulkan/VulkanTextureManager.h"
+#include "base/vulkan/VulkanSamplerCache.h"
+#include "base/vulkan/VulkanPipelineCache.h"
+#include "base/vulkan/VulkanRenderGraph.h"
+#include "base/vulkan/VulkanReadback.h"
+#include "base/vulkan/VulkanOcclusionCuller.h"
+#include "base/vulkan/VulkanParticleSystem.h"
+#include "base/vulkan/VulkanGpuProfiler.h"
+#include "base/vulkan/VulkanHud.h"
 #include "base/window/glfw/GLFWWindowManager.h"
+#include "base/window/headless/HeadlessWindowManager.h"
+#include "base/window/WindowEvent.h"
+#include "base/thread/SpscQueue.h"
+#include "base/thread/JobSystem.h"
+#include "base/capture/FrameWriter.h"
+#include "base/log/StartupTimeline.h"
 
-#define GLM_FORCE_RADIANS
-#define GLM_FORCE_DEPTH_ZERO_TO_ONE
-#define GLM_ENABLE_EXPERIMENTAL
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <thread>
 
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
+#include "base/scene/SceneMath.h"
+#include "base/scene/TransformStore.h"
+#include "base/scene/FrustumCuller.h"
+#include "base/scene/DrawList.h"
+#include "base/mesh/MeshFormat.h"
 
 #define WIDTH 800
 #define HEIGHT 600
 
+// Produced by tools/meshconv, the vertices below are drawn until it is streamed in or when it is missing.
+#define MESH_PATH "visual/meshes/scene.mesh"
+
+// Base path of the scene texture, see VulkanTextureManager for the variants looked up next to it.
+#define TEXTURE_PATH "visual/textures/scene"
+
+// Driver pipeline cache data, reused across runs.
+#define PIPELINE_CACHE_PATH "pipeline_cache.bin"
+
+// Bytes copied to device local memory per frame by the asset streamer, and again by the texture streamer.
+#define UPLOAD_BUDGET (4 * 1024 * 1024)
+
+// Fraction of each memory heap budget streaming may use before it degrades, and seconds between memory dumps.
+#define MEMORY_SOFT_BUDGET 0.9f
+#define MEMORY_DUMP_INTERVAL 30.0
+
+// Test the primary view's frustum visible instances against a depth pyramid of what was visible last frame.
+#define OCCLUSION_CULLING true
+
+// Each instance is drawn with the coarsest level of detail whose error projects to at most this many pixels.
+#define LOD_ERROR_PIXELS 1.0f
+
+// Particles simulated on the async compute queue where there is one, and the most that are alive at once.
+#define GPU_PARTICLES true
+#define PARTICLE_CAPACITY (2 * 1024 * 1024)
+
+// Performance overlay on the primary window, toggled with F3. Its text is refreshed every HUD_REFRESH_INTERVAL
+// seconds, the frame time graphs every frame and hold the last HUD_HISTORY frames.
+#define HUD_OVERLAY true
+#define HUD_REFRESH_INTERVAL 0.25
+#define HUD_HISTORY 120
+#define HUD_TEXT_SCALE 2.0f
+
+// Frames buffered between readback and the disk in batch mode.
+#define WRITER_QUEUE_DEPTH 8
+
+// Offline rendering without a window or vsync, frameCount frames at a fixed timestep are written to outputPath.
+struct BatchOptions {
+    // 0 runs interactively.
+    uint32_t frameCount = 0;
+    double timestep = 1.0 / 60.0;
+    std::string outputPath = "frames.y4m";
+    uint32_t width = WIDTH;
+    uint32_t height = HEIGHT;
+    // Headless views rendered and presented together, only the first one is written.
+    uint32_t viewCount = 1;
+};
+
+// Everything that exists once per swapchain, the rest of the application is shared by all views.
+struct ViewState {
+    // Rebuilt with the swapchain, the scene pass draws straight into the acquired image.
+    VulkanRenderGraph *renderGraph = nullptr;
+    RenderGraphResource backbuffer;
+    RenderGraphResource depthBuffer;
+    // The early scene pass when occlusion culled, the late one draws with the same pipelines.
+    RenderGraphPass scenePass;
+    // Drawn on top of the scene when GPU_PARTICLES is on.
+    RenderGraphPass particlePass;
+    // Last, on the primary view only.
+    RenderGraphPass hudPass;
+
+    // Differ between views in the color format and the render pass only.
+    GraphicsPipelineDesc scenePipelines[vtr::MESH_VERTEX_FORMAT_COUNT];
+    GraphicsPipelineDesc particlePipeline;
+    GraphicsPipelineDesc hudPipeline;
+
+    std::vector<VkCommandBuffer> commandBuffers;
+    std::vector<VkFence> imagesInFlight;
+
+    VkSemaphore imageAvailableSemaphores[MAX_FRAMES_IN_FLIGHT];
+    VkSemaphore renderFinishedSemaphores[MAX_FRAMES_IN_FLIGHT];
+
+    // Acquired for this frame, UINT32_MAX when the view sits the frame out.
+    uint32_t imageIndex = UINT32_MAX;
+};
+
 static std::vector<glm::vec3> vertices = {
         {.5, .0, .0},
         {.0, .5, .0},
@@ -24,57 +120,224 @@ static std::vector<glm::vec3> vertices = {
         {.5, .25, .0}
 };
 
+// Direct draws the CPU culled instances, the other two the occlusion culler's early and late instances.
+enum class ScenePhase {
+    Direct, Early, Late
+};
+
+// What a draw packet points at, instances are a range of the frame's instance buffer.
+struct SceneDraw {
+    const StreamedMesh *mesh;
+    uint32_t lod;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+};
+
 class Application {
 public:
-    Application();
+    explicit Application(const BatchOptions &batch = BatchOptions());
 
     ~Application();
 
     static void resizeCallback(GLFWwindow *window, int width, int height);
 
+    static void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods);
+
     void mainLoop();
 
 private:
+    // First member, so the timeline starts before anything else is constructed.
+    vtr::StartupTimeline startup;
+    vtr::StartupTimeline::Clock::time_point constructed;
+
+    // Both refer to the primary window, the only one that gets events.
     bool framebufferResized = false;
 
+    // Extent as last reported by the event thread, owned by the render thread.
+    VkExtent2D windowExtent;
+
+    std::thread renderThread;
+    std::atomic<bool> renderRunning{false};
+    std::exception_ptr renderException;
+
+    // Written by the event (main) thread only, read by the render thread only. Input may be dropped when the
+    // queue is full, the latest extent and a close request are kept outside of it and never are.
+    vtr::SpscQueue<WindowEvent, 256> events;
+    // Width in the high and height in the low 32 bits, resizeChanged is set once it is stored.
+    std::atomic<uint64_t> resizeExtent{0};
+    std::atomic<bool> resizeChanged{false};
+    std::atomic<bool> closeRequested{false};
+
     VkDevice device;
 
     VulkanHandler *vulkanHandler = nullptr;
-    GLFWWindowManager windowManager;
+
+    // One per view, the first one is the primary window.
+    std::vector<WindowManager *> windowManagers;
+
+    BatchOptions batch;
+    vtr::FrameWriter *frameWriter = nullptr;
+
+    // Indexed like vulkanHandler->views.
+    std::vector<ViewState> views;
+
+    // Copies the primary view's backbuffer to the host on request, nullptr when its swapchain can not be copied
+    // from.
+    VulkanReadback *readback = nullptr;
+    bool captureRequested = false;
+    bool capturing = false;
+
+    // What the scene passes draw this frame, sorted by key before the graphs are executed.
+    vtr::DrawList drawList;
+    std::vector<SceneDraw> sceneDraws;
+
+    // Summed over every recorded scene pass.
+    vtr::DrawListStats drawStats = {};
+
+    VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+
+    // nullptr when OCCLUSION_CULLING is off. Frustum culled objects and the ones it culls, summed over every frame.
+    VulkanOcclusionCuller *occlusionCuller = nullptr;
+    uint64_t occlusionTested = 0;
+    uint64_t occlusionCulled = 0;
+
+    // nullptr unless the profiler was enabled before construction, see main.cpp, or the HUD shows GPU time.
+    VulkanGpuProfiler *gpuProfiler = nullptr;
+
+    // nullptr in batch mode or when HUD_OVERLAY is off. Frame times in milliseconds, hudHistoryIndex is the oldest.
+    VulkanHud *hud = nullptr;
+    bool hudVisible = true;
+    float hudCpuHistory[HUD_HISTORY] = {};
+    float hudGpuHistory[HUD_HISTORY] = {};
+    uint32_t hudHistoryIndex = 0;
+
+    // Text is rebuilt at refresh only, from what was summed since the refresh before.
+    std::string hudText;
+    uint32_t hudTextColumns = 0;
+    std::chrono::steady_clock::time_point hudRefreshTime;
+    uint32_t hudFrames = 0;
+    double hudCpuSum = 0.0;
+    double hudGpuSum = 0.0;
+    double hudBuildMilliseconds = 0.0;
+    vtr::DrawListStats hudDrawStats = {};
+
+    // nullptr when GPU_PARTICLES is off.
+    VulkanParticleSystem *particleSystem = nullptr;
 
     VkPipelineLayout pipelineLayout;
-    VkPipeline graphicsPipeline;
+    VulkanPipelineCache *pipelineCache = nullptr;
 
-    VkShaderModule vertShaderModule;
+    VkShaderModule vertShaderModules[vtr::MESH_VERTEX_FORMAT_COUNT];
     VkShaderModule fragShaderModule;
 
-    VkBuffer vertexBuffer;
-    VkDeviceMemory vertexBufferMemory;
+    vtr::JobSystem jobSystem;
 
-    std::vector<VkCommandBuffer> commandBuffers;
+    VulkanAssetStreamer *assetStreamer = nullptr;
+    MeshHandle sceneMesh = UINT32_MAX;
+
+    // Mapped while the device is created, handed to the streamer by createScene().
+    std::unique_ptr<vtr::MeshFile> preloadedMesh;
+
+    // Uploaded synchronously from vertices, drawn while sceneMesh is not resident.
+    StreamedMesh placeholderMesh = {};
+
+    VulkanTextureManager *textureManager = nullptr;
+    VulkanSamplerCache *samplerCache = nullptr;
+    TextureHandle sceneTexture = UINT32_MAX;
+    VkSampler sceneSampler = VK_NULL_HANDLE;
+
+    vtr::TransformStore transforms;
+
+    // The vertex shader writes world positions straight to clip space, so there is no camera yet.
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+
+    vtr::SphereBounds worldBounds;
+    // Only the first visibleCount are this frame's, the culler keeps the vector at its largest size.
+    std::vector<uint32_t> visibleInstances;
+    uint32_t visibleCount = 0;
+    // Level of detail of each visible instance, and how many got each level this frame.
+    std::vector<uint32_t> visibleLods;
+    uint32_t lodInstanceCounts[vtr::MESH_MAX_LODS] = {};
+    // Summed over every frame.
+    uint64_t lodInstanceTotals[vtr::MESH_MAX_LODS] = {};
+
+    // One persistently mapped instance buffer per frame in flight, holding a world matrix per transform. Every view
+    // draws from the same one.
+    std::vector<VkBuffer> instanceBuffers;
+    std::vector<VkDeviceMemory> instanceBufferMemories;
+    std::vector<void *> instanceBufferMappings;
 
     size_t currentFrame = 0;
+    uint64_t frameNumber = 0;
+
+    // Advanced by the wall clock, or by batch.timestep in batch mode.
+    double simulationTime = 0.0;
+    std::chrono::steady_clock::time_point lastFrameTime;
 
-    std::vector<VkSemaphore> imageAvailableSemaphores;
-    std::vector<VkSemaphore> renderFinishedSemaphores;
+    // Covers the submit of every view.
     std::vector<VkFence> inFlightFences;
-    std::vector<VkFence> imagesInFlight;
+
+    void createReadback();
+
+    static void writeScreenshot(const ReadbackFrame &frame);
+
+    void createRenderGraph(uint32_t view);
+
+    void buildDrawList(const StreamedMesh &mesh);
+
+    void drawScene(const ViewState &view, VkCommandBuffer commandBuffer, ScenePhase phase);
+
+    void drawParticles(const ViewState &view, VkCommandBuffer commandBuffer);
+
+    void createHud();
+
+    void buildHud(double deltaSeconds);
+
+    void drawHud(const ViewState &view, VkCommandBuffer commandBuffer);
+
+    static void setViewport(VkCommandBuffer commandBuffer, VkExtent2D extent);
+
+    void logDrawStats();
 
     void createGraphicsPipeline();
 
-    void createCommandBuffers();
+    static uint32_t vertexAttributes(uint32_t vertexFormat, VkVertexInputAttributeDescription *attributes);
+
+    void createCommandBuffers(uint32_t view);
+
+    void recordCommandBuffer(uint32_t view);
+
+    void cullInstances(void *instanceData, const StreamedMesh &mesh);
+
+    void selectLods(const StreamedMesh &mesh);
 
     void createVertexBuffers();
 
+    void createScene();
+
+    void simulate(double deltaSeconds);
+
+    void createInstanceBuffers();
+
+    void createOcclusionCuller();
+
     void createSyncPrimitives();
 
-    void resizeApplication();
+    void resizeView(uint32_t view);
+
+    void renderLoop();
+
+    void batchLoop();
+
+    bool processEvents();
+
+    void pushEvent(const WindowEvent &event);
 
     void draw();
 
     void cleanup();
 
-    void resizeCleanup();
+    void resizeCleanup(uint32_t view);
 
     void loadShaders();
 };
@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include "FrameWriter.h"
+#include "../log/Logger.h"
+
+using namespace vtr;
+
+namespace {
+    inline uint8_t clampByte(int32_t value) {
+        return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+    }
+
+    // Full range BT.601 in 8.8 fixed point, the 32768 bias keeps the shifted values non negative.
+    inline uint8_t lumaOf(int32_t r, int32_t g, int32_t b) {
+        return clampByte((77 * r + 150 * g + 29 * b + 128) >> 8);
+    }
+
+    inline uint8_t blueDifferenceOf(int32_t r, int32_t g, int32_t b) {
+        return clampByte((-43 * r - 85 * g + 128 * b + 32768 + 128) >> 8);
+    }
+
+    inline uint8_t redDifferenceOf(int32_t r, int32_t g, int32_t b) {
+        return clampByte((128 * r - 107 * g - 21 * b + 32768 + 128) >> 8);
+    }
+
+    double secondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+FrameWriter::FrameWriter(const std::string &path, uint32_t width, uint32_t height, uint32_t framesPerSecond,
+                         uint32_t queueDepth) : width(width), height(height), slots(queueDepth) {
+    if (queueDepth == 0) {
+        throw std::runtime_error("frame writer needs at least one slot");
+    }
+
+    y4m = path.size() >= 4 && path.compare(path.size() - 4, 4, ".y4m") == 0;
+
+    file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        throw std::runtime_error("failed to open " + path);
+    }
+
+    if (y4m) {
+        fprintf(file, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", width, height, framesPerSecond);
+    }
+
+    for (auto &slot: slots) {
+        slot.pixels.resize(size_t(width) * height * 4);
+    }
+
+    thread = std::thread(&FrameWriter::writerLoop, this);
+}
+
+FrameWriter::~FrameWriter() {
+    finish();
+}
+
+void FrameWriter::push(const uint8_t *pixels, bool bgra) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    slotFreed.wait(lock, [this]() { return queued < slots.size(); });
+
+    stats.producerStallSeconds += secondsSince(start);
+
+    // The writer only touches queued slots, this one is ours until it is counted.
+    Slot &slot = slots[(head + queued) % slots.size()];
+    lock.unlock();
+
+    memcpy(slot.pixels.data(), pixels, slot.pixels.size());
+    slot.bgra = bgra;
+
+    lock.lock();
+    queued++;
+    lock.unlock();
+
+    frameQueued.notify_one();
+}
+
+void FrameWriter::finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (finishing) {
+            return;
+        }
+
+        finishing = true;
+    }
+
+    frameQueued.notify_one();
+    thread.join();
+
+    fclose(file);
+}
+
+FrameWriterStats FrameWriter::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return stats;
+}
+
+void FrameWriter::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        auto start = std::chrono::steady_clock::now();
+        frameQueued.wait(lock, [this]() { return queued > 0 || finishing; });
+
+        if (queued == 0) {
+            break;
+        }
+
+        stats.writerIdleSeconds += secondsSince(start);
+
+        const Slot &slot = slots[head];
+        lock.unlock();
+
+        writeFrame(slot);
+
+        lock.lock();
+        head = (head + 1) % slots.size();
+        queued--;
+        stats.frames++;
+
+        slotFreed.notify_one();
+    }
+}
+
+void FrameWriter::writeFrame(const Slot &slot) {
+    const uint8_t *pixels = slot.pixels.data();
+    uint32_t red = slot.bgra ? 2 : 0;
+    uint32_t blue = slot.bgra ? 0 : 2;
+
+    if (!y4m) {
+        converted.resize(slot.pixels.size());
+
+        for (size_t i = 0; i < slot.pixels.size(); i += 4) {
+            converted[i + 0] = pixels[i + red];
+            converted[i + 1] = pixels[i + 1];
+            converted[i + 2] = pixels[i + blue];
+            converted[i + 3] = pixels[i + 3];
+        }
+    } else {
+        uint32_t chromaWidth = (width + 1) / 2;
+        uint32_t chromaHeight = (height + 1) / 2;
+        size_t lumaSize = size_t(width) * height;
+        size_t chromaSize = size_t(chromaWidth) * chromaHeight;
+
+        converted.resize(lumaSize + chromaSize * 2);
+        uint8_t *luma = converted.data();
+        uint8_t *blueDifference = luma + lumaSize;
+        uint8_t *redDifference = blueDifference + chromaSize;
+
+        for (size_t i = 0; i < lumaSize; i++) {
+            const uint8_t *texel = pixels + i * 4;
+            luma[i] = lumaOf(texel[red], texel[1], texel[blue]);
+        }
+
+        // Chroma of the 2x2 block average, edges of odd sizes reuse the last row or column.
+        for (uint32_t y = 0; y < chromaHeight; y++) {
+            for (uint32_t x = 0; x < chromaWidth; x++) {
+                int32_t r = 0, g = 0, b = 0;
+
+                for (uint32_t dy = 0; dy < 2; dy++) {
+                    for (uint32_t dx = 0; dx < 2; dx++) {
+                        uint32_t sx = std::min(x * 2 + dx, width - 1);
+                        uint32_t sy = std::min(y * 2 + dy, height - 1);
+                        const uint8_t *texel = pixels + (size_t(sy) * width + sx) * 4;
+
+                        r += texel[red];
+                        g += texel[1];
+                        b += texel[blue];
+                    }
+                }
+
+                r = (r + 2) / 4;
+                g = (g + 2) / 4;
+                b = (b + 2) / 4;
+
+                blueDifference[size_t(y) * chromaWidth + x] = blueDifferenceOf(r, g, b);
+                redDifference[size_t(y) * chromaWidth + x] = redDifferenceOf(r, g, b);
+            }
+        }
+
+        fputs("FRAME\n", file);
+    }
+
+    // Runs on the writer thread, a full disk is reported and the stream keeps going.
+    if (fwrite(converted.data(), 1, converted.size(), file) != converted.size()) {
+        LOG_ERROR("Failed to write frame %llu", (unsigned long long) stats.frames);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.bytes += converted.size();
+}
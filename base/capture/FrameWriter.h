@@ -0,0 +1,79 @@
+#ifndef VULKAN_TRY_FRAMEWRITER_H
+#define VULKAN_TRY_FRAMEWRITER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vtr {
+    struct FrameWriterStats {
+        uint64_t frames;
+        uint64_t bytes;
+        // Time push() spent waiting for a free slot, the disk was the bottleneck then.
+        double producerStallSeconds;
+        // Time the writer thread spent waiting for frames, the renderer was the bottleneck then.
+        double writerIdleSeconds;
+    };
+
+    /*
+     * Streams 8 bit RGBA or BGRA frames to disk on a background thread. Paths ending in .y4m get a YUV4MPEG2
+     * stream, 4:2:0 with full range BT.601, anything else raw RGBA rows. At most queueDepth frames are buffered,
+     * push() blocks beyond that so memory stays bounded when the disk can not keep up.
+     */
+    class FrameWriter {
+    public:
+        FrameWriter(const std::string &path, uint32_t width, uint32_t height, uint32_t framesPerSecond,
+                    uint32_t queueDepth);
+
+        FrameWriter(const FrameWriter &) = delete;
+
+        FrameWriter &operator=(const FrameWriter &) = delete;
+
+        ~FrameWriter();
+
+        // Copies width * height * 4 bytes of tightly packed pixels.
+        void push(const uint8_t *pixels, bool bgra);
+
+        // Writes everything still queued and closes the file, push() must not be called afterwards.
+        void finish();
+
+        FrameWriterStats getStats();
+
+    private:
+        struct Slot {
+            std::vector<uint8_t> pixels;
+            bool bgra;
+        };
+
+        FILE *file;
+        bool y4m;
+        uint32_t width;
+        uint32_t height;
+
+        std::vector<Slot> slots;
+        // Oldest queued slot and the number of queued slots.
+        size_t head = 0;
+        size_t queued = 0;
+        bool finishing = false;
+
+        std::mutex mutex;
+        std::condition_variable frameQueued;
+        std::condition_variable slotFreed;
+        std::thread thread;
+
+        FrameWriterStats stats = {};
+
+        // Owned by the writer thread.
+        std::vector<uint8_t> converted;
+
+        void writerLoop();
+
+        void writeFrame(const Slot &slot);
+    };
+}
+
+#endif //VULKAN_TRY_FRAMEWRITER_H
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cstdarg>
+#include <cstring>
+#include <functional>
+#include "Logger.h"
+
+using namespace vtr;
+
+Logger &Logger::instance() {
+    static Logger logger;
+
+    return logger;
+}
+
+Logger::Logger() {
+    ring = new Entry[RING_SIZE];
+
+    for (uint32_t i = 0; i < RING_SIZE; i++) {
+        ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    startTime = std::chrono::steady_clock::now();
+
+    writer = std::thread(&Logger::writerLoop, this);
+}
+
+Logger::~Logger() {
+    running.store(false, std::memory_order_release);
+
+    if (writer.joinable()) {
+        writer.join();
+    }
+
+    delete[] ring;
+}
+
+void Logger::setMinSeverity(LogSeverity severity) {
+    minSeverity.store(static_cast<uint8_t>(severity), std::memory_order_relaxed);
+}
+
+void Logger::setSink(FILE *file) {
+    flush();
+    sink.store(file, std::memory_order_release);
+}
+
+void Logger::log(LogSeverity severity, const char *format, ...) {
+    uint64_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Entry *entry;
+
+    for (;;) {
+        entry = &ring[pos & (RING_SIZE - 1)];
+        uint64_t sequence = entry->sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<int64_t>(sequence - pos);
+
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Ring is full, the writer is behind. Never wait for it.
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    entry->severity = severity;
+    entry->threadId = currentThreadId();
+    entry->timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - startTime).count();
+
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(entry->message, MESSAGE_SIZE, format, args);
+    va_end(args);
+
+    if (length >= static_cast<int>(MESSAGE_SIZE)) {
+        memcpy(entry->message + MESSAGE_SIZE - 4, "...", 4);
+    }
+
+    entry->sequence.store(pos + 1, std::memory_order_release);
+}
+
+void Logger::flush() {
+    uint64_t target = enqueuePos.load(std::memory_order_acquire);
+
+    while (writtenPos.load(std::memory_order_acquire) < target && writer.joinable()) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    fflush(sink.load(std::memory_order_acquire));
+}
+
+uint64_t Logger::droppedCount() const {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+void Logger::writerLoop() {
+    uint64_t reportedDrops = 0;
+    uint32_t idleRounds = 0;
+
+    while (running.load(std::memory_order_acquire)) {
+        bool wrote = drain();
+
+        uint64_t drops = dropped.load(std::memory_order_relaxed);
+        if (drops != reportedDrops) {
+            fprintf(sink.load(std::memory_order_acquire), "[logger] %llu messages dropped\n",
+                    static_cast<unsigned long long>(drops - reportedDrops));
+            reportedDrops = drops;
+        }
+
+        if (wrote) {
+            idleRounds = 0;
+            fflush(sink.load(std::memory_order_acquire));
+            continue;
+        }
+
+        // Back off gradually, producers never signal the writer.
+        idleRounds = std::min(idleRounds + 1, 10u);
+        std::this_thread::sleep_for(std::chrono::microseconds(50 * idleRounds));
+    }
+
+    drain();
+    fflush(sink.load(std::memory_order_acquire));
+}
+
+bool Logger::drain() {
+    bool wrote = false;
+
+    for (;;) {
+        Entry &entry = ring[dequeuePos & (RING_SIZE - 1)];
+
+        if (entry.sequence.load(std::memory_order_acquire) != dequeuePos + 1) {
+            return wrote;
+        }
+
+        write(entry);
+
+        entry.sequence.store(dequeuePos + RING_SIZE, std::memory_order_release);
+        dequeuePos++;
+        writtenPos.store(dequeuePos, std::memory_order_release);
+
+        wrote = true;
+    }
+}
+
+void Logger::write(const Entry &entry) {
+    static const char *const severityNames[] = {"V", "I", "W", "E"};
+
+    fprintf(sink.load(std::memory_order_acquire), "[%8.3f] [%s] [%u] %s\n", entry.timestamp / 1000.0,
+            severityNames[static_cast<uint8_t>(entry.severity)], entry.threadId, entry.message);
+}
+
+uint32_t Logger::currentThreadId() {
+    static thread_local uint32_t id = static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()) &
+                                                            0xffff);
+
+    return id;
+}
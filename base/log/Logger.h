@@ -0,0 +1,100 @@
+#ifndef VULKAN_TRY_LOGGER_H
+#define VULKAN_TRY_LOGGER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+namespace vtr {
+    enum class LogSeverity : uint8_t {
+        Verbose = 0,
+        Info = 1,
+        Warning = 2,
+        Error = 3
+    };
+
+    /*
+     * Asynchronous logger. Producers format into a slot of a bounded lock-free MPSC ring and return, a background
+     * thread drains the ring into the sink. When the ring is full the message is dropped and counted instead of
+     * blocking the caller, so a burst of validation messages can never stall a frame.
+     */
+    class Logger {
+    public:
+        static const uint32_t RING_SIZE = 1024;
+
+        static const uint32_t MESSAGE_SIZE = 488;
+
+        static Logger &instance();
+
+        Logger(const Logger &) = delete;
+
+        Logger &operator=(const Logger &) = delete;
+
+        ~Logger();
+
+        inline bool isEnabled(LogSeverity severity) const {
+            return static_cast<uint8_t>(severity) >= minSeverity.load(std::memory_order_relaxed);
+        }
+
+        void setMinSeverity(LogSeverity severity);
+
+        void setSink(FILE *file);
+
+        void log(LogSeverity severity, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+        // Blocks until every message pushed before the call has been written.
+        void flush();
+
+        uint64_t droppedCount() const;
+
+    private:
+        struct alignas(64) Entry {
+            std::atomic<uint64_t> sequence;
+            LogSeverity severity;
+            uint32_t threadId;
+            uint64_t timestamp;
+            char message[MESSAGE_SIZE];
+        };
+
+        Entry *ring;
+
+        alignas(64) std::atomic<uint64_t> enqueuePos{0};
+        alignas(64) uint64_t dequeuePos = 0;
+        alignas(64) std::atomic<uint64_t> writtenPos{0};
+
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint8_t> minSeverity{static_cast<uint8_t>(LogSeverity::Info)};
+        std::atomic<FILE *> sink{stderr};
+        std::atomic<bool> running{true};
+
+        std::chrono::steady_clock::time_point startTime;
+
+        std::thread writer;
+
+        Logger();
+
+        void writerLoop();
+
+        bool drain();
+
+        void write(const Entry &entry);
+
+        static uint32_t currentThreadId();
+    };
+}
+
+#define VTR_LOG(severity, ...)                                          \
+    do {                                                                \
+        if (vtr::Logger::instance().isEnabled(severity)) {              \
+            vtr::Logger::instance().log(severity, __VA_ARGS__);         \
+        }                                                               \
+    } while (0)
+
+#define LOG_VERBOSE(...) VTR_LOG(vtr::LogSeverity::Verbose, __VA_ARGS__)
+#define LOG_INFO(...) VTR_LOG(vtr::LogSeverity::Info, __VA_ARGS__)
+#define LOG_WARNING(...) VTR_LOG(vtr::LogSeverity::Warning, __VA_ARGS__)
+#define LOG_ERROR(...) VTR_LOG(vtr::LogSeverity::Error, __VA_ARGS__)
+
+#endif //VULKAN_TRY_LOGGER_H
@@ -0,0 +1,203 @@
+#include <cstdio>
+#include "Profiler.h"
+#include "Logger.h"
+
+namespace vtr {
+    struct Profiler::Lane {
+        std::string name;
+        // Trace thread id, lanes are numbered in creation order.
+        uint32_t id;
+        Chunk *head;
+        Chunk *tail;
+        uint32_t chunkCount;
+    };
+
+    namespace {
+        thread_local Profiler::Lane *currentLane = nullptr;
+
+        void writeString(FILE *file, const char *string) {
+            fputc('"', file);
+
+            for (const char *c = string; *c != '\0'; c++) {
+                if (*c == '"' || *c == '\\') {
+                    fputc('\\', file);
+                    fputc(*c, file);
+                } else if (static_cast<unsigned char>(*c) < 0x20) {
+                    fprintf(file, "\\u%04x", *c);
+                } else {
+                    fputc(*c, file);
+                }
+            }
+
+            fputc('"', file);
+        }
+
+        inline double toMicroseconds(Profiler::Clock::duration duration) {
+            return std::chrono::duration<double, std::micro>(duration).count();
+        }
+    }
+
+    Profiler &Profiler::instance() {
+        static Profiler profiler;
+
+        return profiler;
+    }
+
+    Profiler::Profiler() : start(Clock::now()) {}
+
+    Profiler::~Profiler() {
+        for (auto &lane: lanes) {
+            Chunk *chunk = lane->head;
+
+            while (chunk != nullptr) {
+                Chunk *next = chunk->next.load(std::memory_order_relaxed);
+                delete chunk;
+                chunk = next;
+            }
+        }
+    }
+
+    void Profiler::setEnabled(bool enable) {
+        enabled.store(enable, std::memory_order_relaxed);
+    }
+
+    void Profiler::setThreadName(const char *name) {
+        Lane *lane = threadLane();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        lane->name = name;
+    }
+
+    void Profiler::record(const char *name, Clock::time_point begin, Clock::time_point end) {
+        record(threadLane(), name, begin, end);
+    }
+
+    void Profiler::record(Lane *lane, const char *name, Clock::time_point begin, Clock::time_point end) {
+        Chunk *chunk = lane->tail;
+        uint32_t count = chunk->count.load(std::memory_order_relaxed);
+
+        if (count == CHUNK_EVENTS) {
+            if (lane->chunkCount == MAX_CHUNKS) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            // The only allocation while recording, once every CHUNK_EVENTS zones.
+            Chunk *next = new Chunk();
+            chunk->next.store(next, std::memory_order_release);
+            lane->tail = next;
+            lane->chunkCount++;
+
+            chunk = next;
+            count = 0;
+        }
+
+        chunk->events[count] = {name, begin, end};
+        chunk->count.store(count + 1, std::memory_order_release);
+    }
+
+    Profiler::Lane *Profiler::createLane(const char *name) {
+        return addLane(name);
+    }
+
+    const char *Profiler::intern(const std::string &name) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        return names.insert(name).first->c_str();
+    }
+
+    bool Profiler::writeTrace(const std::string &path) {
+        FILE *file = fopen(path.c_str(), "w");
+
+        if (file == nullptr) {
+            LOG_ERROR("Failed to open %s", path.c_str());
+            return false;
+        }
+
+        std::vector<Lane *> snapshot;
+        std::vector<std::string> laneNames;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            for (auto &lane: lanes) {
+                snapshot.push_back(lane.get());
+                laneNames.push_back(lane->name);
+            }
+        }
+
+        fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+        size_t eventCount = 0;
+        bool first = true;
+
+        for (size_t i = 0; i < snapshot.size(); i++) {
+            const Lane *lane = snapshot[i];
+
+            // Lanes keep their creation order in the viewer instead of being sorted by name.
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                    first ? "" : ",\n", lane->id);
+            writeString(file, laneNames[i].c_str());
+            fprintf(file, "}},\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                          "\"args\":{\"sort_index\":%u}}", lane->id, lane->id);
+            first = false;
+
+            for (const Chunk *chunk = lane->head; chunk != nullptr;
+                 chunk = chunk->next.load(std::memory_order_acquire)) {
+                uint32_t count = chunk->count.load(std::memory_order_acquire);
+
+                for (uint32_t j = 0; j < count; j++) {
+                    const Event &event = chunk->events[j];
+
+                    fprintf(file, ",\n{\"name\":");
+                    writeString(file, event.name);
+                    fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", lane->id,
+                            toMicroseconds(event.begin - start), toMicroseconds(event.end - event.begin));
+                }
+
+                eventCount += count;
+            }
+        }
+
+        fprintf(file, "\n]}\n");
+
+        bool written = ferror(file) == 0;
+        written = fclose(file) == 0 && written;
+
+        if (!written) {
+            LOG_ERROR("Failed to write %s", path.c_str());
+            return false;
+        }
+
+        LOG_INFO("Wrote %zu zones of %zu lanes to %s, %llu dropped", eventCount, snapshot.size(), path.c_str(),
+                 static_cast<unsigned long long>(droppedCount()));
+
+        return true;
+    }
+
+    uint64_t Profiler::droppedCount() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+    Profiler::Lane *Profiler::addLane(const std::string &name) {
+        auto lane = std::unique_ptr<Lane>(new Lane());
+        lane->head = new Chunk();
+        lane->tail = lane->head;
+        lane->chunkCount = 1;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        lane->id = static_cast<uint32_t>(lanes.size() + 1);
+        lane->name = name.empty() ? "thread " + std::to_string(lane->id) : name;
+        lanes.push_back(std::move(lane));
+
+        return lanes.back().get();
+    }
+
+    Profiler::Lane *Profiler::threadLane() {
+        if (currentLane == nullptr) {
+            currentLane = addLane("");
+        }
+
+        return currentLane;
+    }
+}
@@ -0,0 +1,133 @@
+#ifndef VULKAN_TRY_PROFILER_H
+#define VULKAN_TRY_PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace vtr {
+    /*
+     * Scoped zones written out as a Chrome trace. Every thread records into a lane of its own, a list of fixed size
+     * chunks only that thread appends to, so recording never takes a lock or waits for another thread. Lanes that
+     * are no thread, like a GPU queue, are created explicitly and fed by one thread at a time.
+     *
+     * Nothing is recorded until setEnabled(true), a disabled zone costs one relaxed load. Without VTR_PROFILER
+     * PROFILE_ZONE compiles to nothing at all. writeTrace() writes the JSON trace format that chrome://tracing and
+     * Perfetto open.
+     */
+    class Profiler {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // A lane grows by a chunk of CHUNK_EVENTS zones at a time, zones past MAX_CHUNKS are dropped and counted.
+        static const uint32_t CHUNK_EVENTS = 4096;
+
+        static const uint32_t MAX_CHUNKS = 1024;
+
+        struct Lane;
+
+        // Records the enclosing scope on the calling thread's lane.
+        class Zone {
+        public:
+            explicit Zone(const char *name) : name(name) {
+                if (Profiler::instance().isEnabled()) {
+                    active = true;
+                    begin = Clock::now();
+                }
+            }
+
+            Zone(const Zone &) = delete;
+
+            Zone &operator=(const Zone &) = delete;
+
+            ~Zone() {
+                if (active) {
+                    Profiler::instance().record(name, begin, Clock::now());
+                }
+            }
+
+        private:
+            const char *name;
+            bool active = false;
+            Clock::time_point begin;
+        };
+
+        static Profiler &instance();
+
+        Profiler(const Profiler &) = delete;
+
+        Profiler &operator=(const Profiler &) = delete;
+
+        ~Profiler();
+
+        inline bool isEnabled() const {
+            return enabled.load(std::memory_order_relaxed);
+        }
+
+        void setEnabled(bool enable);
+
+        // Shown instead of "thread N" for the calling thread.
+        void setThreadName(const char *name);
+
+        // Names have to outlive the profiler, string literals or intern() results.
+        void record(const char *name, Clock::time_point begin, Clock::time_point end);
+
+        void record(Lane *lane, const char *name, Clock::time_point begin, Clock::time_point end);
+
+        Lane *createLane(const char *name);
+
+        // A copy of name that lives as long as the profiler, equal names share one.
+        const char *intern(const std::string &name);
+
+        // Every zone recorded so far. Threads may keep recording meanwhile, their newer zones are left out.
+        bool writeTrace(const std::string &path);
+
+        uint64_t droppedCount() const;
+
+    private:
+        struct Event {
+            const char *name;
+            Clock::time_point begin;
+            Clock::time_point end;
+        };
+
+        struct Chunk {
+            Event events[CHUNK_EVENTS];
+            // Published with release once the event is written, the trace writer reads up to it.
+            std::atomic<uint32_t> count{0};
+            std::atomic<Chunk *> next{nullptr};
+        };
+
+        std::atomic<bool> enabled{false};
+        std::atomic<uint64_t> dropped{0};
+
+        Clock::time_point start;
+
+        // Guards lane creation, lane names and the interned names, never taken while recording.
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Lane>> lanes;
+        std::set<std::string> names;
+
+        Profiler();
+
+        Lane *addLane(const std::string &name);
+
+        Lane *threadLane();
+    };
+}
+
+#define VTR_PROFILE_CONCAT_INNER(a, b) a##b
+#define VTR_PROFILE_CONCAT(a, b) VTR_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef VTR_PROFILER
+#define PROFILE_ZONE(name) vtr::Profiler::Zone VTR_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name) ((void) 0)
+#endif
+
+#endif //VULKAN_TRY_PROFILER_H
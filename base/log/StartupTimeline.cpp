@@ -0,0 +1,58 @@
+#include <algorithm>
+#include "StartupTimeline.h"
+#include "Logger.h"
+#include "Profiler.h"
+
+namespace vtr {
+    namespace {
+        inline double toMilliseconds(StartupTimeline::Clock::duration duration) {
+            return std::chrono::duration<double, std::milli>(duration).count();
+        }
+    }
+
+    StartupTimeline::StartupTimeline() : start(Clock::now()), mainThread(std::this_thread::get_id()) {}
+
+    void StartupTimeline::record(const char *name, Clock::time_point begin, Clock::time_point end) {
+        // Stages show up in a trace too, on the thread they ran on.
+        Profiler &profiler = Profiler::instance();
+        if (profiler.isEnabled()) {
+            profiler.record(name, begin, end);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        stages.push_back({name, begin, end, std::this_thread::get_id()});
+    }
+
+    double StartupTimeline::elapsed() const {
+        return toMilliseconds(Clock::now() - start);
+    }
+
+    void StartupTimeline::report() {
+        std::vector<Stage> sorted;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            sorted = stages;
+        }
+
+        std::stable_sort(sorted.begin(), sorted.end(), [](const Stage &a, const Stage &b) {
+            return a.begin < b.begin;
+        });
+
+        // Stages off the main thread are numbered by first appearance, enough to tell overlapping ones apart.
+        std::vector<std::thread::id> threads = {mainThread};
+
+        LOG_INFO("Startup timeline, %.1f ms", elapsed());
+
+        for (const Stage &stage: sorted) {
+            auto found = std::find(threads.begin(), threads.end(), stage.thread);
+            auto threadIndex = static_cast<size_t>(found - threads.begin());
+            if (found == threads.end()) {
+                threads.push_back(stage.thread);
+            }
+
+            LOG_INFO("  %-20s %8.1f .. %8.1f ms %8.1f ms  %s %zu", stage.name, toMilliseconds(stage.begin - start),
+                     toMilliseconds(stage.end - start), toMilliseconds(stage.end - stage.begin),
+                     threadIndex == 0 ? "main  " : "thread", threadIndex);
+        }
+    }
+}
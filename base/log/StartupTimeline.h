@@ -0,0 +1,71 @@
+#ifndef VULKAN_TRY_STARTUPTIMELINE_H
+#define VULKAN_TRY_STARTUPTIMELINE_H
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace vtr {
+    /*
+     * Wall clock start and end of every startup stage, relative to construction. Stages may run on any thread and
+     * overlap, report() logs them in start order together with the thread they ran on. While the profiler is
+     * enabled every stage is recorded as a zone as well.
+     */
+    class StartupTimeline {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // Records the enclosing scope as one stage.
+        class Scope {
+        public:
+            Scope(StartupTimeline &timeline, const char *name) : timeline(timeline), name(name),
+                                                                 begin(Clock::now()) {}
+
+            Scope(const Scope &) = delete;
+
+            Scope &operator=(const Scope &) = delete;
+
+            ~Scope() {
+                timeline.record(name, begin, Clock::now());
+            }
+
+        private:
+            StartupTimeline &timeline;
+            const char *name;
+            Clock::time_point begin;
+        };
+
+        StartupTimeline();
+
+        void record(const char *name, Clock::time_point begin, Clock::time_point end);
+
+        template<typename F>
+        void stage(const char *name, F &&function) {
+            Scope scope(*this, name);
+            std::forward<F>(function)();
+        }
+
+        // Milliseconds since construction.
+        double elapsed() const;
+
+        void report();
+
+    private:
+        struct Stage {
+            const char *name;
+            Clock::time_point begin;
+            Clock::time_point end;
+            std::thread::id thread;
+        };
+
+        Clock::time_point start;
+        std::thread::id mainThread;
+
+        std::mutex mutex;
+        std::vector<Stage> stages;
+    };
+}
+
+#endif //VULKAN_TRY_STARTUPTIMELINE_H
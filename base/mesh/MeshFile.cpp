@@ -0,0 +1,95 @@
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "MeshFile.h"
+
+using namespace vtr;
+
+MeshFile::MeshFile(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        throw std::runtime_error("failed to open mesh file " + path);
+    }
+
+    struct stat fileStat = {};
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size < static_cast<off_t>(sizeof(MeshFileHeader))) {
+        close(fd);
+        throw std::runtime_error("mesh file is too small " + path);
+    }
+
+    size = static_cast<size_t>(fileStat.st_size);
+    mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping keeps its own reference to the file.
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw std::runtime_error("failed to map mesh file " + path);
+    }
+
+    // Streams are read front to back exactly once, during upload.
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    madvise(mapping, size, MADV_WILLNEED);
+
+    try {
+        validate(path);
+    } catch (...) {
+        munmap(mapping, size);
+        throw;
+    }
+}
+
+MeshFile::~MeshFile() {
+    if (mapping != nullptr) {
+        munmap(mapping, size);
+    }
+}
+
+void MeshFile::validate(const std::string &path) const {
+    const MeshFileHeader &header = getHeader();
+
+    if (header.magic != MESH_MAGIC) {
+        throw std::runtime_error("not a mesh file " + path);
+    }
+
+    if (header.version != MESH_VERSION) {
+        throw std::runtime_error("unsupported mesh file version " + std::to_string(header.version) + " in " + path);
+    }
+
+    uint32_t stride = meshVertexStride(header.vertexFormat);
+    if (stride == 0 || stride != header.vertexStride) {
+        throw std::runtime_error("unknown vertex format in " + path);
+    }
+
+    if (meshIndexSize(header.indexType) == 0) {
+        throw std::runtime_error("unknown index type in " + path);
+    }
+
+    // Nothing to draw, and Vulkan has no empty buffers.
+    if (header.vertexCount == 0 || header.indexCount == 0) {
+        throw std::runtime_error("empty mesh file " + path);
+    }
+
+    auto inside = [this](uint64_t offset, uint64_t length) {
+        return offset % MESH_STREAM_ALIGNMENT == 0 && offset <= size && length <= size - offset;
+    };
+
+    if (header.vertexSize != static_cast<uint64_t>(header.vertexCount) * header.vertexStride ||
+        header.indexSize != static_cast<uint64_t>(header.indexCount) * meshIndexSize(header.indexType) ||
+        !inside(header.vertexOffset, header.vertexSize) || !inside(header.indexOffset, header.indexSize) ||
+        !inside(header.lodOffset, static_cast<uint64_t>(header.lodCount) * sizeof(MeshLod))) {
+        throw std::runtime_error("corrupt mesh file " + path);
+    }
+
+    for (uint32_t i = 0; i < header.lodCount; i++) {
+        const MeshLod &lod = getLods()[i];
+
+        if (static_cast<uint64_t>(lod.indexOffset) + lod.indexCount > header.indexCount) {
+            throw std::runtime_error("corrupt LOD table in " + path);
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef VULKAN_TRY_MESHFILE_H
+#define VULKAN_TRY_MESHFILE_H
+
+#include <cstddef>
+#include <string>
+#include "MeshFormat.h"
+
+namespace vtr {
+    /*
+     * Read only memory mapping of a mesh container. Stream pointers point into the mapping and stay valid for the
+     * lifetime of the object, nothing is copied on load.
+     */
+    class MeshFile {
+    public:
+        explicit MeshFile(const std::string &path);
+
+        MeshFile(const MeshFile &) = delete;
+
+        MeshFile &operator=(const MeshFile &) = delete;
+
+        ~MeshFile();
+
+        inline const MeshFileHeader &getHeader() const {
+            return *static_cast<const MeshFileHeader *>(mapping);
+        }
+
+        inline const void *getVertexData() const {
+            return static_cast<const uint8_t *>(mapping) + getHeader().vertexOffset;
+        }
+
+        inline const void *getIndexData() const {
+            return static_cast<const uint8_t *>(mapping) + getHeader().indexOffset;
+        }
+
+        inline const MeshLod *getLods() const {
+            return reinterpret_cast<const MeshLod *>(static_cast<const uint8_t *>(mapping) + getHeader().lodOffset);
+        }
+
+    private:
+        void *mapping = nullptr;
+
+        size_t size = 0;
+
+        void validate(const std::string &path) const;
+    };
+}
+
+#endif //VULKAN_TRY_MESHFILE_H
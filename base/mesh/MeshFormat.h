@@ -0,0 +1,122 @@
+#ifndef VULKAN_TRY_MESHFORMAT_H
+#define VULKAN_TRY_MESHFORMAT_H
+
+#include <cstdint>
+
+/*
+ * On disk mesh container, little endian:
+ *
+ *   MeshFileHeader | MeshLod[lodCount] | vertex stream | index stream
+ *
+ * Streams start on MESH_STREAM_ALIGNMENT boundaries so they can be copied from a file mapping straight into
+ * GPU staging memory. Readers reject files whose version they do not know.
+ */
+namespace vtr {
+    const uint32_t MESH_MAGIC = 0x4853454d; // "MESH"
+
+    const uint32_t MESH_VERSION = 1;
+
+    const uint32_t MESH_STREAM_ALIGNMENT = 16;
+
+    // Levels of detail a file may carry, readers ignore any beyond.
+    const uint32_t MESH_MAX_LODS = 8;
+
+    enum MeshVertexFormat : uint32_t {
+        // vec3 position, 12 bytes.
+        MESH_VERTEX_POSITION_F32 = 0,
+        // MeshVertexStandard, 32 bytes.
+        MESH_VERTEX_STANDARD_F32 = 1,
+        // MeshVertexQuantized, 16 bytes.
+        MESH_VERTEX_QUANTIZED = 2,
+
+        MESH_VERTEX_FORMAT_COUNT
+    };
+
+    enum MeshIndexType : uint32_t {
+        MESH_INDEX_UINT16 = 0,
+        MESH_INDEX_UINT32 = 1
+    };
+
+    struct MeshVertexStandard {
+        float position[3];
+        float normal[3];
+        float uv[2];
+    };
+
+    /*
+     * Positions are unorm16 over the mesh bounds, position = boundsMin + value * (boundsMax - boundsMin), the fourth
+     * component only pads to 8 bytes. Normals are octahedral encoded snorm16 and uvs half floats.
+     */
+    struct MeshVertexQuantized {
+        uint16_t position[4];
+        int16_t normal[2];
+        uint16_t uv[2];
+    };
+
+    // One entry per level of detail, LOD 0 is the full mesh. Ranges index into the shared index stream.
+    struct MeshLod {
+        uint32_t indexOffset;
+        uint32_t indexCount;
+        // Object space error introduced by this level, 0 for LOD 0.
+        float error;
+        uint32_t reserved;
+    };
+
+    struct MeshFileHeader {
+        uint32_t magic;
+        uint32_t version;
+
+        uint32_t vertexFormat;
+        uint32_t vertexStride;
+        uint32_t vertexCount;
+
+        uint32_t indexType;
+        uint32_t indexCount;
+
+        uint32_t lodCount;
+
+        uint64_t lodOffset;
+        uint64_t vertexOffset;
+        uint64_t vertexSize;
+        uint64_t indexOffset;
+        uint64_t indexSize;
+
+        float boundsMin[3];
+        float boundsMax[3];
+        // xyz center, w radius.
+        float boundingSphere[4];
+
+        uint32_t reserved[4];
+    };
+
+    static_assert(sizeof(MeshVertexStandard) == 32, "MeshVertexStandard layout changed");
+    static_assert(sizeof(MeshVertexQuantized) == 16, "MeshVertexQuantized layout changed");
+    static_assert(sizeof(MeshLod) == 16, "MeshLod layout changed");
+    static_assert(sizeof(MeshFileHeader) == 128, "MeshFileHeader layout changed");
+
+    inline uint32_t meshVertexStride(uint32_t vertexFormat) {
+        switch (vertexFormat) {
+            case MESH_VERTEX_POSITION_F32:
+                return 12;
+            case MESH_VERTEX_STANDARD_F32:
+                return sizeof(MeshVertexStandard);
+            case MESH_VERTEX_QUANTIZED:
+                return sizeof(MeshVertexQuantized);
+            default:
+                return 0;
+        }
+    }
+
+    inline uint32_t meshIndexSize(uint32_t indexType) {
+        switch (indexType) {
+            case MESH_INDEX_UINT16:
+                return 2;
+            case MESH_INDEX_UINT32:
+                return 4;
+            default:
+                return 0;
+        }
+    }
+}
+
+#endif //VULKAN_TRY_MESHFORMAT_H
@@ -0,0 +1,136 @@
+#ifndef VULKAN_TRY_MESHQUANTIZATION_H
+#define VULKAN_TRY_MESHQUANTIZATION_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+/*
+ * Encoders for MESH_VERTEX_QUANTIZED. The matching decoders live in visual/shaders/shader_quantized.vert, the
+ * CPU ones here are only used to check round trips.
+ */
+namespace vtr {
+    inline uint16_t quantizeUnorm16(float value, float min, float extent) {
+        if (extent <= 0.0f) {
+            return 0;
+        }
+
+        float normalized = (value - min) / extent;
+        normalized = normalized < 0.0f ? 0.0f : (normalized > 1.0f ? 1.0f : normalized);
+
+        return static_cast<uint16_t>(std::lround(normalized * 65535.0f));
+    }
+
+    inline int16_t quantizeSnorm16(float value) {
+        value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+
+        return static_cast<int16_t>(std::lround(value * 32767.0f));
+    }
+
+    // Maps the unit sphere onto the [-1, 1] square, the lower hemisphere is folded over the diagonals.
+    inline void encodeOctahedral(const float normal[3], int16_t encoded[2]) {
+        float length = std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]);
+
+        if (length == 0.0f) {
+            encoded[0] = 0;
+            encoded[1] = 0;
+            return;
+        }
+
+        float x = normal[0] / length;
+        float y = normal[1] / length;
+
+        if (normal[2] < 0.0f) {
+            float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = foldedX;
+            y = foldedY;
+        }
+
+        encoded[0] = quantizeSnorm16(x);
+        encoded[1] = quantizeSnorm16(y);
+    }
+
+    inline void decodeOctahedral(const int16_t encoded[2], float normal[3]) {
+        float x = std::fmax(encoded[0] / 32767.0f, -1.0f);
+        float y = std::fmax(encoded[1] / 32767.0f, -1.0f);
+        float z = 1.0f - std::fabs(x) - std::fabs(y);
+
+        float fold = std::fmax(-z, 0.0f);
+        x += x >= 0.0f ? -fold : fold;
+        y += y >= 0.0f ? -fold : fold;
+
+        float length = std::sqrt(x * x + y * y + z * z);
+        normal[0] = x / length;
+        normal[1] = y / length;
+        normal[2] = z / length;
+    }
+
+    // IEEE 754 binary16, round to nearest even. Out of range values become infinity.
+    inline uint16_t floatToHalf(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        uint32_t sign = (bits >> 16) & 0x8000u;
+        uint32_t floatExponent = (bits >> 23) & 0xffu;
+        uint32_t mantissa = bits & 0x7fffffu;
+
+        if (floatExponent == 0xffu) {
+            return static_cast<uint16_t>(sign | 0x7c00u | (mantissa != 0 ? 0x200u : 0u));
+        }
+
+        int32_t exponent = static_cast<int32_t>(floatExponent) - 127 + 15;
+
+        if (exponent >= 31) {
+            return static_cast<uint16_t>(sign | 0x7c00u);
+        }
+
+        if (exponent <= 0) {
+            if (exponent < -10) {
+                return static_cast<uint16_t>(sign);
+            }
+
+            // Subnormal, shift the implicit bit in.
+            mantissa |= 0x800000u;
+            uint32_t shift = static_cast<uint32_t>(14 - exponent);
+            uint32_t half = mantissa >> shift;
+            uint32_t remainder = mantissa & ((1u << shift) - 1u);
+            uint32_t halfway = 1u << (shift - 1u);
+
+            if (remainder > halfway || (remainder == halfway && (half & 1u) != 0)) {
+                half++;
+            }
+
+            return static_cast<uint16_t>(sign | half);
+        }
+
+        uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+        uint32_t remainder = mantissa & 0x1fffu;
+
+        // A carry out of the mantissa correctly bumps the exponent.
+        if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u) != 0)) {
+            half++;
+        }
+
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    inline float halfToFloat(uint16_t half) {
+        uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+        uint32_t exponent = (half >> 10) & 0x1fu;
+        uint32_t mantissa = half & 0x3ffu;
+
+        float magnitude;
+        if (exponent == 0) {
+            magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+        } else if (exponent == 31) {
+            magnitude = mantissa == 0 ? INFINITY : NAN;
+        } else {
+            magnitude = std::ldexp(static_cast<float>(mantissa | 0x400u), static_cast<int>(exponent) - 25);
+        }
+
+        return sign != 0 ? -magnitude : magnitude;
+    }
+}
+
+#endif //VULKAN_TRY_MESHQUANTIZATION_H
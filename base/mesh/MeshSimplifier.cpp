@@ -0,0 +1,481 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include "MeshSimplifier.h"
+
+using namespace vtr;
+
+namespace {
+    // Symmetric 4x4 matrix summing squared distances to planes, a2 ab ac ad b2 bc bd c2 cd d2.
+    struct Quadric {
+        double m[10];
+
+        void addPlane(double a, double b, double c, double d) {
+            m[0] += a * a;
+            m[1] += a * b;
+            m[2] += a * c;
+            m[3] += a * d;
+            m[4] += b * b;
+            m[5] += b * c;
+            m[6] += b * d;
+            m[7] += c * c;
+            m[8] += c * d;
+            m[9] += d * d;
+        }
+
+        void add(const Quadric &other) {
+            for (int i = 0; i < 10; i++) {
+                m[i] += other.m[i];
+            }
+        }
+
+        double evaluate(const float *p) const {
+            double x = p[0], y = p[1], z = p[2];
+            double error = m[0] * x * x + 2.0 * m[1] * x * y + 2.0 * m[2] * x * z + 2.0 * m[3] * x +
+                           m[4] * y * y + 2.0 * m[5] * y * z + 2.0 * m[6] * y +
+                           m[7] * z * z + 2.0 * m[8] * z + m[9];
+
+            return error > 0.0 ? error : 0.0;
+        }
+    };
+
+    struct Collapse {
+        double cost;
+        uint32_t from;
+        uint32_t to;
+
+        bool operator<(const Collapse &other) const {
+            return cost < other.cost;
+        }
+    };
+
+    inline uint64_t edgeKey(uint32_t a, uint32_t b) {
+        return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+    }
+
+    void triangleNormal(const float *a, const float *b, const float *c, float *normal) {
+        float ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+        float ac[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+
+        normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+        normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+        normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+    }
+
+    // The first vertex at each position, so vertices split only by their attributes share one position in the
+    // topology. Positions compare bitwise, like the converter that split them.
+    std::vector<uint32_t> weldPositions(const float *positions, uint32_t vertexCount) {
+        std::vector<uint32_t> order(vertexCount);
+        for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+            order[vertex] = vertex;
+        }
+
+        auto bits = [positions](uint32_t vertex, int axis) {
+            uint32_t value;
+            memcpy(&value, &positions[vertex * 3 + axis], sizeof(value));
+            return value;
+        };
+
+        auto less = [&bits](uint32_t a, uint32_t b) {
+            for (int axis = 0; axis < 3; axis++) {
+                if (bits(a, axis) != bits(b, axis)) {
+                    return bits(a, axis) < bits(b, axis);
+                }
+            }
+            return a < b;
+        };
+        std::sort(order.begin(), order.end(), less);
+
+        std::vector<uint32_t> weld(vertexCount);
+        for (uint32_t i = 0; i < vertexCount; i++) {
+            bool same = i > 0 && bits(order[i], 0) == bits(order[i - 1], 0) &&
+                        bits(order[i], 1) == bits(order[i - 1], 1) && bits(order[i], 2) == bits(order[i - 1], 2);
+
+            weld[order[i]] = same ? weld[order[i - 1]] : order[i];
+        }
+
+        return weld;
+    }
+
+    // Welded positions that have to stay put, the ends of edges not shared by exactly two triangles.
+    std::vector<bool> findBorderVertices(uint32_t vertexCount, const std::vector<uint32_t> &welded) {
+        std::vector<bool> locked(vertexCount, false);
+
+        std::vector<uint64_t> edges;
+        edges.reserve(welded.size());
+        for (size_t i = 0; i + 2 < welded.size(); i += 3) {
+            for (int corner = 0; corner < 3; corner++) {
+                edges.push_back(edgeKey(welded[i + corner], welded[i + (corner + 1) % 3]));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+
+        for (size_t begin = 0; begin < edges.size();) {
+            size_t end = begin;
+            while (end < edges.size() && edges[end] == edges[begin]) {
+                end++;
+            }
+
+            if (end - begin != 2) {
+                locked[static_cast<uint32_t>(edges[begin] >> 32)] = true;
+                locked[static_cast<uint32_t>(edges[begin])] = true;
+            }
+
+            begin = end;
+        }
+
+        return locked;
+    }
+
+    /*
+     * Every vertex at position from used by the triangles around it, paired with the vertex at position to it moves
+     * onto: the one it shares a triangle with along the collapsed edge. False when a vertex has none, or two that
+     * differ, the collapse would tear an attribute seam crossing from then.
+     *
+     * A vertex used by a single triangle only has attributes of that face, flat shading splits every vertex like
+     * that. Without a match it moves onto a vertex at to of a neighbouring face and takes over its attributes.
+     */
+    bool carryCollapse(const std::vector<uint32_t> &indices, const std::vector<uint32_t> &welded,
+                       const std::vector<uint32_t> &adjacencyOffsets, const std::vector<uint32_t> &adjacency,
+                       uint32_t from, uint32_t to, std::vector<std::pair<uint32_t, uint32_t>> &carried) {
+        carried.clear();
+
+        for (uint32_t i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; i++) {
+            size_t triangle = adjacency[i] * size_t(3);
+            uint32_t vertex = UINT32_MAX, target = UINT32_MAX;
+
+            for (int corner = 0; corner < 3; corner++) {
+                if (welded[triangle + corner] == from) {
+                    vertex = indices[triangle + corner];
+                } else if (welded[triangle + corner] == to) {
+                    target = indices[triangle + corner];
+                }
+            }
+
+            if (target == UINT32_MAX) {
+                continue;
+            }
+
+            auto found = std::find_if(carried.begin(), carried.end(),
+                                      [vertex](const std::pair<uint32_t, uint32_t> &p) {
+                                          return p.first == vertex;
+                                      });
+
+            if (found == carried.end()) {
+                carried.emplace_back(vertex, target);
+            } else if (found->second != target) {
+                return false;
+            }
+        }
+
+        // Triangles that survive the collapse need their vertex carried as well.
+        for (uint32_t i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; i++) {
+            size_t triangle = adjacency[i] * size_t(3);
+
+            for (int corner = 0; corner < 3; corner++) {
+                if (welded[triangle + corner] != from) {
+                    continue;
+                }
+
+                uint32_t vertex = indices[triangle + corner];
+                auto found = std::find_if(carried.begin(), carried.end(),
+                                          [vertex](const std::pair<uint32_t, uint32_t> &p) {
+                                              return p.first == vertex;
+                                          });
+
+                if (found != carried.end()) {
+                    continue;
+                }
+
+                uint32_t uses = 0;
+                for (uint32_t j = adjacencyOffsets[from]; j < adjacencyOffsets[from + 1]; j++) {
+                    const uint32_t *other = &indices[adjacency[j] * size_t(3)];
+                    uses += other[0] == vertex || other[1] == vertex || other[2] == vertex;
+                }
+
+                if (uses > 1) {
+                    return false;
+                }
+
+                // The edge is in at least one triangle, so something was carried.
+                carried.emplace_back(vertex, carried.front().second);
+            }
+        }
+
+        return true;
+    }
+
+    // Moving from onto to must not turn any remaining triangle around from upside down.
+    bool flipsTriangle(const float *positions, const std::vector<uint32_t> &indices,
+                       const std::vector<uint32_t> &adjacencyOffsets, const std::vector<uint32_t> &adjacency,
+                       uint32_t from, uint32_t to) {
+        for (uint32_t i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; i++) {
+            const uint32_t *triangle = &indices[adjacency[i] * 3];
+
+            if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+                continue;
+            }
+
+            float before[3], after[3];
+            const float *corners[3];
+            for (int corner = 0; corner < 3; corner++) {
+                corners[corner] = &positions[triangle[corner] * 3];
+            }
+            triangleNormal(corners[0], corners[1], corners[2], before);
+
+            for (int corner = 0; corner < 3; corner++) {
+                if (triangle[corner] == from) {
+                    corners[corner] = &positions[to * 3];
+                }
+            }
+            triangleNormal(corners[0], corners[1], corners[2], after);
+
+            if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0f) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
+
+std::vector<uint32_t> MeshSimplifier::simplify(const float *positions, uint32_t vertexCount, const uint32_t *indices,
+                                               size_t indexCount, size_t targetIndexCount, float maxError,
+                                               float &error) {
+    std::vector<uint32_t> result(indices, indices + indexCount - indexCount % 3);
+    error = 0.0f;
+
+    for (uint32_t index: result) {
+        if (index >= vertexCount) {
+            throw std::runtime_error("mesh index out of range");
+        }
+    }
+
+    // Topology, quadrics and collapses work on welded positions, result keeps the vertices with their attributes.
+    // Triangles with two corners at one position have no area and are dropped up front.
+    std::vector<uint32_t> weld = weldPositions(positions, vertexCount);
+    std::vector<uint32_t> welded;
+    welded.reserve(result.size());
+
+    size_t kept = 0;
+    for (size_t i = 0; i < result.size(); i += 3) {
+        uint32_t a = weld[result[i]], b = weld[result[i + 1]], c = weld[result[i + 2]];
+
+        if (a != b && b != c && a != c) {
+            welded.insert(welded.end(), {a, b, c});
+            result[kept++] = result[i];
+            result[kept++] = result[i + 1];
+            result[kept++] = result[i + 2];
+        }
+    }
+    result.resize(kept);
+
+    // One unit weighted plane per triangle, so the square root of a cost bounds the distance to every plane.
+    std::vector<Quadric> quadrics(vertexCount, Quadric());
+    for (size_t i = 0; i < welded.size(); i += 3) {
+        const float *a = &positions[welded[i] * 3];
+        float normal[3];
+        triangleNormal(a, &positions[welded[i + 1] * 3], &positions[welded[i + 2] * 3], normal);
+
+        double length = std::sqrt(double(normal[0]) * normal[0] + double(normal[1]) * normal[1] +
+                                  double(normal[2]) * normal[2]);
+        if (length == 0.0) {
+            continue;
+        }
+
+        double nx = normal[0] / length, ny = normal[1] / length, nz = normal[2] / length;
+        double d = -(nx * a[0] + ny * a[1] + nz * a[2]);
+
+        for (int corner = 0; corner < 3; corner++) {
+            quadrics[welded[i + corner]].addPlane(nx, ny, nz, d);
+        }
+    }
+
+    std::vector<bool> locked = findBorderVertices(vertexCount, welded);
+    double maxCost = double(maxError) * maxError;
+
+    std::vector<uint64_t> edges;
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<bool> touched(vertexCount);
+    std::vector<std::pair<uint32_t, uint32_t>> carried;
+
+    while (result.size() > targetIndexCount) {
+        size_t triangleCount = result.size() / 3;
+
+        edges.clear();
+        for (size_t i = 0; i < welded.size(); i += 3) {
+            for (int corner = 0; corner < 3; corner++) {
+                edges.push_back(edgeKey(welded[i + corner], welded[i + (corner + 1) % 3]));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        collapses.clear();
+        for (uint64_t edge: edges) {
+            auto a = static_cast<uint32_t>(edge >> 32);
+            auto b = static_cast<uint32_t>(edge);
+
+            Quadric combined = quadrics[a];
+            combined.add(quadrics[b]);
+
+            double costToB = locked[a] ? DBL_MAX : combined.evaluate(&positions[b * 3]);
+            double costToA = locked[b] ? DBL_MAX : combined.evaluate(&positions[a * 3]);
+
+            if (costToB <= costToA && costToB <= maxCost) {
+                collapses.push_back({costToB, a, b});
+            } else if (costToA < costToB && costToA <= maxCost) {
+                collapses.push_back({costToA, b, a});
+            }
+        }
+
+        if (collapses.empty()) {
+            break;
+        }
+
+        std::sort(collapses.begin(), collapses.end());
+
+        // Triangles around each welded position, for the flip test and carrying collapses.
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (uint32_t index: welded) {
+            adjacencyOffsets[index + 1]++;
+        }
+        for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+            adjacencyOffsets[vertex + 1] += adjacencyOffsets[vertex];
+        }
+
+        adjacency.resize(welded.size());
+        std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < welded.size(); i++) {
+            adjacency[cursor[welded[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+            remap[vertex] = vertex;
+        }
+        std::fill(touched.begin(), touched.end(), false);
+
+        size_t removeGoal = triangleCount - targetIndexCount / 3;
+        size_t removed = 0;
+        bool collapsed = false;
+
+        for (const Collapse &collapse: collapses) {
+            if (touched[collapse.from] || touched[collapse.to] ||
+                flipsTriangle(positions, welded, adjacencyOffsets, adjacency, collapse.from, collapse.to) ||
+                !carryCollapse(result, welded, adjacencyOffsets, adjacency, collapse.from, collapse.to, carried)) {
+                continue;
+            }
+
+            for (const auto &pair: carried) {
+                remap[pair.first] = pair.second;
+            }
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            error = std::max(error, static_cast<float>(std::sqrt(collapse.cost)));
+            collapsed = true;
+
+            // Freezes the neighbourhood, later collapses of this pass were tested against the old one.
+            for (uint32_t i = adjacencyOffsets[collapse.from]; i < adjacencyOffsets[collapse.from + 1]; i++) {
+                const uint32_t *triangle = &welded[adjacency[i] * 3];
+                bool shared = false;
+
+                for (int corner = 0; corner < 3; corner++) {
+                    touched[triangle[corner]] = true;
+                    shared |= triangle[corner] == collapse.to;
+                }
+
+                removed += shared ? 1 : 0;
+            }
+
+            if (removed >= removeGoal) {
+                break;
+            }
+        }
+
+        if (!collapsed) {
+            break;
+        }
+
+        kept = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            uint32_t a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+
+            if (weld[a] != weld[b] && weld[b] != weld[c] && weld[a] != weld[c]) {
+                welded[kept] = weld[a];
+                result[kept++] = a;
+                welded[kept] = weld[b];
+                result[kept++] = b;
+                welded[kept] = weld[c];
+                result[kept++] = c;
+            }
+        }
+        result.resize(kept);
+        welded.resize(kept);
+    }
+
+    return result;
+}
+
+void MeshSimplifier::buildLodChain(const float *positions, uint32_t vertexCount, std::vector<uint32_t> &indices,
+                                   std::vector<MeshLod> &lods, uint32_t maxLodCount) {
+    lods.clear();
+    lods.push_back({0, static_cast<uint32_t>(indices.size()), 0.0f, 0});
+
+    while (lods.size() < maxLodCount) {
+        const MeshLod previous = lods.back();
+        size_t target = previous.indexCount / 6 * 3;
+
+        if (target / 3 < MIN_LOD_TRIANGLES) {
+            break;
+        }
+
+        float error;
+        std::vector<uint32_t> level = simplify(positions, vertexCount, indices.data() + previous.indexOffset,
+                                               previous.indexCount, target, FLT_MAX, error);
+
+        // Borders and attribute seams can stall the reduction, a level that barely shrinks is not worth its indices.
+        if (level.empty() || level.size() > previous.indexCount * 3 / 4) {
+            break;
+        }
+
+        lods.push_back({static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(level.size()),
+                        previous.error + error, 0});
+        indices.insert(indices.end(), level.begin(), level.end());
+    }
+}
+
+std::vector<float> MeshSimplifier::decodePositions(const MeshFileHeader &header, const void *vertexData) {
+    std::vector<float> positions(static_cast<size_t>(header.vertexCount) * 3);
+    const auto *vertices = static_cast<const uint8_t *>(vertexData);
+
+    for (uint32_t i = 0; i < header.vertexCount; i++) {
+        const uint8_t *vertex = vertices + static_cast<size_t>(i) * header.vertexStride;
+        float *position = &positions[i * 3];
+
+        switch (header.vertexFormat) {
+            case MESH_VERTEX_POSITION_F32:
+            case MESH_VERTEX_STANDARD_F32:
+                memcpy(position, vertex, sizeof(float) * 3);
+                break;
+            case MESH_VERTEX_QUANTIZED: {
+                MeshVertexQuantized quantized;
+                memcpy(&quantized, vertex, sizeof(quantized));
+
+                for (int axis = 0; axis < 3; axis++) {
+                    float extent = header.boundsMax[axis] - header.boundsMin[axis];
+                    position[axis] = header.boundsMin[axis] + quantized.position[axis] / 65535.0f * extent;
+                }
+                break;
+            }
+            default:
+                throw std::runtime_error("unknown mesh vertex format");
+        }
+    }
+
+    return positions;
+}
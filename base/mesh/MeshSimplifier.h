@@ -0,0 +1,44 @@
+#ifndef VULKAN_TRY_MESHSIMPLIFIER_H
+#define VULKAN_TRY_MESHSIMPLIFIER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "MeshFormat.h"
+
+namespace vtr {
+    /*
+     * Quadric error edge collapse on indexed triangle lists. Collapses move a vertex onto a neighbour, so simplified
+     * levels index the original vertex array and every LOD of a mesh shares one vertex buffer. Topology is built on
+     * welded positions, a collapse moves every vertex at its position onto the vertex across the edge with the same
+     * attributes. Collapses that would tear an attribute seam are skipped, only vertices of a single face, as flat
+     * shading makes them, take over a neighbour's attributes. Open borders never move.
+     *
+     * Every pass ranks all edges by the quadric error of their cheaper collapse direction and applies the cheapest
+     * ones that touch no neighbourhood changed earlier in the pass, rejecting collapses that flip a triangle.
+     */
+    class MeshSimplifier {
+    public:
+        // Levels after LOD 0 halve the triangle count until it would drop below this.
+        static const uint32_t MIN_LOD_TRIANGLES = 16;
+
+        // Returns the indices of a simplification with at most targetIndexCount indices, or the fewest reachable
+        // without collapses costing more than maxError. error is set to the largest object space distance a
+        // collapse moved the surface by.
+        static std::vector<uint32_t> simplify(const float *positions, uint32_t vertexCount, const uint32_t *indices,
+                                              size_t indexCount, size_t targetIndexCount, float maxError,
+                                              float &error);
+
+        // Appends simplified levels of the LOD 0 indices in indices to indices, each level is simplified from the
+        // previous one and its error adds up along the chain. lods receives every level, LOD 0 included, at most
+        // maxLodCount of them. The chain ends at the first level that is not at least a quarter smaller.
+        static void buildLodChain(const float *positions, uint32_t vertexCount, std::vector<uint32_t> &indices,
+                                  std::vector<MeshLod> &lods, uint32_t maxLodCount = MESH_MAX_LODS);
+
+        // Object space xyz positions of a vertex stream in any MeshVertexFormat, quantized ones are expanded over
+        // the header bounds.
+        static std::vector<float> decodePositions(const MeshFileHeader &header, const void *vertexData);
+    };
+}
+
+#endif //VULKAN_TRY_MESHSIMPLIFIER_H
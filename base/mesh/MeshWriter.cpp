@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "MeshWriter.h"
+#include "MeshQuantization.h"
+
+using namespace vtr;
+
+namespace {
+    uint64_t alignStream(uint64_t offset) {
+        return (offset + MESH_STREAM_ALIGNMENT - 1) / MESH_STREAM_ALIGNMENT * MESH_STREAM_ALIGNMENT;
+    }
+
+    void computeBounds(const std::vector<float> &positions, MeshFileHeader &header) {
+        float min[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+        float max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+        for (size_t i = 0; i + 2 < positions.size(); i += 3) {
+            for (int axis = 0; axis < 3; axis++) {
+                min[axis] = std::min(min[axis], positions[i + axis]);
+                max[axis] = std::max(max[axis], positions[i + axis]);
+            }
+        }
+
+        if (positions.empty()) {
+            std::fill(min, min + 3, 0.0f);
+            std::fill(max, max + 3, 0.0f);
+        }
+
+        float radius = 0.0f;
+        for (size_t i = 0; i + 2 < positions.size(); i += 3) {
+            float distance = 0.0f;
+            for (int axis = 0; axis < 3; axis++) {
+                float delta = positions[i + axis] - (min[axis] + max[axis]) * 0.5f;
+                distance += delta * delta;
+            }
+            radius = std::max(radius, distance);
+        }
+
+        for (int axis = 0; axis < 3; axis++) {
+            header.boundsMin[axis] = min[axis];
+            header.boundsMax[axis] = max[axis];
+            header.boundingSphere[axis] = (min[axis] + max[axis]) * 0.5f;
+        }
+        header.boundingSphere[3] = std::sqrt(radius);
+    }
+}
+
+std::vector<uint8_t> vtr::packVertices(const MeshData &mesh, const MeshFileHeader &header) {
+    uint32_t stride = meshVertexStride(mesh.vertexFormat);
+    size_t count = mesh.vertexCount;
+
+    if (stride == 0) {
+        throw std::runtime_error("unknown mesh vertex format");
+    }
+
+    if (mesh.positions.size() != count * 3 || (!mesh.normals.empty() && mesh.normals.size() != count * 3) ||
+        (!mesh.uvs.empty() && mesh.uvs.size() != count * 2)) {
+        throw std::runtime_error("mesh attributes do not match its vertex count");
+    }
+
+    std::vector<uint8_t> vertices(count * stride);
+    const float up[3] = {0.0f, 0.0f, 1.0f};
+    const float zero[2] = {0.0f, 0.0f};
+
+    for (size_t i = 0; i < count; i++) {
+        const float *position = &mesh.positions[i * 3];
+        const float *normal = mesh.normals.empty() ? up : &mesh.normals[i * 3];
+        const float *uv = mesh.uvs.empty() ? zero : &mesh.uvs[i * 2];
+        uint8_t *vertex = vertices.data() + i * stride;
+
+        switch (mesh.vertexFormat) {
+            case MESH_VERTEX_POSITION_F32:
+                memcpy(vertex, position, sizeof(float) * 3);
+                break;
+            case MESH_VERTEX_STANDARD_F32: {
+                MeshVertexStandard standard = {};
+                memcpy(standard.position, position, sizeof(standard.position));
+                memcpy(standard.normal, normal, sizeof(standard.normal));
+                memcpy(standard.uv, uv, sizeof(standard.uv));
+                memcpy(vertex, &standard, sizeof(standard));
+                break;
+            }
+            case MESH_VERTEX_QUANTIZED: {
+                MeshVertexQuantized quantized = {};
+                for (int axis = 0; axis < 3; axis++) {
+                    quantized.position[axis] = quantizeUnorm16(position[axis], header.boundsMin[axis],
+                                                               header.boundsMax[axis] - header.boundsMin[axis]);
+                }
+                encodeOctahedral(normal, quantized.normal);
+                quantized.uv[0] = floatToHalf(uv[0]);
+                quantized.uv[1] = floatToHalf(uv[1]);
+                memcpy(vertex, &quantized, sizeof(quantized));
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    return vertices;
+}
+
+void vtr::writeMeshFile(const std::string &path, const MeshData &mesh) {
+    uint32_t stride = meshVertexStride(mesh.vertexFormat);
+
+    if (stride == 0) {
+        throw std::runtime_error("unknown mesh vertex format");
+    }
+
+    std::vector<MeshLod> lods = mesh.lods;
+    if (lods.empty()) {
+        lods.push_back({0, static_cast<uint32_t>(mesh.indices.size()), 0.0f, 0});
+    }
+
+    MeshFileHeader header = {};
+    header.magic = MESH_MAGIC;
+    header.version = MESH_VERSION;
+    header.vertexFormat = mesh.vertexFormat;
+    header.vertexStride = stride;
+    header.vertexCount = mesh.vertexCount;
+    header.indexType = mesh.vertexCount <= 0x10000 ? MESH_INDEX_UINT16 : MESH_INDEX_UINT32;
+    header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+    header.lodCount = static_cast<uint32_t>(lods.size());
+
+    // Bounds first, quantized positions are stored relative to them.
+    computeBounds(mesh.positions, header);
+
+    std::vector<uint8_t> vertices = packVertices(mesh, header);
+
+    header.lodOffset = alignStream(sizeof(MeshFileHeader));
+    header.vertexOffset = alignStream(header.lodOffset + sizeof(MeshLod) * lods.size());
+    header.vertexSize = vertices.size();
+    header.indexOffset = alignStream(header.vertexOffset + header.vertexSize);
+    header.indexSize = static_cast<uint64_t>(header.indexCount) * meshIndexSize(header.indexType);
+
+    std::vector<uint8_t> file(header.indexOffset + header.indexSize, 0);
+    memcpy(file.data(), &header, sizeof(header));
+    memcpy(file.data() + header.lodOffset, lods.data(), sizeof(MeshLod) * lods.size());
+    memcpy(file.data() + header.vertexOffset, vertices.data(), header.vertexSize);
+
+    if (header.indexType == MESH_INDEX_UINT16) {
+        auto *indices = reinterpret_cast<uint16_t *>(file.data() + header.indexOffset);
+        for (size_t i = 0; i < mesh.indices.size(); i++) {
+            indices[i] = static_cast<uint16_t>(mesh.indices[i]);
+        }
+    } else {
+        memcpy(file.data() + header.indexOffset, mesh.indices.data(), header.indexSize);
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("failed to open " + path + " for writing");
+    }
+
+    out.write(reinterpret_cast<const char *>(file.data()), static_cast<std::streamsize>(file.size()));
+
+    if (!out) {
+        throw std::runtime_error("failed to write " + path);
+    }
+}
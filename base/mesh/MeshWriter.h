@@ -0,0 +1,32 @@
+#ifndef VULKAN_TRY_MESHWRITER_H
+#define VULKAN_TRY_MESHWRITER_H
+
+#include <string>
+#include <vector>
+#include "MeshFormat.h"
+
+namespace vtr {
+    struct MeshData {
+        // Layout of the vertex stream written to the file.
+        uint32_t vertexFormat = MESH_VERTEX_POSITION_F32;
+        uint32_t vertexCount = 0;
+
+        // Object space attributes, 3, 3 and 2 floats per vertex. Normals and uvs may be left empty.
+        std::vector<float> positions;
+        std::vector<float> normals;
+        std::vector<float> uvs;
+
+        std::vector<uint32_t> indices;
+
+        // Empty means a single LOD covering all indices.
+        std::vector<MeshLod> lods;
+    };
+
+    // Encodes the attributes of mesh in vertexFormat, quantized formats are relative to the header bounds.
+    std::vector<uint8_t> packVertices(const MeshData &mesh, const MeshFileHeader &header);
+
+    // Writes mesh as a container file, 16 bit indices are used whenever the vertex count allows it.
+    void writeMeshFile(const std::string &path, const MeshData &mesh);
+}
+
+#endif //VULKAN_TRY_MESHWRITER_H
@@ -0,0 +1,47 @@
+#ifndef VULKAN_TRY_ALIGNEDALLOCATOR_H
+#define VULKAN_TRY_ALIGNEDALLOCATOR_H
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace vtr {
+    // Allocator for SoA streams read with aligned SIMD loads.
+    template<typename T, size_t Alignment = 32>
+    struct AlignedAllocator {
+        using value_type = T;
+
+        template<typename U>
+        struct rebind {
+            using other = AlignedAllocator<U, Alignment>;
+        };
+
+        AlignedAllocator() = default;
+
+        template<typename U>
+        AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+        T *allocate(size_t count) {
+            return static_cast<T *>(::operator new(count * sizeof(T), std::align_val_t(Alignment)));
+        }
+
+        void deallocate(T *pointer, size_t) {
+            ::operator delete(pointer, std::align_val_t(Alignment));
+        }
+
+        template<typename U>
+        bool operator==(const AlignedAllocator<U, Alignment> &) const {
+            return true;
+        }
+
+        template<typename U>
+        bool operator!=(const AlignedAllocator<U, Alignment> &) const {
+            return false;
+        }
+    };
+
+    template<typename T>
+    using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+}
+
+#endif //VULKAN_TRY_ALIGNEDALLOCATOR_H
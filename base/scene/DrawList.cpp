@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <cmath>
+#include "DrawList.h"
+
+namespace vtr {
+    uint32_t DrawKey::quantizeDepth(float depth, bool backToFront) {
+        const uint32_t maximum = (1u << DEPTH_BITS) - 1;
+
+        float clamped = std::isnan(depth) ? 1.0f : std::min(std::max(depth, 0.0f), 1.0f);
+        auto quantized = static_cast<uint32_t>(std::lround(clamped * maximum));
+
+        return backToFront ? maximum - quantized : quantized;
+    }
+
+    DrawListStats &DrawListStats::operator+=(const DrawListStats &other) {
+        draws += other.draws;
+        pipelineBinds += other.pipelineBinds;
+        pipelineBindsAvoided += other.pipelineBindsAvoided;
+        meshBinds += other.meshBinds;
+        meshBindsAvoided += other.meshBindsAvoided;
+
+        return *this;
+    }
+
+    void DrawList::sort() {
+        const size_t count = packets.size();
+        if (count < 2) {
+            return;
+        }
+
+        // One histogram pass for all eight digits.
+        uint32_t histograms[8][256] = {};
+        for (const DrawPacket &packet: packets) {
+            for (uint32_t digit = 0; digit < 8; digit++) {
+                histograms[digit][packet.key >> (digit * 8) & 0xff]++;
+            }
+        }
+
+        scratch.resize(count);
+        DrawPacket *source = packets.data();
+        DrawPacket *destination = scratch.data();
+
+        for (uint32_t digit = 0; digit < 8; digit++) {
+            uint32_t *histogram = histograms[digit];
+
+            // Every key has the same byte here, the pass would only copy.
+            if (histogram[source[0].key >> (digit * 8) & 0xff] == count) {
+                continue;
+            }
+
+            uint32_t offset = 0;
+            for (uint32_t bucket = 0; bucket < 256; bucket++) {
+                uint32_t bucketCount = histogram[bucket];
+                histogram[bucket] = offset;
+                offset += bucketCount;
+            }
+
+            for (size_t i = 0; i < count; i++) {
+                destination[histogram[source[i].key >> (digit * 8) & 0xff]++] = source[i];
+            }
+
+            std::swap(source, destination);
+        }
+
+        if (source != packets.data()) {
+            packets.swap(scratch);
+        }
+    }
+}
@@ -0,0 +1,122 @@
+#ifndef VULKAN_TRY_DRAWLIST_H
+#define VULKAN_TRY_DRAWLIST_H
+
+#include <cstdint>
+#include <vector>
+
+namespace vtr {
+    /*
+     * Sort key of a draw, most significant field first so sorting groups draws by pass, then pipeline, material and
+     * mesh, and orders equal state by depth:
+     *
+     *   pass 4 | pipeline 12 | material 12 | mesh 16 | depth 20
+     *
+     * Fields are indices into whatever tables the caller keeps, values wider than their field are truncated.
+     */
+    struct DrawKey {
+        static const uint32_t PASS_BITS = 4;
+        static const uint32_t PIPELINE_BITS = 12;
+        static const uint32_t MATERIAL_BITS = 12;
+        static const uint32_t MESH_BITS = 16;
+        static const uint32_t DEPTH_BITS = 20;
+
+        static const uint32_t DEPTH_SHIFT = 0;
+        static const uint32_t MESH_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+        static const uint32_t MATERIAL_SHIFT = MESH_SHIFT + MESH_BITS;
+        static const uint32_t PIPELINE_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+        static const uint32_t PASS_SHIFT = PIPELINE_SHIFT + PIPELINE_BITS;
+
+        static inline uint64_t pack(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh,
+                                    uint32_t depth) {
+            return field(pass, PASS_BITS) << PASS_SHIFT | field(pipeline, PIPELINE_BITS) << PIPELINE_SHIFT |
+                   field(material, MATERIAL_BITS) << MATERIAL_SHIFT | field(mesh, MESH_BITS) << MESH_SHIFT |
+                   field(depth, DEPTH_BITS) << DEPTH_SHIFT;
+        }
+
+        // Depth in [0, 1] to the depth field, front to back. Pass backToFront for blended draws.
+        static uint32_t quantizeDepth(float depth, bool backToFront = false);
+
+        static inline uint32_t pass(uint64_t key) {
+            return unpack(key, PASS_SHIFT, PASS_BITS);
+        }
+
+        static inline uint32_t pipeline(uint64_t key) {
+            return unpack(key, PIPELINE_SHIFT, PIPELINE_BITS);
+        }
+
+        static inline uint32_t material(uint64_t key) {
+            return unpack(key, MATERIAL_SHIFT, MATERIAL_BITS);
+        }
+
+        static inline uint32_t mesh(uint64_t key) {
+            return unpack(key, MESH_SHIFT, MESH_BITS);
+        }
+
+    private:
+        static inline uint64_t field(uint32_t value, uint32_t bits) {
+            return static_cast<uint64_t>(value) & ((uint64_t(1) << bits) - 1);
+        }
+
+        static inline uint32_t unpack(uint64_t key, uint32_t shift, uint32_t bits) {
+            return static_cast<uint32_t>(key >> shift & ((uint64_t(1) << bits) - 1));
+        }
+    };
+
+    struct DrawPacket {
+        uint64_t key;
+
+        // Into the caller's own array of draw data.
+        uint32_t index;
+    };
+
+    // Per recorded command buffer, binds skipped because the previous draw left the same state bound.
+    struct DrawListStats {
+        uint64_t draws;
+        uint64_t pipelineBinds;
+        uint64_t pipelineBindsAvoided;
+        uint64_t meshBinds;
+        uint64_t meshBindsAvoided;
+
+        DrawListStats &operator+=(const DrawListStats &other);
+    };
+
+    /*
+     * Draws submitted in any order during a frame, sorted by key before recording. Sorting is an LSD radix sort over
+     * the key bytes, stable, linear in the draw count and skipping bytes every key agrees on, which for a frame are
+     * usually the pass and most of the pipeline bits. Storage is kept across frames.
+     */
+    class DrawList {
+    public:
+        inline void clear() {
+            packets.clear();
+        }
+
+        inline void add(uint64_t key, uint32_t index) {
+            packets.push_back({key, index});
+        }
+
+        void sort();
+
+        inline size_t size() const {
+            return packets.size();
+        }
+
+        inline const DrawPacket &operator[](size_t i) const {
+            return packets[i];
+        }
+
+        inline const DrawPacket *begin() const {
+            return packets.data();
+        }
+
+        inline const DrawPacket *end() const {
+            return packets.data() + packets.size();
+        }
+
+    private:
+        std::vector<DrawPacket> packets;
+        std::vector<DrawPacket> scratch;
+    };
+}
+
+#endif //VULKAN_TRY_DRAWLIST_H
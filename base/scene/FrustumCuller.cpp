@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <cmath>
+#include "FrustumCuller.h"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace vtr;
+
+namespace {
+#if defined(__AVX__)
+    typedef __m256 Lanes;
+    const uint32_t LANE_COUNT = 8;
+
+    inline Lanes load(const float *stream) { return _mm256_load_ps(stream); }
+
+    inline Lanes broadcast(float value) { return _mm256_set1_ps(value); }
+
+    inline Lanes add(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+
+    inline Lanes mul(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+
+    inline Lanes negate(Lanes a) { return _mm256_sub_ps(_mm256_setzero_ps(), a); }
+
+    inline Lanes greater(Lanes a, Lanes b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+
+    inline Lanes both(Lanes a, Lanes b) { return _mm256_and_ps(a, b); }
+
+    inline Lanes allLanes() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+
+    inline uint32_t mask(Lanes a) { return static_cast<uint32_t>(_mm256_movemask_ps(a)); }
+#elif defined(__SSE2__)
+    typedef __m128 Lanes;
+    const uint32_t LANE_COUNT = 4;
+
+    inline Lanes load(const float *stream) { return _mm_load_ps(stream); }
+
+    inline Lanes broadcast(float value) { return _mm_set1_ps(value); }
+
+    inline Lanes add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+
+    inline Lanes mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+
+    inline Lanes negate(Lanes a) { return _mm_sub_ps(_mm_setzero_ps(), a); }
+
+    inline Lanes greater(Lanes a, Lanes b) { return _mm_cmpgt_ps(a, b); }
+
+    inline Lanes both(Lanes a, Lanes b) { return _mm_and_ps(a, b); }
+
+    inline Lanes allLanes() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+
+    inline uint32_t mask(Lanes a) { return static_cast<uint32_t>(_mm_movemask_ps(a)); }
+#else
+    const uint32_t LANE_COUNT = 1;
+#endif
+
+    inline float planeDistance(const glm::vec4 &plane, float x, float y, float z) {
+        return plane.x * x + plane.y * y + plane.z * z + plane.w;
+    }
+
+    // Appends base + lane for every set bit without branching, visible needs LANE_COUNT slots of slack.
+    inline uint32_t compact(uint32_t visibleMask, uint32_t base, uint32_t lanes, uint32_t *out) {
+        uint32_t written = 0;
+
+        for (uint32_t lane = 0; lane < lanes; lane++) {
+            out[written] = base + lane;
+            written += (visibleMask >> lane) & 1u;
+        }
+
+        return written;
+    }
+}
+
+Frustum Frustum::fromViewProjection(const glm::mat4 &viewProjection) {
+    // Gribb-Hartmann, glm is column major so row i is m[0][i], m[1][i], ...
+    auto row = [&viewProjection](int i) {
+        return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    };
+
+    glm::vec4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+
+    Frustum frustum = {};
+    frustum.planes[0] = r3 + r0;
+    frustum.planes[1] = r3 - r0;
+    frustum.planes[2] = r3 + r1;
+    frustum.planes[3] = r3 - r1;
+    frustum.planes[4] = r2;
+    frustum.planes[5] = r3 - r2;
+
+    for (auto &plane: frustum.planes) {
+        float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        plane = plane / length;
+    }
+
+    return frustum;
+}
+
+void SphereBounds::resize(uint32_t count) {
+    centerX.resize(count);
+    centerY.resize(count);
+    centerZ.resize(count);
+    radius.resize(count);
+}
+
+void AabbBounds::resize(uint32_t count) {
+    centerX.resize(count);
+    centerY.resize(count);
+    centerZ.resize(count);
+    extentX.resize(count);
+    extentY.resize(count);
+    extentZ.resize(count);
+}
+
+uint32_t FrustumCuller::cullSpheres(const Frustum &frustum, const SphereBounds &bounds,
+                                    std::vector<uint32_t> &visible) {
+    uint32_t count = bounds.size();
+    if (visible.size() < count + LANE_COUNT) {
+        visible.resize(count + LANE_COUNT);
+    }
+
+    uint32_t *out = visible.data();
+    uint32_t written = 0;
+    uint32_t i = 0;
+
+#if defined(__SSE2__)
+    Lanes planeX[6], planeY[6], planeZ[6], planeW[6];
+    for (uint32_t p = 0; p < 6; p++) {
+        planeX[p] = broadcast(frustum.planes[p].x);
+        planeY[p] = broadcast(frustum.planes[p].y);
+        planeZ[p] = broadcast(frustum.planes[p].z);
+        planeW[p] = broadcast(frustum.planes[p].w);
+    }
+
+    for (; i + LANE_COUNT <= count; i += LANE_COUNT) {
+        Lanes x = load(&bounds.centerX[i]);
+        Lanes y = load(&bounds.centerY[i]);
+        Lanes z = load(&bounds.centerZ[i]);
+        Lanes negativeRadius = negate(load(&bounds.radius[i]));
+
+        Lanes inside = allLanes();
+        for (uint32_t p = 0; p < 6; p++) {
+            Lanes distance = add(add(mul(planeX[p], x), mul(planeY[p], y)), add(mul(planeZ[p], z), planeW[p]));
+            inside = both(inside, greater(distance, negativeRadius));
+        }
+
+        written += compact(mask(inside), i, LANE_COUNT, out + written);
+    }
+#endif
+
+    for (; i < count; i++) {
+        bool inside = true;
+        for (const auto &plane: frustum.planes) {
+            inside &= planeDistance(plane, bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]) >
+                      -bounds.radius[i];
+        }
+
+        out[written] = i;
+        written += inside;
+    }
+
+    return written;
+}
+
+uint32_t FrustumCuller::cullAabbs(const Frustum &frustum, const AabbBounds &bounds, std::vector<uint32_t> &visible) {
+    uint32_t count = bounds.size();
+    if (visible.size() < count + LANE_COUNT) {
+        visible.resize(count + LANE_COUNT);
+    }
+
+    uint32_t *out = visible.data();
+    uint32_t written = 0;
+    uint32_t i = 0;
+
+#if defined(__SSE2__)
+    Lanes planeX[6], planeY[6], planeZ[6], planeW[6];
+    Lanes absX[6], absY[6], absZ[6];
+    for (uint32_t p = 0; p < 6; p++) {
+        planeX[p] = broadcast(frustum.planes[p].x);
+        planeY[p] = broadcast(frustum.planes[p].y);
+        planeZ[p] = broadcast(frustum.planes[p].z);
+        planeW[p] = broadcast(frustum.planes[p].w);
+        absX[p] = broadcast(std::fabs(frustum.planes[p].x));
+        absY[p] = broadcast(std::fabs(frustum.planes[p].y));
+        absZ[p] = broadcast(std::fabs(frustum.planes[p].z));
+    }
+
+    for (; i + LANE_COUNT <= count; i += LANE_COUNT) {
+        Lanes x = load(&bounds.centerX[i]);
+        Lanes y = load(&bounds.centerY[i]);
+        Lanes z = load(&bounds.centerZ[i]);
+        Lanes ex = load(&bounds.extentX[i]);
+        Lanes ey = load(&bounds.extentY[i]);
+        Lanes ez = load(&bounds.extentZ[i]);
+
+        Lanes inside = allLanes();
+        for (uint32_t p = 0; p < 6; p++) {
+            Lanes distance = add(add(mul(planeX[p], x), mul(planeY[p], y)), add(mul(planeZ[p], z), planeW[p]));
+            // Projected half size of the box onto the plane normal.
+            Lanes reach = add(add(mul(absX[p], ex), mul(absY[p], ey)), mul(absZ[p], ez));
+            inside = both(inside, greater(distance, negate(reach)));
+        }
+
+        written += compact(mask(inside), i, LANE_COUNT, out + written);
+    }
+#endif
+
+    for (; i < count; i++) {
+        bool inside = true;
+        for (const auto &plane: frustum.planes) {
+            float reach = std::fabs(plane.x) * bounds.extentX[i] + std::fabs(plane.y) * bounds.extentY[i] +
+                          std::fabs(plane.z) * bounds.extentZ[i];
+            inside &= planeDistance(plane, bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]) > -reach;
+        }
+
+        out[written] = i;
+        written += inside;
+    }
+
+    return written;
+}
+
+void FrustumCuller::transformSpheres(const glm::vec4 &localSphere, const glm::mat4 *worldMatrices, uint32_t count,
+                                     SphereBounds &bounds) {
+    bounds.resize(count);
+
+    for (uint32_t i = 0; i < count; i++) {
+        const glm::mat4 &world = worldMatrices[i];
+        glm::vec4 center = world * glm::vec4(localSphere.x, localSphere.y, localSphere.z, 1.0f);
+
+        float scale = std::max(glm::dot(glm::vec3(world[0]), glm::vec3(world[0])),
+                               std::max(glm::dot(glm::vec3(world[1]), glm::vec3(world[1])),
+                                        glm::dot(glm::vec3(world[2]), glm::vec3(world[2]))));
+
+        bounds.centerX[i] = center.x;
+        bounds.centerY[i] = center.y;
+        bounds.centerZ[i] = center.z;
+        bounds.radius[i] = localSphere.w * std::sqrt(scale);
+    }
+}
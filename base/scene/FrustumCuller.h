@@ -0,0 +1,56 @@
+#ifndef VULKAN_TRY_FRUSTUMCULLER_H
+#define VULKAN_TRY_FRUSTUMCULLER_H
+
+#include <cstdint>
+#include <vector>
+#include "SceneMath.h"
+#include "AlignedAllocator.h"
+
+namespace vtr {
+    struct Frustum {
+        // Left, right, bottom, top, near, far. xyz is the inward normal, w the distance, normalized.
+        glm::vec4 planes[6];
+
+        // Expects clip space depth in [0, 1], as configured in SceneMath.h.
+        static Frustum fromViewProjection(const glm::mat4 &viewProjection);
+    };
+
+    struct SphereBounds {
+        AlignedVector<float> centerX, centerY, centerZ, radius;
+
+        void resize(uint32_t count);
+
+        inline uint32_t size() const {
+            return static_cast<uint32_t>(radius.size());
+        }
+    };
+
+    struct AabbBounds {
+        AlignedVector<float> centerX, centerY, centerZ;
+        AlignedVector<float> extentX, extentY, extentZ;
+
+        void resize(uint32_t count);
+
+        inline uint32_t size() const {
+            return static_cast<uint32_t>(extentX.size());
+        }
+    };
+
+    /*
+     * Tests bounds against the six frustum planes, 8 objects at a time with AVX, 4 with SSE2. The indices of the
+     * visible objects are written to the front of visible in ascending order and their count is returned. visible
+     * only ever grows, to the object count plus a vector of slack, so reusing it skips clearing it every call.
+     */
+    class FrustumCuller {
+    public:
+        static uint32_t cullSpheres(const Frustum &frustum, const SphereBounds &bounds, std::vector<uint32_t> &visible);
+
+        static uint32_t cullAabbs(const Frustum &frustum, const AabbBounds &bounds, std::vector<uint32_t> &visible);
+
+        // Moves a local bounding sphere (xyz center, w radius) by every world matrix, scaling by the largest axis.
+        static void transformSpheres(const glm::vec4 &localSphere, const glm::mat4 *worldMatrices, uint32_t count,
+                                     SphereBounds &bounds);
+    };
+}
+
+#endif //VULKAN_TRY_FRUSTUMCULLER_H
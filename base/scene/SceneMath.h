@@ -0,0 +1,13 @@
+#ifndef VULKAN_TRY_SCENEMATH_H
+#define VULKAN_TRY_SCENEMATH_H
+
+// Every translation unit has to see glm with the same configuration.
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#endif //VULKAN_TRY_SCENEMATH_H
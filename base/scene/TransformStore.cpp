@@ -0,0 +1,326 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "TransformStore.h"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace vtr;
+
+namespace {
+    struct LocalColumns {
+        // Columns 0-2 of the local matrix per lane, column 3 is the position.
+        float c0x, c0y, c0z;
+        float c1x, c1y, c1z;
+        float c2x, c2y, c2z;
+    };
+
+    inline void composeScalar(float x, float y, float z, float w, float sx, float sy, float sz, LocalColumns &out) {
+        float x2 = x + x, y2 = y + y, z2 = z + z;
+        float xx = x * x2, yy = y * y2, zz = z * z2;
+        float xy = x * y2, xz = x * z2, yz = y * z2;
+        float wx = w * x2, wy = w * y2, wz = w * z2;
+
+        out.c0x = (1.0f - (yy + zz)) * sx;
+        out.c0y = (xy + wz) * sx;
+        out.c0z = (xz - wy) * sx;
+        out.c1x = (xy - wz) * sy;
+        out.c1y = (1.0f - (xx + zz)) * sy;
+        out.c1z = (yz + wx) * sy;
+        out.c2x = (xz + wy) * sz;
+        out.c2y = (yz - wx) * sz;
+        out.c2z = (1.0f - (xx + yy)) * sz;
+    }
+
+    inline void multiplyScalar(const float *a, float *b) {
+        // b = a * b, column major, b may only alias itself.
+        for (uint32_t k = 0; k < 4; k++) {
+            float b0 = b[k * 4 + 0], b1 = b[k * 4 + 1], b2 = b[k * 4 + 2], b3 = b[k * 4 + 3];
+
+            for (uint32_t r = 0; r < 4; r++) {
+                b[k * 4 + r] = a[r] * b0 + a[4 + r] * b1 + a[8 + r] * b2 + a[12 + r] * b3;
+            }
+        }
+    }
+
+#if defined(__SSE2__)
+    inline void multiplySse(const float *a, float *b) {
+        __m128 a0 = _mm_loadu_ps(a + 0);
+        __m128 a1 = _mm_loadu_ps(a + 4);
+        __m128 a2 = _mm_loadu_ps(a + 8);
+        __m128 a3 = _mm_loadu_ps(a + 12);
+
+        for (uint32_t k = 0; k < 4; k++) {
+            __m128 column = _mm_mul_ps(a0, _mm_set1_ps(b[k * 4 + 0]));
+            column = _mm_add_ps(column, _mm_mul_ps(a1, _mm_set1_ps(b[k * 4 + 1])));
+            column = _mm_add_ps(column, _mm_mul_ps(a2, _mm_set1_ps(b[k * 4 + 2])));
+            column = _mm_add_ps(column, _mm_mul_ps(a3, _mm_set1_ps(b[k * 4 + 3])));
+            _mm_storeu_ps(b + k * 4, column);
+        }
+    }
+
+    // Turns four SoA columns (x, y, z, w lanes) into one AoS column per transform and stores the dirty ones.
+    inline void storeColumn(__m128 x, __m128 y, __m128 z, __m128 w, glm::mat4 *world, const uint8_t *dirty,
+                            uint32_t column) {
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+
+        if (dirty[0]) _mm_storeu_ps(&world[0][column][0], x);
+        if (dirty[1]) _mm_storeu_ps(&world[1][column][0], y);
+        if (dirty[2]) _mm_storeu_ps(&world[2][column][0], z);
+        if (dirty[3]) _mm_storeu_ps(&world[3][column][0], w);
+    }
+
+    inline __m128 lanes(const float *stream) {
+        return _mm_load_ps(stream);
+    }
+
+    inline __m128 add(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+
+    inline __m128 sub(__m128 a, __m128 b) { return _mm_sub_ps(a, b); }
+
+    inline __m128 mul(__m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+
+    inline void splitStore(__m128 x, __m128 y, __m128 z, __m128 w, glm::mat4 *world, const uint8_t *dirty,
+                           uint32_t column) {
+        storeColumn(x, y, z, w, world, dirty, column);
+    }
+
+#if defined(__AVX__)
+    inline __m256 lanes8(const float *stream) {
+        return _mm256_load_ps(stream);
+    }
+
+    inline __m256 add(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+
+    inline __m256 sub(__m256 a, __m256 b) { return _mm256_sub_ps(a, b); }
+
+    inline __m256 mul(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+
+    inline void splitStore(__m256 x, __m256 y, __m256 z, __m256 w, glm::mat4 *world, const uint8_t *dirty,
+                           uint32_t column) {
+        storeColumn(_mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z),
+                    _mm256_castps256_ps128(w), world, dirty, column);
+        storeColumn(_mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1),
+                    _mm256_extractf128_ps(w, 1), world + 4, dirty + 4, column);
+    }
+
+    typedef __m256 Lanes;
+    const uint32_t LANE_COUNT = 8;
+
+    inline Lanes load(const float *stream) { return lanes8(stream); }
+
+    inline Lanes broadcast(float value) { return _mm256_set1_ps(value); }
+#else
+    typedef __m128 Lanes;
+    const uint32_t LANE_COUNT = 4;
+
+    inline Lanes load(const float *stream) { return lanes(stream); }
+
+    inline Lanes broadcast(float value) { return _mm_set1_ps(value); }
+#endif
+
+    // Builds the local TRS matrices of LANE_COUNT consecutive transforms and writes the dirty ones.
+    inline void composeLanes(const float *px, const float *py, const float *pz,
+                             const float *rx, const float *ry, const float *rz, const float *rw,
+                             const float *sx, const float *sy, const float *sz,
+                             glm::mat4 *world, const uint8_t *dirty) {
+        Lanes x = load(rx), y = load(ry), z = load(rz), w = load(rw);
+        Lanes one = broadcast(1.0f), zero = broadcast(0.0f);
+
+        Lanes x2 = add(x, x), y2 = add(y, y), z2 = add(z, z);
+        Lanes xx = mul(x, x2), yy = mul(y, y2), zz = mul(z, z2);
+        Lanes xy = mul(x, y2), xz = mul(x, z2), yz = mul(y, z2);
+        Lanes wx = mul(w, x2), wy = mul(w, y2), wz = mul(w, z2);
+
+        Lanes scaleX = load(sx), scaleY = load(sy), scaleZ = load(sz);
+
+        splitStore(mul(sub(one, add(yy, zz)), scaleX), mul(add(xy, wz), scaleX), mul(sub(xz, wy), scaleX), zero,
+                   world, dirty, 0);
+        splitStore(mul(sub(xy, wz), scaleY), mul(sub(one, add(xx, zz)), scaleY), mul(add(yz, wx), scaleY), zero,
+                   world, dirty, 1);
+        splitStore(mul(add(xz, wy), scaleZ), mul(sub(yz, wx), scaleZ), mul(sub(one, add(xx, yy)), scaleZ), zero,
+                   world, dirty, 2);
+        splitStore(load(px), load(py), load(pz), one, world, dirty, 3);
+    }
+
+    inline void multiply(const float *a, float *b) {
+        multiplySse(a, b);
+    }
+#else
+    const uint32_t LANE_COUNT = 1;
+
+    inline void multiply(const float *a, float *b) {
+        multiplyScalar(a, b);
+    }
+#endif
+}
+
+void TransformStore::reserve(uint32_t count) {
+    for (auto stream: {&positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ, &rotationW,
+                       &scaleX, &scaleY, &scaleZ}) {
+        stream->reserve(count);
+    }
+
+    parents.reserve(count);
+    dirty.reserve(count);
+    worldMatrices.reserve(count);
+}
+
+uint32_t
+TransformStore::add(uint32_t parent, const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale) {
+    uint32_t index = size();
+
+    if (parent != NO_PARENT && parent >= index) {
+        throw std::runtime_error("transform parent must be added before its children!");
+    }
+
+    positionX.push_back(position.x);
+    positionY.push_back(position.y);
+    positionZ.push_back(position.z);
+    rotationX.push_back(rotation.x);
+    rotationY.push_back(rotation.y);
+    rotationZ.push_back(rotation.z);
+    rotationW.push_back(rotation.w);
+    scaleX.push_back(scale.x);
+    scaleY.push_back(scale.y);
+    scaleZ.push_back(scale.z);
+
+    parents.push_back(parent);
+    dirty.push_back(0);
+    worldMatrices.emplace_back(1.0f);
+
+    markDirty(index);
+
+    return index;
+}
+
+void TransformStore::setPosition(uint32_t index, const glm::vec3 &position) {
+    positionX[index] = position.x;
+    positionY[index] = position.y;
+    positionZ[index] = position.z;
+
+    markDirty(index);
+}
+
+void TransformStore::setRotation(uint32_t index, const glm::quat &rotation) {
+    rotationX[index] = rotation.x;
+    rotationY[index] = rotation.y;
+    rotationZ[index] = rotation.z;
+    rotationW[index] = rotation.w;
+
+    markDirty(index);
+}
+
+void TransformStore::setScale(uint32_t index, const glm::vec3 &scale) {
+    scaleX[index] = scale.x;
+    scaleY[index] = scale.y;
+    scaleZ[index] = scale.z;
+
+    markDirty(index);
+}
+
+void TransformStore::markDirty(uint32_t index) {
+    dirty[index] = 1;
+    firstDirty = std::min(firstDirty, index);
+}
+
+void TransformStore::update() {
+    uint32_t count = size();
+
+    updatedBegin = updatedEnd = 0;
+
+    if (firstDirty >= count) {
+        firstDirty = UINT32_MAX;
+        return;
+    }
+
+    // Parents come first, so a single pass pushes dirtiness down whole subtrees.
+    uint32_t end = firstDirty;
+    for (uint32_t i = firstDirty; i < count; i++) {
+        uint32_t parent = parents[i];
+
+        if (parent != NO_PARENT && dirty[parent]) {
+            dirty[i] = 1;
+        }
+
+        if (dirty[i]) {
+            end = i + 1;
+        }
+    }
+
+    composeLocal(firstDirty, end);
+
+    updatedBegin = firstDirty;
+    updatedEnd = end;
+    firstDirty = UINT32_MAX;
+}
+
+void TransformStore::composeLocal(uint32_t begin, uint32_t end) {
+    uint32_t i = begin - begin % LANE_COUNT;
+
+    while (i < end) {
+        uint32_t blockEnd = i + LANE_COUNT;
+
+#if defined(__SSE2__)
+        if (blockEnd <= size()) {
+            bool anyDirty = false;
+            for (uint32_t lane = i; lane < blockEnd; lane++) {
+                anyDirty |= dirty[lane] != 0;
+            }
+
+            if (anyDirty) {
+                composeLanes(&positionX[i], &positionY[i], &positionZ[i],
+                             &rotationX[i], &rotationY[i], &rotationZ[i], &rotationW[i],
+                             &scaleX[i], &scaleY[i], &scaleZ[i], &worldMatrices[i], &dirty[i]);
+            }
+        } else
+#endif
+        {
+            // Tail of the streams, or no SIMD at all.
+            blockEnd = std::min(blockEnd, size());
+
+            for (uint32_t lane = i; lane < blockEnd; lane++) {
+                if (!dirty[lane]) {
+                    continue;
+                }
+
+                LocalColumns local;
+                composeScalar(rotationX[lane], rotationY[lane], rotationZ[lane], rotationW[lane],
+                              scaleX[lane], scaleY[lane], scaleZ[lane], local);
+
+                glm::mat4 &world = worldMatrices[lane];
+                world[0] = glm::vec4(local.c0x, local.c0y, local.c0z, 0.0f);
+                world[1] = glm::vec4(local.c1x, local.c1y, local.c1z, 0.0f);
+                world[2] = glm::vec4(local.c2x, local.c2y, local.c2z, 0.0f);
+                world[3] = glm::vec4(positionX[lane], positionY[lane], positionZ[lane], 1.0f);
+            }
+        }
+
+        // Parents inside the same block come first and are already final.
+        for (uint32_t lane = i; lane < blockEnd; lane++) {
+            if (!dirty[lane]) {
+                continue;
+            }
+
+            uint32_t parent = parents[lane];
+            if (parent != NO_PARENT) {
+                multiply(&worldMatrices[parent][0][0], &worldMatrices[lane][0][0]);
+            }
+
+            dirty[lane] = 0;
+        }
+
+        i = blockEnd;
+    }
+}
+
+void TransformStore::copyWorldMatrices(void *instanceData, uint32_t begin, uint32_t end) const {
+    if (begin >= end) {
+        return;
+    }
+
+    memcpy(static_cast<glm::mat4 *>(instanceData) + begin, worldMatrices.data() + begin,
+           sizeof(glm::mat4) * (end - begin));
+}
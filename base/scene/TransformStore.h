@@ -0,0 +1,78 @@
+#ifndef VULKAN_TRY_TRANSFORMSTORE_H
+#define VULKAN_TRY_TRANSFORMSTORE_H
+
+#include <cstdint>
+#include <vector>
+#include "SceneMath.h"
+#include "AlignedAllocator.h"
+
+namespace vtr {
+    /*
+     * Transform hierarchy stored as structure of arrays. A transform can only be parented to one that already
+     * exists, so parents always precede their children and world matrices are resolved in a single forward pass.
+     * World matrices are kept as an array of glm::mat4 and can be copied as is into a per-instance vertex buffer,
+     * the index of a transform is its instance index.
+     */
+    class TransformStore {
+    public:
+        static const uint32_t NO_PARENT = UINT32_MAX;
+
+        TransformStore() = default;
+
+        void reserve(uint32_t count);
+
+        uint32_t add(uint32_t parent, const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale);
+
+        void setPosition(uint32_t index, const glm::vec3 &position);
+
+        void setRotation(uint32_t index, const glm::quat &rotation);
+
+        void setScale(uint32_t index, const glm::vec3 &scale);
+
+        // Recomputes the world matrices of dirty transforms and of all their descendants.
+        void update();
+
+        inline uint32_t size() const {
+            return static_cast<uint32_t>(parents.size());
+        }
+
+        inline uint32_t getParent(uint32_t index) const {
+            return parents[index];
+        }
+
+        inline const glm::mat4 *getWorldMatrices() const {
+            return worldMatrices.data();
+        }
+
+        // Instances in [begin, end) were rewritten by the last update(), begin == end when nothing moved.
+        inline void getUpdatedRange(uint32_t &begin, uint32_t &end) const {
+            begin = updatedBegin;
+            end = updatedEnd;
+        }
+
+        // Writes world matrices [begin, end) to instanceData, which holds one glm::mat4 per transform.
+        void copyWorldMatrices(void *instanceData, uint32_t begin, uint32_t end) const;
+
+    private:
+        AlignedVector<float> positionX, positionY, positionZ;
+        AlignedVector<float> rotationX, rotationY, rotationZ, rotationW;
+        AlignedVector<float> scaleX, scaleY, scaleZ;
+
+        std::vector<uint32_t> parents;
+        std::vector<uint8_t> dirty;
+
+        std::vector<glm::mat4> worldMatrices;
+
+        // Lowest dirty index, nothing before it needs work.
+        uint32_t firstDirty = UINT32_MAX;
+
+        uint32_t updatedBegin = 0;
+        uint32_t updatedEnd = 0;
+
+        void markDirty(uint32_t index);
+
+        void composeLocal(uint32_t begin, uint32_t end);
+    };
+}
+
+#endif //VULKAN_TRY_TRANSFORMSTORE_H
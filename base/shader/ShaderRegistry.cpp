@@ -0,0 +1,26 @@
+#include <stdexcept>
+#include "ShaderRegistry.h"
+
+// Generated by CMake, includes every embedded shader and lists them in embeddedShaders.
+#include "ShaderTable.inc"
+
+namespace vtr {
+    const EmbeddedShader *findShader(const std::string &name) {
+        for (const EmbeddedShader &shader: embeddedShaders) {
+            if (name == shader.name) {
+                return &shader;
+            }
+        }
+
+        return nullptr;
+    }
+
+    const EmbeddedShader &getShader(const std::string &name) {
+        const EmbeddedShader *shader = findShader(name);
+        if (shader == nullptr) {
+            throw std::runtime_error("no embedded shader named " + name);
+        }
+
+        return *shader;
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef VULKAN_TRY_SHADERREGISTRY_H
+#define VULKAN_TRY_SHADERREGISTRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace vtr {
+    /*
+     * SPIR-V compiled from visual/shaders at build time and embedded in the binary, named after its GLSL source,
+     * e.g. "shader.vert".
+     */
+    struct EmbeddedShader {
+        const char *name;
+        const uint32_t *code;
+        size_t size; // In bytes.
+    };
+
+    // nullptr when no shader has that name.
+    const EmbeddedShader *findShader(const std::string &name);
+
+    // Throws when no shader has that name.
+    const EmbeddedShader &getShader(const std::string &name);
+}
+
+
+#endif //VULKAN_TRY_SHADERREGISTRY_H
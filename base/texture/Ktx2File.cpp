@@ -0,0 +1,97 @@
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Ktx2File.h"
+
+using namespace vtr;
+
+Ktx2File::Ktx2File(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        throw std::runtime_error("failed to open texture file " + path);
+    }
+
+    struct stat fileStat = {};
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size < static_cast<off_t>(sizeof(Ktx2Header))) {
+        close(fd);
+        throw std::runtime_error("texture file is too small " + path);
+    }
+
+    size = static_cast<size_t>(fileStat.st_size);
+    mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping keeps its own reference to the file.
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw std::runtime_error("failed to map texture file " + path);
+    }
+
+    // Levels are uploaded smallest first, which walks the file front to back for conforming writers.
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    madvise(mapping, size, MADV_WILLNEED);
+
+    try {
+        validate(path);
+    } catch (...) {
+        munmap(mapping, size);
+        throw;
+    }
+}
+
+Ktx2File::~Ktx2File() {
+    if (mapping != nullptr) {
+        munmap(mapping, size);
+    }
+}
+
+void Ktx2File::validate(const std::string &path) const {
+    const Ktx2Header &header = getHeader();
+
+    if (memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+        throw std::runtime_error("not a KTX2 file " + path);
+    }
+
+    if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth > 1 || header.layerCount > 1 ||
+        header.faceCount != 1) {
+        throw std::runtime_error("only single 2D images are supported in " + path);
+    }
+
+    // Basis Universal and zstd payloads would need a transcoder first.
+    if (header.supercompressionScheme != 0) {
+        throw std::runtime_error("supercompressed KTX2 files are not supported " + path);
+    }
+
+    if (header.vkFormat == 0) {
+        throw std::runtime_error("KTX2 file without a Vulkan format " + path);
+    }
+
+    uint32_t largest = header.pixelWidth > header.pixelHeight ? header.pixelWidth : header.pixelHeight;
+    uint32_t fullChain = 1;
+    while (largest >>= 1) {
+        fullChain++;
+    }
+
+    uint32_t levelCount = getLevelCount();
+    if (levelCount > fullChain) {
+        throw std::runtime_error("more mip levels than the image has in " + path);
+    }
+
+    if (sizeof(Ktx2Header) + static_cast<uint64_t>(levelCount) * sizeof(Ktx2Level) > size) {
+        throw std::runtime_error("truncated level index in " + path);
+    }
+
+    for (uint32_t i = 0; i < levelCount; i++) {
+        const Ktx2Level &level = getLevel(i);
+
+        if (level.byteLength == 0 || level.byteOffset > size || level.byteLength > size - level.byteOffset ||
+            level.uncompressedByteLength != level.byteLength) {
+            throw std::runtime_error("corrupt level " + std::to_string(i) + " in " + path);
+        }
+    }
+}
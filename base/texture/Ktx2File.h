@@ -0,0 +1,90 @@
+#ifndef VULKAN_TRY_KTX2FILE_H
+#define VULKAN_TRY_KTX2FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * KTX 2.0 container, little endian:
+ *
+ *   identifier | Ktx2Header | Ktx2Level[max(1, levelCount)] | data format descriptor | key/value data | mip levels
+ *
+ * vkFormat holds a VkFormat value directly. Level 0 is the largest mip, levels are usually stored smallest first
+ * in the file but only the level index says where each one lives.
+ */
+namespace vtr {
+    const uint8_t KTX2_IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+    struct Ktx2Header {
+        uint8_t identifier[12];
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        // 0 asks the loader to generate the mip chain, only level 0 is stored then.
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+
+    static_assert(sizeof(Ktx2Header) == 80, "KTX2 header layout");
+
+    struct Ktx2Level {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    /*
+     * Read only memory mapping of a KTX2 file. Only what the texture streamer uploads is accepted: single 2D images
+     * without array layers, cube faces or supercompression. Level sizes are checked against the format by the
+     * caller, which knows the block layout of each VkFormat.
+     */
+    class Ktx2File {
+    public:
+        explicit Ktx2File(const std::string &path);
+
+        Ktx2File(const Ktx2File &) = delete;
+
+        Ktx2File &operator=(const Ktx2File &) = delete;
+
+        ~Ktx2File();
+
+        inline const Ktx2Header &getHeader() const {
+            return *static_cast<const Ktx2Header *>(mapping);
+        }
+
+        // Levels stored in the file, at least one.
+        inline uint32_t getLevelCount() const {
+            return getHeader().levelCount == 0 ? 1 : getHeader().levelCount;
+        }
+
+        inline const Ktx2Level &getLevel(uint32_t level) const {
+            return reinterpret_cast<const Ktx2Level *>(static_cast<const uint8_t *>(mapping) +
+                                                       sizeof(Ktx2Header))[level];
+        }
+
+        inline const uint8_t *getLevelData(uint32_t level) const {
+            return static_cast<const uint8_t *>(mapping) + getLevel(level).byteOffset;
+        }
+
+    private:
+        void *mapping = nullptr;
+
+        size_t size = 0;
+
+        void validate(const std::string &path) const;
+    };
+}
+
+#endif //VULKAN_TRY_KTX2FILE_H
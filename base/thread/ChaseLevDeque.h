@@ -0,0 +1,95 @@
+#ifndef VULKAN_TRY_CHASELEVDEQUE_H
+#define VULKAN_TRY_CHASELEVDEQUE_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace vtr {
+    /*
+     * Fixed capacity Chase-Lev work-stealing deque, following Le et al. "Correct and Efficient Work-Stealing for
+     * Weak Memory Models". The owning thread pushes and pops at the bottom, any other thread steals from the top.
+     * T must be a pointer type, nullptr means empty or lost race.
+     */
+    template<typename T, uint32_t Capacity>
+    class ChaseLevDeque {
+        static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    public:
+        ChaseLevDeque() {
+            for (auto &slot: buffer) {
+                slot.store(nullptr, std::memory_order_relaxed);
+            }
+        }
+
+        // Owner only. Returns false when full, the caller is expected to run the item inline.
+        bool push(T item) {
+            int64_t b = bottom.load(std::memory_order_relaxed);
+            int64_t t = top.load(std::memory_order_acquire);
+
+            if (b - t >= static_cast<int64_t>(Capacity)) {
+                return false;
+            }
+
+            buffer[b & (Capacity - 1)].store(item, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom.store(b + 1, std::memory_order_relaxed);
+
+            return true;
+        }
+
+        // Owner only.
+        T pop() {
+            int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = top.load(std::memory_order_relaxed);
+
+            if (t > b) {
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            T item = buffer[b & (Capacity - 1)].load(std::memory_order_relaxed);
+
+            if (t == b) {
+                // Last item, race against thieves.
+                if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    item = nullptr;
+                }
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
+
+            return item;
+        }
+
+        // Any thread.
+        T steal() {
+            int64_t t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = bottom.load(std::memory_order_acquire);
+
+            if (t >= b) {
+                return nullptr;
+            }
+
+            T item = buffer[t & (Capacity - 1)].load(std::memory_order_relaxed);
+
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                return nullptr;
+            }
+
+            return item;
+        }
+
+        bool empty() const {
+            return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+        }
+
+    private:
+        alignas(64) std::atomic<int64_t> top{0};
+        alignas(64) std::atomic<int64_t> bottom{0};
+        alignas(64) std::atomic<T> buffer[Capacity];
+    };
+}
+
+#endif //VULKAN_TRY_CHASELEVDEQUE_H
@@ -0,0 +1,273 @@
+#include <memory>
+#include "JobSystem.h"
+
+using namespace vtr;
+
+namespace {
+    thread_local JobSystem *currentSystem = nullptr;
+    thread_local void *currentWorker = nullptr;
+
+    thread_local std::unique_ptr<Job[]> jobPool;
+    thread_local uint32_t jobPoolIndex = 0;
+
+    // Spins this many times without finding work before a worker goes to sleep.
+    const uint32_t IDLE_SPINS = 64;
+
+    // Slots after the last one handed out that are tried before helping, in round robin order they are the oldest.
+    const uint32_t JOB_POOL_WINDOW = 64;
+
+    // From the slots offset begin to end after the last one handed out, nullptr when all of them are in flight.
+    Job *claimJob(uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            uint32_t index = jobPoolIndex + i;
+            Job *job = &jobPool[index & (JobSystem::JOB_POOL_SIZE - 1)];
+
+            if (!job->inUse.exchange(true, std::memory_order_acquire)) {
+                jobPoolIndex = index + 1;
+                return job;
+            }
+        }
+
+        return nullptr;
+    }
+}
+
+void JobCounter::acquire() {
+    while (lock.test_and_set(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+}
+
+void JobCounter::release() {
+    lock.clear(std::memory_order_release);
+}
+
+uint32_t JobSystem::defaultWorkerCount() {
+    uint32_t hardwareThreads = std::thread::hardware_concurrency();
+
+    return hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+}
+
+JobSystem::JobSystem(uint32_t workerCount) {
+    workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++) {
+        workers.push_back(new Worker());
+    }
+
+    for (uint32_t i = 0; i < workerCount; i++) {
+        workers[i]->thread = std::thread(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    running.store(false, std::memory_order_seq_cst);
+
+    {
+        std::lock_guard<std::mutex> guard(sleepMutex);
+    }
+    sleepCondition.notify_all();
+
+    for (auto worker: workers) {
+        worker->thread.join();
+        delete worker;
+    }
+}
+
+void JobSystem::wait(JobCounter *counter) {
+    Worker *self = currentSystem == this ? static_cast<Worker *>(currentWorker) : nullptr;
+    uint32_t stealIndex = 0;
+
+    while (!counter->isDone()) {
+        Job *job = findJob(self, stealIndex);
+
+        if (job != nullptr) {
+            execute(job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    // The last job may still be inside the counter's critical section.
+    counter->acquire();
+    std::exception_ptr exception = std::move(counter->exception);
+    counter->exception = nullptr;
+    counter->release();
+
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+void JobSystem::workerLoop(uint32_t index) {
+    Worker *self = workers[index];
+    currentSystem = this;
+    currentWorker = self;
+
+    uint32_t stealIndex = index + 1;
+    uint32_t idle = 0;
+
+    while (running.load(std::memory_order_acquire)) {
+        Job *job = findJob(self, stealIndex);
+
+        if (job != nullptr) {
+            execute(job);
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < IDLE_SPINS) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+        sleepCondition.wait(lock, [this]() {
+            return pendingJobs.load(std::memory_order_seq_cst) != 0 || !running.load(std::memory_order_seq_cst);
+        });
+        sleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+        idle = 0;
+    }
+}
+
+Job *JobSystem::allocateJob() {
+    if (!jobPool) {
+        jobPool.reset(new Job[JOB_POOL_SIZE]);
+    }
+
+    Job *job = claimJob(0, JOB_POOL_WINDOW);
+    if (job != nullptr) {
+        return job;
+    }
+
+    // Likely every slot is in flight. Throwing here would leave the caller's counter referenced by the jobs already
+    // scheduled, so work them off like wait() does until one is released.
+    Worker *self = currentSystem == this ? static_cast<Worker *>(currentWorker) : nullptr;
+    uint32_t stealIndex = 0;
+
+    while (true) {
+        Job *pending = findJob(self, stealIndex);
+
+        if (pending != nullptr) {
+            execute(pending);
+
+            job = claimJob(0, JOB_POOL_WINDOW);
+            if (job != nullptr) {
+                return job;
+            }
+        }
+
+        // Slots past the window are held longer, continuations waiting on a counter for example.
+        job = claimJob(JOB_POOL_WINDOW, JOB_POOL_SIZE);
+        if (job != nullptr) {
+            return job;
+        }
+
+        if (pending == nullptr) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::schedule(Job *job) {
+    // Counted before it becomes visible so a thief can never take pendingJobs below zero.
+    pendingJobs.fetch_add(1, std::memory_order_seq_cst);
+
+    bool pushed = false;
+
+    if (currentSystem == this) {
+        pushed = static_cast<Worker *>(currentWorker)->deque.push(job);
+    }
+
+    if (!pushed) {
+        std::lock_guard<std::mutex> guard(injectionMutex);
+        injectionQueue.push_back(job);
+    }
+
+    wakeWorkers(1);
+}
+
+Job *JobSystem::findJob(Worker *self, uint32_t &stealIndex) {
+    if (pendingJobs.load(std::memory_order_acquire) == 0) {
+        return nullptr;
+    }
+
+    Job *job = nullptr;
+
+    if (self != nullptr) {
+        job = self->deque.pop();
+    }
+
+    if (job == nullptr) {
+        std::lock_guard<std::mutex> guard(injectionMutex);
+        if (!injectionQueue.empty()) {
+            job = injectionQueue.front();
+            injectionQueue.pop_front();
+        }
+    }
+
+    for (uint32_t i = 0; job == nullptr && i < workers.size(); i++) {
+        Worker *victim = workers[stealIndex++ % workers.size()];
+
+        if (victim != self) {
+            job = victim->deque.steal();
+        }
+    }
+
+    if (job != nullptr) {
+        pendingJobs.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+void JobSystem::execute(Job *job) {
+    std::exception_ptr exception;
+
+    try {
+        job->function(job);
+    } catch (...) {
+        exception = std::current_exception();
+    }
+
+    JobCounter *counter = job->counter;
+    job->inUse.store(false, std::memory_order_release);
+
+    if (counter == nullptr) {
+        if (exception) {
+            std::terminate();
+        }
+
+        return;
+    }
+
+    std::vector<Job *> ready;
+
+    counter->acquire();
+    if (exception && !counter->exception) {
+        counter->exception = exception;
+    }
+
+    if (counter->value.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        ready.swap(counter->continuations);
+    }
+    counter->release();
+
+    for (auto continuation: ready) {
+        schedule(continuation);
+    }
+}
+
+void JobSystem::wakeWorkers(uint32_t count) {
+    if (sleepingWorkers.load(std::memory_order_seq_cst) == 0) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(sleepMutex);
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        sleepCondition.notify_one();
+    }
+}
@@ -0,0 +1,205 @@
+#ifndef VULKAN_TRY_JOBSYSTEM_H
+#define VULKAN_TRY_JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "ChaseLevDeque.h"
+
+namespace vtr {
+    struct Job;
+
+    /*
+     * Counts unfinished jobs. Jobs scheduled with JobSystem::runAfter() are held in the counter until it drops
+     * to zero. A counter must outlive every job that references it, JobSystem::wait() guarantees that once it
+     * returns no job touches the counter anymore.
+     *
+     * A job that throws still counts as finished. The counter keeps the first exception of its jobs and wait()
+     * rethrows it, continuations run regardless.
+     */
+    class JobCounter {
+    public:
+        JobCounter() = default;
+
+        JobCounter(const JobCounter &) = delete;
+
+        JobCounter &operator=(const JobCounter &) = delete;
+
+        inline bool isDone() const {
+            return value.load(std::memory_order_acquire) == 0;
+        }
+
+    private:
+        friend class JobSystem;
+
+        std::atomic<uint32_t> value{0};
+
+        // Guards continuations and the final decrement.
+        std::atomic_flag lock = ATOMIC_FLAG_INIT;
+
+        std::vector<Job *> continuations;
+
+        // Taken by wait(), which leaves the counter ready for reuse.
+        std::exception_ptr exception;
+
+        void acquire();
+
+        void release();
+    };
+
+    struct Job {
+        static const uint32_t PAYLOAD_SIZE = 80;
+
+        void (*function)(Job *job);
+
+        JobCounter *counter;
+
+        std::atomic<bool> inUse{false};
+
+        alignas(16) unsigned char payload[PAYLOAD_SIZE];
+    };
+
+    /*
+     * Work-stealing job system. Every worker owns a Chase-Lev deque and steals from the others when it runs dry.
+     * Threads that are not workers (main, render) submit through a shared injection queue and help executing jobs
+     * while they wait on a counter.
+     */
+    class JobSystem {
+    public:
+        static const uint32_t DEQUE_CAPACITY = 4096;
+
+        // Jobs in flight per submitting thread. Past it, submitting helps executing jobs until a slot frees up.
+        static const uint32_t JOB_POOL_SIZE = 4096;
+
+        // One worker less than the hardware threads, the waiting thread makes up the last one.
+        static uint32_t defaultWorkerCount();
+
+        // With zero workers every job runs on the thread that waits for it.
+        explicit JobSystem(uint32_t workerCount = defaultWorkerCount());
+
+        JobSystem(const JobSystem &) = delete;
+
+        JobSystem &operator=(const JobSystem &) = delete;
+
+        ~JobSystem();
+
+        inline uint32_t getWorkerCount() const {
+            return static_cast<uint32_t>(workers.size());
+        }
+
+        // A job run without a counter has nowhere to hand an exception to, throwing from it terminates.
+        template<typename F>
+        void run(F &&function, JobCounter *counter = nullptr) {
+            schedule(createJob(std::forward<F>(function), counter));
+        }
+
+        // Runs the job once dependency reaches zero.
+        template<typename F>
+        void runAfter(JobCounter *dependency, F &&function, JobCounter *counter = nullptr) {
+            Job *job = createJob(std::forward<F>(function), counter);
+
+            dependency->acquire();
+            if (dependency->value.load(std::memory_order_acquire) != 0) {
+                dependency->continuations.push_back(job);
+                dependency->release();
+                return;
+            }
+            dependency->release();
+
+            schedule(job);
+        }
+
+        // Calls function(begin, end) for batches of at most batchSize indices and waits for all of them. Rethrows the
+        // first exception of a batch once every batch is done.
+        template<typename F>
+        void parallelFor(uint32_t count, uint32_t batchSize, const F &function) {
+            if (count == 0) {
+                return;
+            }
+
+            batchSize = batchSize == 0 ? 1 : batchSize;
+
+            JobCounter counter;
+            for (uint32_t begin = 0; begin < count; begin += batchSize) {
+                uint32_t end = begin + batchSize < count ? begin + batchSize : count;
+
+                run([&function, begin, end]() { function(begin, end); }, &counter);
+            }
+
+            wait(&counter);
+        }
+
+        // Executes pending jobs on the calling thread until counter reaches zero, then rethrows the first exception of
+        // its jobs.
+        void wait(JobCounter *counter);
+
+    private:
+        struct Worker {
+            ChaseLevDeque<Job *, DEQUE_CAPACITY> deque;
+            std::thread thread;
+        };
+
+        std::vector<Worker *> workers;
+
+        std::mutex injectionMutex;
+        std::deque<Job *> injectionQueue;
+
+        std::atomic<bool> running{true};
+        std::atomic<uint32_t> pendingJobs{0};
+
+        std::mutex sleepMutex;
+        std::condition_variable sleepCondition;
+        std::atomic<uint32_t> sleepingWorkers{0};
+
+        void workerLoop(uint32_t index);
+
+        template<typename F>
+        Job *createJob(F &&function, JobCounter *counter) {
+            using Function = typename std::decay<F>::type;
+            static_assert(sizeof(Function) <= Job::PAYLOAD_SIZE, "job capture is too large");
+            static_assert(alignof(Function) <= 16, "job capture is over aligned");
+
+            Job *job = allocateJob();
+            new(job->payload) Function(std::forward<F>(function));
+            job->function = [](Job *job) {
+                // Destroyed on the way out whether or not the call throws.
+                struct Destroy {
+                    Function *function;
+
+                    ~Destroy() {
+                        function->~Function();
+                    }
+                } destroy{reinterpret_cast<Function *>(job->payload)};
+
+                (*destroy.function)();
+            };
+            job->counter = counter;
+
+            if (counter != nullptr) {
+                counter->value.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            return job;
+        }
+
+        Job *allocateJob();
+
+        void schedule(Job *job);
+
+        Job *findJob(Worker *self, uint32_t &stealIndex);
+
+        void execute(Job *job);
+
+        void wakeWorkers(uint32_t count);
+    };
+}
+
+#endif //VULKAN_TRY_JOBSYSTEM_H
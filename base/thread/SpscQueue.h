@@ -0,0 +1,54 @@
+#ifndef VULKAN_TRY_SPSCQUEUE_H
+#define VULKAN_TRY_SPSCQUEUE_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace vtr {
+    /*
+     * Bounded wait-free single producer single consumer queue. Capacity must be a power of two.
+     */
+    template<typename T, uint32_t Capacity>
+    class SpscQueue {
+        static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    public:
+        bool push(const T &value) {
+            uint32_t tail = this->tail.load(std::memory_order_relaxed);
+
+            if (tail - head.load(std::memory_order_acquire) == Capacity) {
+                return false;
+            }
+
+            slots[tail & (Capacity - 1)] = value;
+            this->tail.store(tail + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        bool pop(T &value) {
+            uint32_t head = this->head.load(std::memory_order_relaxed);
+
+            if (head == tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+
+            value = slots[head & (Capacity - 1)];
+            this->head.store(head + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        bool empty() const {
+            return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+        }
+
+    private:
+        T slots[Capacity];
+
+        alignas(64) std::atomic<uint32_t> head{0};
+        alignas(64) std::atomic<uint32_t> tail{0};
+    };
+}
+
+#endif //VULKAN_TRY_SPSCQUEUE_H
@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <cstring>
+#include "VulkanAssetStreamer.h"
+#include "VulkanHelper.h"
+#include "../log/Logger.h"
+#include "../mesh/MeshSimplifier.h"
+
+VulkanAssetStreamer::VulkanAssetStreamer(VulkanDevice &device, vtr::JobSystem &jobSystem, VkDeviceSize uploadBudget)
+        : device(device), jobSystem(jobSystem), uploadBudget(uploadBudget) {
+    VkCommandPoolCreateInfo poolCreateInfo = {};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolCreateInfo.queueFamilyIndex = device.queueFamilyIndices.graphicsFamily.value();
+    poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    VK_CHECK_RESULT(vkCreateCommandPool(device.logicalDevice, &poolCreateInfo, nullptr, &commandPool))
+
+    for (auto &slot: slots) {
+        vtr::createBuffer(device.logicalDevice, device.physicalDevice, device.memoryTracker, MemoryCategory::Staging,
+                          uploadBudget, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, slot.buffer,
+                          slot.memory);
+
+        void *mapping;
+        VK_CHECK_RESULT(vkMapMemory(device.logicalDevice, slot.memory, 0, uploadBudget, 0, &mapping))
+        slot.mapping = static_cast<uint8_t *>(mapping);
+
+        VkCommandBufferAllocateInfo allocateInfo = {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandPool = commandPool;
+        allocateInfo.commandBufferCount = 1;
+
+        VK_CHECK_RESULT(vkAllocateCommandBuffers(device.logicalDevice, &allocateInfo, &slot.commandBuffer))
+
+        VkFenceCreateInfo fenceCreateInfo = {};
+        fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        VK_CHECK_RESULT(vkCreateFence(device.logicalDevice, &fenceCreateInfo, nullptr, &slot.fence))
+
+        slot.submitted = false;
+    }
+}
+
+VulkanAssetStreamer::~VulkanAssetStreamer() {
+    // Loads still running write to loaded, let them finish first.
+    jobSystem.wait(&loadCounter);
+
+    for (auto &slot: slots) {
+        if (slot.submitted) {
+            vkWaitForFences(device.logicalDevice, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+        }
+
+        vkDestroyFence(device.logicalDevice, slot.fence, nullptr);
+        vkDestroyBuffer(device.logicalDevice, slot.buffer, nullptr);
+        device.memoryTracker.free(slot.memory);
+    }
+
+    vkDestroyCommandPool(device.logicalDevice, commandPool, nullptr);
+
+    for (auto &record: meshes) {
+        if (record.state == MeshState::Uploading || record.state == MeshState::Resident) {
+            vkDestroyBuffer(device.logicalDevice, record.mesh.indexBuffer, nullptr);
+            device.memoryTracker.free(record.mesh.indexBufferMemory);
+            vkDestroyBuffer(device.logicalDevice, record.mesh.vertexBuffer, nullptr);
+            device.memoryTracker.free(record.mesh.vertexBufferMemory);
+        }
+    }
+}
+
+MeshHandle VulkanAssetStreamer::addRecord(const std::string &path) {
+    auto handle = static_cast<MeshHandle>(meshes.size());
+
+    MeshRecord record = {};
+    record.path = path;
+    record.state = MeshState::Loading;
+    record.requestTime = std::chrono::steady_clock::now();
+    meshes.push_back(record);
+
+    return handle;
+}
+
+MeshHandle VulkanAssetStreamer::requestMesh(const std::string &path) {
+    MeshHandle handle = addRecord(path);
+
+    jobSystem.run([this, handle, path]() { loadMesh(handle, path); }, &loadCounter);
+
+    return handle;
+}
+
+MeshHandle VulkanAssetStreamer::requestMesh(const std::string &path, std::unique_ptr<vtr::MeshFile> file) {
+    MeshHandle handle = addRecord(path);
+
+    jobSystem.run([this, handle, path, file = std::move(file)]() mutable {
+        prepareMesh(handle, path, std::move(file));
+    }, &loadCounter);
+
+    return handle;
+}
+
+std::unique_ptr<vtr::MeshFile> VulkanAssetStreamer::loadFile(const std::string &path) {
+    std::unique_ptr<vtr::MeshFile> file(new vtr::MeshFile(path));
+
+    // Fault the streams in here so the render thread only ever copies resident pages.
+    const vtr::MeshFileHeader &header = file->getHeader();
+    const auto *vertexData = static_cast<const volatile uint8_t *>(file->getVertexData());
+    const auto *indexData = static_cast<const volatile uint8_t *>(file->getIndexData());
+
+    for (uint64_t offset = 0; offset < header.vertexSize; offset += 4096) {
+        (void) vertexData[offset];
+    }
+    for (uint64_t offset = 0; offset < header.indexSize; offset += 4096) {
+        (void) indexData[offset];
+    }
+
+    return file;
+}
+
+void VulkanAssetStreamer::loadMesh(MeshHandle handle, const std::string &path) {
+    std::unique_ptr<vtr::MeshFile> file;
+
+    try {
+        file = loadFile(path);
+    } catch (const std::exception &exception) {
+        LOG_ERROR("Failed to stream %s: %s", path.c_str(), exception.what());
+    }
+
+    prepareMesh(handle, path, std::move(file));
+}
+
+void VulkanAssetStreamer::prepareMesh(MeshHandle handle, const std::string &path,
+                                      std::unique_ptr<vtr::MeshFile> file) {
+    LoadedMesh result = {handle, std::move(file), {}, {}};
+
+    if (result.file) {
+        const vtr::MeshFileHeader &header = result.file->getHeader();
+        const vtr::MeshLod *fileLods = result.file->getLods();
+
+        uint32_t lodCount = std::min(header.lodCount, vtr::MESH_MAX_LODS);
+        result.lods.assign(fileLods, fileLods + lodCount);
+
+        if (lodCount <= 1) {
+            try {
+                auto started = std::chrono::steady_clock::now();
+
+                std::vector<uint32_t> indices(header.indexCount);
+                if (header.indexType == vtr::MESH_INDEX_UINT16) {
+                    const auto *fileIndices = static_cast<const uint16_t *>(result.file->getIndexData());
+                    std::copy(fileIndices, fileIndices + header.indexCount, indices.begin());
+                } else {
+                    memcpy(indices.data(), result.file->getIndexData(), header.indexSize);
+                }
+
+                // LOD 0 is the whole index stream when the file has no table at all.
+                if (lodCount == 1) {
+                    indices = std::vector<uint32_t>(indices.begin() + result.lods[0].indexOffset,
+                                                    indices.begin() + result.lods[0].indexOffset +
+                                                    result.lods[0].indexCount);
+                }
+
+                std::vector<float> positions = vtr::MeshSimplifier::decodePositions(header,
+                                                                                    result.file->getVertexData());
+                vtr::MeshSimplifier::buildLodChain(positions.data(), header.vertexCount, indices, result.lods);
+
+                uint32_t indexSize = vtr::meshIndexSize(header.indexType);
+                result.indices.resize(indices.size() * indexSize);
+
+                if (header.indexType == vtr::MESH_INDEX_UINT16) {
+                    auto *packed = reinterpret_cast<uint16_t *>(result.indices.data());
+                    for (size_t i = 0; i < indices.size(); i++) {
+                        packed[i] = static_cast<uint16_t>(indices[i]);
+                    }
+                } else {
+                    memcpy(result.indices.data(), indices.data(), result.indices.size());
+                }
+
+                std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - started;
+                LOG_INFO("Generated %zu LODs for %s in %.1f ms", result.lods.size(), path.c_str(), elapsed.count());
+            } catch (const std::exception &exception) {
+                // Drawn at full detail only.
+                LOG_WARNING("Failed to generate LODs for %s: %s", path.c_str(), exception.what());
+                result.lods = {{0, header.indexCount, 0.0f, 0}};
+                result.indices.clear();
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(loadedMutex);
+    loaded.push_back(std::move(result));
+}
+
+void VulkanAssetStreamer::update() {
+    retireUploads();
+    beginUploads();
+
+    if (pendingUploads.empty()) {
+        return;
+    }
+
+    for (auto &slot: slots) {
+        if (!slot.submitted) {
+            submitUpload(slot);
+            return;
+        }
+    }
+}
+
+const StreamedMesh *VulkanAssetStreamer::getMesh(MeshHandle handle) const {
+    if (handle >= meshes.size() || meshes[handle].state != MeshState::Resident) {
+        return nullptr;
+    }
+
+    return &meshes[handle].mesh;
+}
+
+void VulkanAssetStreamer::retireUploads() {
+    for (auto &slot: slots) {
+        if (!slot.submitted || vkGetFenceStatus(device.logicalDevice, slot.fence) != VK_SUCCESS) {
+            continue;
+        }
+
+        VK_CHECK_RESULT(vkResetFences(device.logicalDevice, 1, &slot.fence))
+        slot.submitted = false;
+
+        // The fence also covers earlier uploads on the queue, so every chunk of these meshes has landed.
+        for (auto &upload: slot.completing) {
+            MeshRecord &record = meshes[upload.handle];
+            record.state = MeshState::Resident;
+
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - record.requestTime;
+            LOG_INFO("Streamed %s in %.1f ms", record.path.c_str(), elapsed.count());
+        }
+
+        slot.completing.clear();
+    }
+}
+
+void VulkanAssetStreamer::beginUploads() {
+    std::vector<LoadedMesh> ready;
+    {
+        std::lock_guard<std::mutex> lock(loadedMutex);
+        ready.swap(loaded);
+    }
+
+    for (auto &loadedMesh: ready) {
+        MeshRecord &record = meshes[loadedMesh.handle];
+
+        if (!loadedMesh.file) {
+            record.state = MeshState::Failed;
+            continue;
+        }
+
+        const vtr::MeshFileHeader &header = loadedMesh.file->getHeader();
+        StreamedMesh &mesh = record.mesh;
+
+        const void *indexData = loadedMesh.file->getIndexData();
+        VkDeviceSize indexSize = header.indexSize;
+        if (!loadedMesh.indices.empty()) {
+            indexData = loadedMesh.indices.data();
+            indexSize = loadedMesh.indices.size();
+        }
+
+        vtr::createBuffer(device.logicalDevice, device.physicalDevice, device.memoryTracker, MemoryCategory::Buffer,
+                          header.vertexSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh.vertexBuffer, mesh.vertexBufferMemory);
+        vtr::createBuffer(device.logicalDevice, device.physicalDevice, device.memoryTracker, MemoryCategory::Buffer,
+                          indexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh.indexBuffer, mesh.indexBufferMemory);
+
+        mesh.vertexFormat = header.vertexFormat;
+        mesh.indexType = header.indexType == vtr::MESH_INDEX_UINT16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+        mesh.bounds = glm::vec4(header.boundingSphere[0], header.boundingSphere[1], header.boundingSphere[2],
+                                header.boundingSphere[3]);
+
+        mesh.lodCount = static_cast<uint32_t>(loadedMesh.lods.size());
+        std::copy(loadedMesh.lods.begin(), loadedMesh.lods.end(), mesh.lods);
+
+        if (header.vertexFormat == vtr::MESH_VERTEX_QUANTIZED) {
+            glm::vec3 boundsMin(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+            glm::vec3 boundsMax(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+
+            mesh.positionOffset = glm::vec4(boundsMin, 0.0f);
+            mesh.positionScale = glm::vec4(boundsMax - boundsMin, 1.0f);
+        } else {
+            mesh.positionOffset = glm::vec4(0.0f);
+            mesh.positionScale = glm::vec4(1.0f);
+        }
+
+        PendingUpload upload;
+        upload.handle = loadedMesh.handle;
+        upload.regions.push_back({static_cast<const uint8_t *>(loadedMesh.file->getVertexData()), mesh.vertexBuffer,
+                                  header.vertexSize, 0});
+        upload.regions.push_back({static_cast<const uint8_t *>(indexData), mesh.indexBuffer, indexSize, 0});
+        upload.currentRegion = 0;
+        upload.file = std::move(loadedMesh.file);
+        // Moving the vector keeps the region pointing at its data.
+        upload.indices = std::move(loadedMesh.indices);
+
+        record.state = MeshState::Uploading;
+        pendingBytes += header.vertexSize + indexSize;
+        pendingUploads.push_back(std::move(upload));
+    }
+}
+
+void VulkanAssetStreamer::submitUpload(StagingSlot &slot) {
+    VK_CHECK_RESULT(vkResetCommandBuffer(slot.commandBuffer, 0))
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    VK_CHECK_RESULT(vkBeginCommandBuffer(slot.commandBuffer, &beginInfo))
+
+    VkDeviceSize stagingOffset = 0;
+
+    while (!pendingUploads.empty() && stagingOffset < uploadBudget) {
+        PendingUpload &upload = pendingUploads.front();
+        UploadRegion &region = upload.regions[upload.currentRegion];
+
+        VkDeviceSize chunk = std::min(region.size - region.copied, uploadBudget - stagingOffset);
+        memcpy(slot.mapping + stagingOffset, region.source + region.copied, (size_t) chunk);
+
+        VkBufferCopy copy = {stagingOffset, region.copied, chunk};
+        vkCmdCopyBuffer(slot.commandBuffer, slot.buffer, region.destination, 1, &copy);
+
+        // Chunks start 4 byte aligned in staging memory.
+        stagingOffset += (chunk + 3) & ~VkDeviceSize(3);
+        region.copied += chunk;
+        pendingBytes -= chunk;
+
+        if (region.copied == region.size && ++upload.currentRegion == upload.regions.size()) {
+            slot.completing.push_back(std::move(upload));
+            pendingUploads.pop_front();
+        }
+    }
+
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+
+    vkCmdPipelineBarrier(slot.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0,
+                         1, &barrier, 0, nullptr, 0, nullptr);
+
+    VK_CHECK_RESULT(vkEndCommandBuffer(slot.commandBuffer))
+
+    // Same queue as drawing and enqueued ahead of the frame, submission order makes the copies visible to it.
+    device.submitScheduler.enqueue(device.graphicsQueue, {{slot.commandBuffer}, {}, {}, {}, slot.fence});
+    slot.submitted = true;
+}
@@ -0,0 +1,158 @@
+#ifndef VULKAN_TRY_VULKANASSETSTREAMER_H
+#define VULKAN_TRY_VULKANASSETSTREAMER_H
+
+#include <vulkan/vulkan.h>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "VulkanDevice.h"
+#include "../mesh/MeshFile.h"
+#include "../scene/SceneMath.h"
+#include "../thread/JobSystem.h"
+
+typedef uint32_t MeshHandle;
+
+struct StreamedMesh {
+    VkBuffer vertexBuffer;
+    VkDeviceMemory vertexBufferMemory;
+
+    VkBuffer indexBuffer;
+    VkDeviceMemory indexBufferMemory;
+
+    uint32_t vertexFormat;
+    VkIndexType indexType;
+
+    // Ranges of the index buffer, LOD 0 first. Every level indexes the same vertices.
+    uint32_t lodCount;
+    vtr::MeshLod lods[vtr::MESH_MAX_LODS];
+
+    // Pushed to the vertex shader, position = positionOffset + value * positionScale for quantized formats.
+    glm::vec4 positionOffset;
+    glm::vec4 positionScale;
+
+    // xyz center and w radius.
+    glm::vec4 bounds;
+};
+
+/*
+ * Streams meshes in without blocking the render thread. Files are mapped and validated on job system workers, the
+ * render thread then copies at most uploadBudget bytes per frame through a staging ring and a mesh becomes
+ * drawable once the transfer holding its last bytes has completed. Everything but the loads runs on the render
+ * thread, requestMesh() may also be called before the render thread starts.
+ *
+ * Files without a LOD chain, e.g. written before meshconv built them, get one generated on the loading worker.
+ */
+class VulkanAssetStreamer {
+public:
+    // Uploads in flight at once, each one owns uploadBudget bytes of staging memory.
+    static const uint32_t STAGING_SLOTS = 2;
+
+    VulkanAssetStreamer(VulkanDevice &device, vtr::JobSystem &jobSystem, VkDeviceSize uploadBudget);
+
+    VulkanAssetStreamer(const VulkanAssetStreamer &) = delete;
+
+    VulkanAssetStreamer &operator=(const VulkanAssetStreamer &) = delete;
+
+    ~VulkanAssetStreamer();
+
+    MeshHandle requestMesh(const std::string &path);
+
+    // Takes a file mapped by loadFile() ahead of time, e.g. while the device was created.
+    MeshHandle requestMesh(const std::string &path, std::unique_ptr<vtr::MeshFile> file);
+
+    // Maps and validates the file and faults its streams in. Throws on failure, safe to call from any thread.
+    static std::unique_ptr<vtr::MeshFile> loadFile(const std::string &path);
+
+    // Call once per frame, retires finished uploads and enqueues the next one for the frame.
+    void update();
+
+    // nullptr until the mesh is resident, callers draw a placeholder meanwhile. Failed loads stay nullptr.
+    const StreamedMesh *getMesh(MeshHandle handle) const;
+
+    inline VkDeviceSize getPendingBytes() const {
+        return pendingBytes;
+    }
+
+private:
+    enum class MeshState {
+        Loading, Uploading, Resident, Failed
+    };
+
+    struct MeshRecord {
+        std::string path;
+        MeshState state;
+        StreamedMesh mesh;
+        std::chrono::steady_clock::time_point requestTime;
+    };
+
+    struct LoadedMesh {
+        MeshHandle handle;
+        std::unique_ptr<vtr::MeshFile> file;
+        std::vector<vtr::MeshLod> lods;
+        // Generated LOD chain in the file's index type, replaces its index stream. Empty when the file has one.
+        std::vector<uint8_t> indices;
+    };
+
+    // One stream of a mesh, copied in budget sized chunks.
+    struct UploadRegion {
+        const uint8_t *source;
+        VkBuffer destination;
+        VkDeviceSize size;
+        VkDeviceSize copied;
+    };
+
+    struct PendingUpload {
+        MeshHandle handle;
+        std::unique_ptr<vtr::MeshFile> file;
+        std::vector<uint8_t> indices;
+        std::vector<UploadRegion> regions;
+        size_t currentRegion;
+    };
+
+    struct StagingSlot {
+        VkBuffer buffer;
+        VkDeviceMemory memory;
+        uint8_t *mapping;
+        VkCommandBuffer commandBuffer;
+        VkFence fence;
+        bool submitted;
+        // Meshes whose last bytes are in this upload, and the files backing them.
+        std::vector<PendingUpload> completing;
+    };
+
+    VulkanDevice &device;
+    vtr::JobSystem &jobSystem;
+    VkDeviceSize uploadBudget;
+
+    VkCommandPool commandPool;
+    StagingSlot slots[STAGING_SLOTS];
+
+    std::vector<MeshRecord> meshes;
+
+    // Written by job system workers, drained by update().
+    std::mutex loadedMutex;
+    std::vector<LoadedMesh> loaded;
+    vtr::JobCounter loadCounter;
+
+    std::deque<PendingUpload> pendingUploads;
+    VkDeviceSize pendingBytes = 0;
+
+    MeshHandle addRecord(const std::string &path);
+
+    void loadMesh(MeshHandle handle, const std::string &path);
+
+    // Reads or generates the LOD chain of a loaded file and hands it to update().
+    void prepareMesh(MeshHandle handle, const std::string &path, std::unique_ptr<vtr::MeshFile> file);
+
+    void retireUploads();
+
+    void beginUploads();
+
+    void submitUpload(StagingSlot &slot);
+};
+
+
+#endif //VULKAN_TRY_VULKANASSETSTREAMER_H
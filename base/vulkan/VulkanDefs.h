@@ -21,6 +21,9 @@ namespace vtr {
 
     const static bool enableValidationLayers = true;
 
+    // Record attachments with VK_KHR_dynamic_rendering where supported instead of render passes and framebuffers.
+    const static bool enableDynamicRendering = true;
+
     const static uint32_t MAX_FRAMES_IN_FLIGHT = 2;
 }
 
@@ -2,6 +2,7 @@
 #include <set>
 #include "VulkanDevice.h"
 #include "VulkanHelper.h"
+#include "../log/Profiler.h"
 
 void VulkanDevice::initVulkanDevice(const VkInstance &instance, const VkSurfaceKHR &surface) {
     this->instance = instance;
@@ -13,6 +14,8 @@ void VulkanDevice::initVulkanDevice(const VkInstance &instance, const VkSurfaceK
 }
 
 void VulkanDevice::pickPhysicalDevice() {
+    PROFILE_ZONE("pick physical device");
+
     uint32_t deviceCount;
     vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
 
@@ -32,9 +35,12 @@ void VulkanDevice::pickPhysicalDevice() {
 }
 
 void VulkanDevice::createLogicalDevice() {
+    PROFILE_ZONE("create logical device");
+
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueIndices = {queueFamilyIndices.presentFamily.value(),
-                                             queueFamilyIndices.graphicsFamily.value()};
+                                             queueFamilyIndices.graphicsFamily.value(),
+                                             queueFamilyIndices.computeFamily.value()};
 
     float queuePriority = 1.0f;
     for (const auto &queueIndex: uniqueQueueIndices) {
@@ -46,13 +52,42 @@ void VulkanDevice::createLogicalDevice() {
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+    // Block compressed textures are picked per device, whichever families exist get enabled.
     VkPhysicalDeviceFeatures deviceFeatures = {};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+    deviceFeatures.textureCompressionASTC_LDR = supportedFeatures.textureCompressionASTC_LDR;
+    deviceFeatures.textureCompressionETC2 = supportedFeatures.textureCompressionETC2;
+    enabledFeatures = deviceFeatures;
+
+    std::vector<const char *> enabledExtensions = deviceExtensions;
+
+    // On a 1.1 instance dynamic rendering needs the extensions it was built on as well.
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures = {};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+
+    dynamicRendering = enableDynamicRendering && supportsDynamicRendering(physicalDevice);
+
+    if (dynamicRendering) {
+        enabledExtensions.push_back(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME);
+        enabledExtensions.push_back(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME);
+        enabledExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+    }
+
+    bool memoryBudget = isExtensionAvailable(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (memoryBudget) {
+        enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
 
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    createInfo.enabledExtensionCount = deviceExtensions.size();
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.pNext = dynamicRendering ? &dynamicRenderingFeatures : nullptr;
+    createInfo.enabledExtensionCount = enabledExtensions.size();
+    createInfo.ppEnabledExtensionNames = enabledExtensions.data();
     createInfo.pEnabledFeatures = &deviceFeatures;
     createInfo.enabledLayerCount = validationLayers.size();
     createInfo.ppEnabledLayerNames = validationLayers.data();
@@ -63,6 +98,20 @@ void VulkanDevice::createLogicalDevice() {
 
     vkGetDeviceQueue(logicalDevice, queueFamilyIndices.graphicsFamily.value(), 0, &graphicsQueue);
     vkGetDeviceQueue(logicalDevice, queueFamilyIndices.presentFamily.value(), 0, &presentQueue);
+    vkGetDeviceQueue(logicalDevice, queueFamilyIndices.computeFamily.value(), 0, &computeQueue);
+
+    asyncCompute = queueFamilyIndices.computeFamily != queueFamilyIndices.graphicsFamily;
+
+    memoryTracker.init(physicalDevice, logicalDevice, memoryBudget);
+
+    if (dynamicRendering) {
+        cmdBeginRendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(
+                vkGetDeviceProcAddr(logicalDevice, "vkCmdBeginRenderingKHR"));
+        cmdEndRendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(
+                vkGetDeviceProcAddr(logicalDevice, "vkCmdEndRenderingKHR"));
+
+        dynamicRendering = cmdBeginRendering != nullptr && cmdEndRendering != nullptr;
+    }
 }
 
 bool VulkanDevice::isDeviceSuitable(const VkPhysicalDevice &device) {
@@ -111,6 +160,17 @@ QueueFamilyIndices VulkanDevice::findQueueFamily(const VkPhysicalDevice &device)
         i++;
     }
 
+    // Graphics families support compute as well, a separate one is only worth it when the hardware has one.
+    indices.computeFamily = indices.graphicsFamily;
+    for (uint32_t family = 0; family < queueFamilies.size(); family++) {
+        VkQueueFlags flags = queueFamilies[family].queueFlags;
+
+        if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT)) {
+            indices.computeFamily = family;
+            break;
+        }
+    }
+
     return indices;
 }
 
@@ -130,6 +190,41 @@ bool VulkanDevice::checkDeviceExtensionSupport(const VkPhysicalDevice &device) {
     return requiredExtensions.empty();
 }
 
+bool VulkanDevice::isExtensionAvailable(const VkPhysicalDevice &device, const char *extension) {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+    for (const auto &available: availableExtensions) {
+        if (strcmp(available.extensionName, extension) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool VulkanDevice::supportsDynamicRendering(const VkPhysicalDevice &device) {
+    if (!isExtensionAvailable(device, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) ||
+        !isExtensionAvailable(device, VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME) ||
+        !isExtensionAvailable(device, VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME)) {
+        return false;
+    }
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures = {};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &dynamicRenderingFeatures;
+
+    vkGetPhysicalDeviceFeatures2(device, &features);
+
+    return dynamicRenderingFeatures.dynamicRendering == VK_TRUE;
+}
+
 
 
 VulkanDevice::~VulkanDevice() {
@@ -7,12 +7,16 @@
 #include <stdexcept>
 #include <optional>
 #include "VulkanDefs.h"
+#include "VulkanMemoryTracker.h"
+#include "VulkanSubmitScheduler.h"
 
 using namespace vtr;
 
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    // A family without graphics support where the device has one, the graphics family otherwise.
+    std::optional<uint32_t> computeFamily;
 
     bool isComplete() {
         return graphicsFamily.has_value() && presentFamily.has_value();
@@ -29,6 +33,22 @@ public:
 
     VkQueue graphicsQueue;
     VkQueue presentQueue;
+    // Runs alongside graphicsQueue when asyncCompute is set, it is graphicsQueue otherwise.
+    VkQueue computeQueue;
+    bool asyncCompute = false;
+
+    VkPhysicalDeviceFeatures enabledFeatures = {};
+
+    // Every device memory allocation goes through here, set up once the logical device exists.
+    VulkanMemoryTracker memoryTracker;
+
+    // Every per frame queue submission goes through here, flushed once per frame.
+    VulkanSubmitScheduler submitScheduler;
+
+    // VK_KHR_dynamic_rendering is enabled, the entry points are loaded only then.
+    bool dynamicRendering = false;
+    PFN_vkCmdBeginRenderingKHR cmdBeginRendering = nullptr;
+    PFN_vkCmdEndRenderingKHR cmdEndRendering = nullptr;
 
     VulkanDevice() = default;
 
@@ -48,6 +68,10 @@ private:
 
     bool checkDeviceExtensionSupport(const VkPhysicalDevice &device);
 
+    bool isExtensionAvailable(const VkPhysicalDevice &device, const char *extension);
+
+    bool supportsDynamicRendering(const VkPhysicalDevice &device);
+
     void createLogicalDevice();
 };
 
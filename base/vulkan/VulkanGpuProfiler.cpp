@@ -0,0 +1,152 @@
+#include <algorithm>
+#include "VulkanGpuProfiler.h"
+#include "VulkanHelper.h"
+
+VulkanGpuProfiler::VulkanGpuProfiler(VulkanDevice &device, VkCommandPool commandPool) : device(device) {
+    uint32_t familyCount;
+    vkGetPhysicalDeviceQueueFamilyProperties(device.physicalDevice, &familyCount, nullptr);
+
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(device.physicalDevice, &familyCount, families.data());
+
+    uint32_t validBits = families[device.queueFamilyIndices.graphicsFamily.value()].timestampValidBits;
+
+    if (validBits == 0) {
+        LOG_WARNING("The graphics queue has no timestamps, GPU zones are not profiled");
+        return;
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device.physicalDevice, &properties);
+
+    supported = true;
+    timestampPeriod = properties.limits.timestampPeriod;
+    timestampMask = validBits < 64 ? (1ull << validBits) - 1 : ~0ull;
+    timestamps.resize(2 * MAX_ZONES);
+
+    VkQueryPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = 2 * MAX_ZONES;
+
+    for (auto &frame: frames) {
+        VK_CHECK_RESULT(vkCreateQueryPool(device.logicalDevice, &poolInfo, nullptr, &frame.queryPool))
+        frame.needsReset = true;
+    }
+
+    calibrate(commandPool);
+
+    lane = vtr::Profiler::instance().createLane("GPU graphics queue");
+}
+
+VulkanGpuProfiler::~VulkanGpuProfiler() {
+    for (auto &frame: frames) {
+        if (frame.queryPool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(device.logicalDevice, frame.queryPool, nullptr);
+        }
+    }
+}
+
+void VulkanGpuProfiler::beginFrame(uint32_t frame) {
+    currentFrame = frame;
+
+    Frame &current = frames[frame];
+    if (!supported || current.zoneCount == 0) {
+        return;
+    }
+
+    // The fence covered every query of the frame, waiting is never needed.
+    VkResult result = vkGetQueryPoolResults(device.logicalDevice, current.queryPool, 0, 2 * current.zoneCount,
+                                            2 * current.zoneCount * sizeof(uint64_t), timestamps.data(),
+                                            sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+    if (result == VK_SUCCESS) {
+        vtr::Profiler &profiler = vtr::Profiler::instance();
+        auto frameBegin = vtr::Profiler::Clock::time_point::max();
+        auto frameEnd = vtr::Profiler::Clock::time_point::min();
+
+        for (uint32_t i = 0; i < current.zoneCount; i++) {
+            auto begin = toCpuTime(timestamps[2 * i]);
+            auto end = toCpuTime(timestamps[2 * i + 1]);
+
+            frameBegin = std::min(frameBegin, begin);
+            frameEnd = std::max(frameEnd, end);
+
+            if (profiler.isEnabled()) {
+                profiler.record(lane, current.names[i], begin, end);
+            }
+        }
+
+        frameMilliseconds = std::chrono::duration<double, std::milli>(frameEnd - frameBegin).count();
+    } else if (result != VK_NOT_READY) {
+        VK_CHECK_RESULT(result)
+    }
+
+    current.zoneCount = 0;
+    current.needsReset = true;
+}
+
+uint32_t VulkanGpuProfiler::beginZone(VkCommandBuffer commandBuffer, const char *name) {
+    Frame &frame = frames[currentFrame];
+
+    if (!supported || frame.zoneCount == MAX_ZONES) {
+        return MAX_ZONES;
+    }
+
+    if (frame.needsReset) {
+        vkCmdResetQueryPool(commandBuffer, frame.queryPool, 0, 2 * MAX_ZONES);
+        frame.needsReset = false;
+    }
+
+    uint32_t zone = frame.zoneCount++;
+    frame.names[zone] = name;
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.queryPool, 2 * zone);
+
+    return zone;
+}
+
+void VulkanGpuProfiler::endZone(VkCommandBuffer commandBuffer, uint32_t zone) {
+    if (zone == MAX_ZONES) {
+        return;
+    }
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frames[currentFrame].queryPool,
+                        2 * zone + 1);
+}
+
+void VulkanGpuProfiler::calibrate(VkCommandPool commandPool) {
+    VkQueryPool queryPool = frames[0].queryPool;
+
+    VkCommandBuffer commandBuffer = vtr::beginSingleTimeCommands(device.logicalDevice, commandPool);
+    vkCmdResetQueryPool(commandBuffer, queryPool, 0, 1);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+
+    auto before = vtr::Profiler::Clock::now();
+    vtr::endSingleTimeCommands(device.logicalDevice, commandPool, device.graphicsQueue, commandBuffer);
+    auto after = vtr::Profiler::Clock::now();
+
+    VK_CHECK_RESULT(vkGetQueryPoolResults(device.logicalDevice, queryPool, 0, 1, sizeof(uint64_t),
+                                          &calibrationTicks, sizeof(uint64_t),
+                                          VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT))
+
+    calibrationTicks &= timestampMask;
+    calibrationTime = before + (after - before) / 2;
+
+    LOG_INFO("GPU timestamps calibrated to within %.3f ms",
+             std::chrono::duration<double, std::milli>(after - before).count() / 2.0);
+}
+
+vtr::Profiler::Clock::time_point VulkanGpuProfiler::toCpuTime(uint64_t ticks) const {
+    // Differences wrap around at timestampValidBits, sign extended they stay right across a wrap.
+    uint64_t delta = (ticks - calibrationTicks) & timestampMask;
+    auto signedDelta = static_cast<int64_t>(delta);
+    if (timestampMask != ~0ull && (delta & ((timestampMask >> 1) + 1)) != 0) {
+        signedDelta = static_cast<int64_t>(delta | ~timestampMask);
+    }
+
+    auto nanoseconds = std::chrono::nanoseconds(static_cast<int64_t>(static_cast<double>(signedDelta) *
+                                                                    timestampPeriod));
+
+    return calibrationTime + std::chrono::duration_cast<vtr::Profiler::Clock::duration>(nanoseconds);
+}
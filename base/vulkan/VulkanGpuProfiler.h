@@ -0,0 +1,77 @@
+#ifndef VULKAN_TRY_VULKANGPUPROFILER_H
+#define VULKAN_TRY_VULKANGPUPROFILER_H
+
+#include <vulkan/vulkan.h>
+#include "VulkanDevice.h"
+#include "../log/Profiler.h"
+
+/*
+ * GPU zones of the graphics queue from timestamp queries, handed to the profiler on a lane of their own so they sit
+ * on the same timeline as the CPU zones while it is enabled. Every frame in flight has a query pool, read back once
+ * the frame's fence has been waited on.
+ *
+ * Ticks are mapped to the CPU clock by one calibration at creation, a submit that only writes a timestamp, placed
+ * in the middle of the time the submit took. Zones are off by at most half of that, the log says how much. Without
+ * timestamp support on the graphics queue no zones are recorded.
+ */
+class VulkanGpuProfiler {
+public:
+    // Per frame, zones past it are not recorded.
+    static const uint32_t MAX_ZONES = 64;
+
+    VulkanGpuProfiler(VulkanDevice &device, VkCommandPool commandPool);
+
+    VulkanGpuProfiler(const VulkanGpuProfiler &) = delete;
+
+    VulkanGpuProfiler &operator=(const VulkanGpuProfiler &) = delete;
+
+    ~VulkanGpuProfiler();
+
+    // After the frame's fence has been waited on, before anything is recorded. Hands the zones the frame recorded
+    // last time to the profiler.
+    void beginFrame(uint32_t frame);
+
+    // Outside of render passes, name has to outlive the profiler. Returns what endZone() takes.
+    uint32_t beginZone(VkCommandBuffer commandBuffer, const char *name);
+
+    void endZone(VkCommandBuffer commandBuffer, uint32_t zone);
+
+    // From the first zone of the frame last read back to its last zone, 0 before any was.
+    inline double getFrameMilliseconds() const {
+        return frameMilliseconds;
+    }
+
+private:
+    struct Frame {
+        // Two queries per zone, its begin and its end.
+        VkQueryPool queryPool;
+        uint32_t zoneCount;
+        const char *names[MAX_ZONES];
+        // Reset by the first zone of the frame, resets are not allowed inside render passes.
+        bool needsReset;
+    };
+
+    VulkanDevice &device;
+    bool supported = false;
+
+    vtr::Profiler::Lane *lane = nullptr;
+
+    // Nanoseconds per tick, and the tick at calibrationTime.
+    double timestampPeriod = 1.0;
+    uint64_t timestampMask = ~0ull;
+    uint64_t calibrationTicks = 0;
+    vtr::Profiler::Clock::time_point calibrationTime;
+
+    Frame frames[MAX_FRAMES_IN_FLIGHT] = {};
+    uint32_t currentFrame = 0;
+
+    std::vector<uint64_t> timestamps;
+    double frameMilliseconds = 0.0;
+
+    void calibrate(VkCommandPool commandPool);
+
+    vtr::Profiler::Clock::time_point toCpuTime(uint64_t ticks) const;
+};
+
+
+#endif //VULKAN_TRY_VULKANGPUPROFILER_H
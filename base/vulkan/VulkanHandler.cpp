@@ -1,25 +1,47 @@
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include "VulkanHandler.h"
+#include "../log/Profiler.h"
 
-VulkanHandler::VulkanHandler(WindowManager *windowManager) {
-    this->windowManager = windowManager;
-    this->windowExtent = windowManager->getWindowExtent();
+VulkanHandler::VulkanHandler(const std::vector<WindowManager *> &windowManagers, bool vsync,
+                             StartupTimeline &timeline, const std::function<void(VulkanDevice &)> &deviceReady) {
+    if (windowManagers.empty()) {
+        throw std::runtime_error("at least one window is needed!");
+    }
+
+    views.resize(windowManagers.size());
+    for (size_t i = 0; i < windowManagers.size(); i++) {
+        views[i].windowManager = windowManagers[i];
+        views[i].windowExtent = windowManagers[i]->getWindowExtent();
+        views[i].swapChain.vsync = vsync;
+    }
 
-    initVulkan();
+    initVulkan(timeline, deviceReady);
 }
 
-void VulkanHandler::initVulkan() {
-    createInstance();
-    setupDebugMessenger();
-    createSurface();
-    device.initVulkanDevice(instance, surface);
-    createSwapChain();
-    createRenderPass();
-    createFramebuffers();
-    createCommandPool();
+void VulkanHandler::initVulkan(StartupTimeline &timeline, const std::function<void(VulkanDevice &)> &deviceReady) {
+    timeline.stage("instance", [this]() {
+        createInstance();
+        setupDebugMessenger();
+    });
+    timeline.stage("surface", [this]() { createSurfaces(); });
+    timeline.stage("device", [this]() {
+        device.initVulkanDevice(instance, views[0].surface);
+        checkPresentSupport();
+    });
+
+    if (deviceReady) {
+        deviceReady(device);
+    }
+
+    timeline.stage("swapchain", [this]() { createSwapChains(); });
+    timeline.stage("command pool", [this]() { createCommandPool(); });
 }
 
 void VulkanHandler::createInstance() {
+    PROFILE_ZONE("create instance");
+
     if (enableValidationLayers && !checkValidationLayersSupport(validationLayers)) {
         throw std::runtime_error("Unable to enable validation layers, not available.");
     }
@@ -57,21 +79,45 @@ void VulkanHandler::createInstance() {
 }
 
 void VulkanHandler::setupDebugMessenger() {
+    PROFILE_ZONE("debug messenger");
+
     if (enableValidationLayers) {
         VK_CHECK_RESULT(createDebugMessenger(instance, &debugMessenger))
     }
 }
 
-void VulkanHandler::createSurface() {
-    VK_CHECK_RESULT(windowManager->createSurface(instance, &surface))
+void VulkanHandler::createSurfaces() {
+    PROFILE_ZONE("create surfaces");
+
+    for (auto &view: views) {
+        VK_CHECK_RESULT(view.windowManager->createSurface(instance, &view.surface))
+    }
 }
 
-void VulkanHandler::updateFramebufferSize(VkExtent2D extent) {
-    windowExtent = extent;
+void VulkanHandler::checkPresentSupport() {
+    for (size_t i = 1; i < views.size(); i++) {
+        VkBool32 presentSupport = VK_FALSE;
+        vkGetPhysicalDeviceSurfaceSupportKHR(device.physicalDevice, device.queueFamilyIndices.presentFamily.value(),
+                                             views[i].surface, &presentSupport);
+
+        if (!presentSupport) {
+            throw std::runtime_error("a window can not be presented to from the primary window's queue!");
+        }
+    }
 }
 
 std::vector<const char *> VulkanHandler::getRequiredExtensions() {
-    auto requiredExtensions = windowManager->getRequiredInstanceExtensions();
+    // Window managers of one kind ask for the same extensions, mixed kinds need the union.
+    std::vector<const char *> requiredExtensions;
+    for (auto &view: views) {
+        for (const char *extension: view.windowManager->getRequiredInstanceExtensions()) {
+            bool listed = std::any_of(requiredExtensions.begin(), requiredExtensions.end(),
+                                      [extension](const char *other) { return strcmp(extension, other) == 0; });
+            if (!listed) {
+                requiredExtensions.push_back(extension);
+            }
+        }
+    }
 
     if (enableValidationLayers) {
         requiredExtensions.emplace_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -80,93 +126,29 @@ std::vector<const char *> VulkanHandler::getRequiredExtensions() {
     return requiredExtensions;
 }
 
-void VulkanHandler::createSwapChain() {
-    swapChain.initSwapChain(&device, surface, windowExtent);
-}
+void VulkanHandler::createSwapChains() {
+    PROFILE_ZONE("create swapchains");
 
-void VulkanHandler::createRenderPass() {
-    VkAttachmentDescription colorAttachment = {};
-    colorAttachment.format = swapChain.format;
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-    VkAttachmentReference colorAttachmentRef = {};
-    colorAttachmentRef.attachment = 0;
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpass = {};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorAttachmentRef;
-
-    VkSubpassDependency dependency = {};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-    VkRenderPassCreateInfo renderPassInfo = {};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = 1;
-    renderPassInfo.pAttachments = &colorAttachment;
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
-
-    VK_CHECK_RESULT(vkCreateRenderPass(device.logicalDevice, &renderPassInfo, nullptr, &renderPass))
-}
-
-void VulkanHandler::createFramebuffers() {
-    framebuffers.resize(swapChain.imageCount);
-
-    VkFramebufferCreateInfo createInfo = {};
-    createInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    createInfo.renderPass = renderPass;
-    createInfo.attachmentCount = 1;
-    createInfo.width = windowExtent.width;
-    createInfo.height = windowExtent.height;
-    createInfo.layers = 1;
-
-    uint32_t i = 0;
-    for (const auto &imageView: swapChain.imageViews) {
-
-        createInfo.pAttachments = &imageView;
-
-        VK_CHECK_RESULT(vkCreateFramebuffer(device.logicalDevice, &createInfo, nullptr, &framebuffers[i]))
-
-        i++;
+    for (auto &view: views) {
+        view.swapChain.initSwapChain(&device, view.surface, view.windowExtent);
     }
 }
 
 void VulkanHandler::createCommandPool() {
+    PROFILE_ZONE("create command pool");
+
     VkCommandPoolCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     createInfo.queueFamilyIndex = device.queueFamilyIndices.graphicsFamily.value();
+    // Command buffers are re-recorded every frame.
+    createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
     VK_CHECK_RESULT(vkCreateCommandPool(device.logicalDevice, &createInfo, nullptr, &commandPool))
 }
 
-void VulkanHandler::resizeCleanup() {
-    for (const auto &framebuffer: framebuffers) {
-        vkDestroyFramebuffer(device.logicalDevice, framebuffer, nullptr);
-    }
-
-    vkDestroyRenderPass(device.logicalDevice, renderPass, nullptr);
-}
-
-void VulkanHandler::resizeCallback(VkExtent2D extent) {
-    updateFramebufferSize(extent);
-    swapChain.resizeCallback(extent);
+void VulkanHandler::resizeCallback(uint32_t view, VkExtent2D extent) {
+    PROFILE_ZONE("recreate swapchain");
 
-    resizeCleanup();
-    createRenderPass();
-    createFramebuffers();
+    views[view].windowExtent = extent;
+    views[view].swapChain.resizeCallback(extent);
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#include <functional>
 #include <vector>
 #include <string>
 #include "VulkanHelper.h"
@@ -11,39 +12,44 @@
 #include "VulkanDevice.h"
 #include "VulkanSwapChain.h"
 #include "VulkanDefs.h"
+#include "../log/StartupTimeline.h"
 
 using namespace vtr;
 
-class VulkanHandler {
-public:
-    VkExtent2D windowExtent;
+// One window with its surface and swapchain. Views share the device, the command pool and everything built on them.
+struct VulkanView {
+    WindowManager *windowManager;
 
-    VulkanDevice device;
+    VkSurfaceKHR surface;
+
+    VkExtent2D windowExtent;
 
     VulkanSwapChain swapChain;
+};
 
-    VkRenderPass renderPass;
+class VulkanHandler {
+public:
+    VulkanDevice device;
 
-    VkCommandPool commandPool;
+    // The first view is the primary one, it picks the queues and the others have to be presentable from them too.
+    std::vector<VulkanView> views;
 
-    std::vector<VkFramebuffer> framebuffers;
+    VkCommandPool commandPool;
 
     VulkanHandler() = default;
 
-    explicit VulkanHandler(WindowManager *windowManager);
+    // deviceReady runs right after the device is created, work that needs no swapchain can start there.
+    VulkanHandler(const std::vector<WindowManager *> &windowManagers, bool vsync, StartupTimeline &timeline,
+                  const std::function<void(VulkanDevice &)> &deviceReady = nullptr);
 
-    void resizeCallback(VkExtent2D extent);
+    void resizeCallback(uint32_t view, VkExtent2D extent);
 
 private:
-    WindowManager *windowManager;
-
     VkInstance instance;
 
     VkDebugUtilsMessengerEXT debugMessenger;
 
-    VkSurfaceKHR surface;
-
-    void initVulkan();
+    void initVulkan(StartupTimeline &timeline, const std::function<void(VulkanDevice &)> &deviceReady);
 
     void createInstance();
 
@@ -51,19 +57,13 @@ private:
 
     std::vector<const char *> getRequiredExtensions();
 
-    void createSurface();
-
-    void createRenderPass();
+    void createSurfaces();
 
-    void createSwapChain();
+    void checkPresentSupport();
 
-    void createFramebuffers();
+    void createSwapChains();
 
     void createCommandPool();
-
-    void resizeCleanup();
-
-    void updateFramebufferSize(VkExtent2D extent);
 };
 
 
@@ -8,6 +8,8 @@
 #include <iostream>
 #include <set>
 #include "VulkanDefs.h"
+#include "VulkanMemoryTracker.h"
+#include "../log/Logger.h"
 
 #define VK_CHECK_RESULT(f)                                                                                \
 {                                                                                                        \
@@ -20,6 +22,8 @@
 }
 
 namespace vtr {
+    static std::string errorString(VkResult errorCode);
+
     static bool checkValidationLayersSupport(const std::vector<const char *> &layers) {
         uint32_t layerCount;
         vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
@@ -39,7 +43,16 @@ namespace vtr {
     static VKAPI_ATTR VkBool32 VKAPI_CALL
     debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType,
                   const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData, void *pUserData) {
-        std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
+        LogSeverity severity = LogSeverity::Verbose;
+        if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) {
+            severity = LogSeverity::Error;
+        } else if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) {
+            severity = LogSeverity::Warning;
+        } else if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT) {
+            severity = LogSeverity::Info;
+        }
+
+        VTR_LOG(severity, "validation layer: %s", pCallbackData->pMessage);
 
         return VK_FALSE;
     }
@@ -82,6 +95,87 @@ namespace vtr {
         throw std::runtime_error("failed to find suitable memory type!");
     }
 
+    // First of candidates whose optimal tiling supports every feature.
+    static VkFormat findSupportedFormat(const std::vector<VkFormat> &candidates, const VkPhysicalDevice &physicalDevice,
+                                        VkFormatFeatureFlags features) {
+        for (VkFormat format: candidates) {
+            VkFormatProperties properties;
+            vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+
+            if ((properties.optimalTilingFeatures & features) == features) {
+                return format;
+            }
+        }
+
+        throw std::runtime_error("failed to find supported format!");
+    }
+
+    // Shared concurrently between queueFamilies when there are several of them.
+    static void createBuffer(const VkDevice &device, const VkPhysicalDevice &physicalDevice,
+                             VulkanMemoryTracker &memoryTracker, MemoryCategory category, VkDeviceSize size,
+                             VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer,
+                             VkDeviceMemory &memory, const std::vector<uint32_t> &queueFamilies = {}) {
+        VkBufferCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        createInfo.size = size;
+        createInfo.usage = usage;
+        createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (queueFamilies.size() > 1) {
+            createInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            createInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+            createInfo.pQueueFamilyIndices = queueFamilies.data();
+        }
+
+        VK_CHECK_RESULT(vkCreateBuffer(device, &createInfo, nullptr, &buffer))
+
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, physicalDevice, properties);
+
+        memory = memoryTracker.allocate(category, allocInfo);
+
+        VK_CHECK_RESULT(vkBindBufferMemory(device, buffer, memory, 0))
+    }
+
+    static VkCommandBuffer beginSingleTimeCommands(const VkDevice &device, const VkCommandPool &commandPool) {
+        VkCommandBufferAllocateInfo allocateInfo = {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandPool = commandPool;
+        allocateInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &allocateInfo, &commandBuffer))
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &beginInfo))
+
+        return commandBuffer;
+    }
+
+    static void endSingleTimeCommands(const VkDevice &device, const VkCommandPool &commandPool, const VkQueue &queue,
+                                      VkCommandBuffer commandBuffer) {
+        VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer))
+
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+
+        VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE))
+        VK_CHECK_RESULT(vkQueueWaitIdle(queue))
+
+        vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+    }
+
     static SwapChainSupportDetails querySwapChainSupports(const VkPhysicalDevice &device, const VkSurfaceKHR& surface) {
         SwapChainSupportDetails details;
 
@@ -0,0 +1,369 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include "VulkanHud.h"
+#include "VulkanHelper.h"
+#include "VulkanShader.h"
+
+namespace {
+    // Printable ASCII from ' ' to '~', five columns per glyph with the top row in the lowest bit.
+    const uint8_t FONT[95][5] = {
+            {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00},
+            {0x14, 0x7F, 0x14, 0x7F, 0x14}, {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+            {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00}, {0x00, 0x1C, 0x22, 0x41, 0x00},
+            {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x08, 0x2A, 0x1C, 0x2A, 0x08}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+            {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00},
+            {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00},
+            {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31}, {0x18, 0x14, 0x12, 0x7F, 0x10},
+            {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+            {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x36, 0x36, 0x00, 0x00},
+            {0x00, 0x56, 0x36, 0x00, 0x00}, {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14},
+            {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06}, {0x32, 0x49, 0x79, 0x41, 0x3E},
+            {0x7E, 0x11, 0x11, 0x11, 0x7E}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+            {0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x09, 0x01},
+            {0x3E, 0x41, 0x49, 0x49, 0x7A}, {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00},
+            {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, {0x7F, 0x40, 0x40, 0x40, 0x40},
+            {0x7F, 0x02, 0x0C, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+            {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46},
+            {0x46, 0x49, 0x49, 0x49, 0x31}, {0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F},
+            {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x3F, 0x40, 0x38, 0x40, 0x3F}, {0x63, 0x14, 0x08, 0x14, 0x63},
+            {0x07, 0x08, 0x70, 0x08, 0x07}, {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x00},
+            {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7F, 0x00}, {0x04, 0x02, 0x01, 0x02, 0x04},
+            {0x40, 0x40, 0x40, 0x40, 0x40}, {0x00, 0x01, 0x02, 0x04, 0x00}, {0x20, 0x54, 0x54, 0x54, 0x78},
+            {0x7F, 0x48, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x20}, {0x38, 0x44, 0x44, 0x48, 0x7F},
+            {0x38, 0x54, 0x54, 0x54, 0x18}, {0x08, 0x7E, 0x09, 0x01, 0x02}, {0x0C, 0x52, 0x52, 0x52, 0x3E},
+            {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x44, 0x3D, 0x00},
+            {0x7F, 0x10, 0x28, 0x44, 0x00}, {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x18, 0x04, 0x78},
+            {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, {0x7C, 0x14, 0x14, 0x14, 0x08},
+            {0x08, 0x14, 0x14, 0x18, 0x7C}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x20},
+            {0x04, 0x3F, 0x44, 0x40, 0x20}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C},
+            {0x3C, 0x40, 0x30, 0x40, 0x3C}, {0x44, 0x28, 0x10, 0x28, 0x44}, {0x0C, 0x50, 0x50, 0x50, 0x3C},
+            {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, {0x00, 0x00, 0x7F, 0x00, 0x00},
+            {0x00, 0x41, 0x36, 0x08, 0x00}, {0x10, 0x08, 0x08, 0x10, 0x08}
+    };
+
+    // Cells of ' ' to '~' row by row, the cell after '~' is solid.
+    const uint32_t ATLAS_COLUMNS = 16;
+    const uint32_t ATLAS_ROWS = 6;
+    const uint32_t ATLAS_WIDTH = ATLAS_COLUMNS * VulkanHud::GLYPH_WIDTH;
+    const uint32_t ATLAS_HEIGHT = ATLAS_ROWS * VulkanHud::GLYPH_HEIGHT;
+    const uint32_t SOLID_CELL = 95;
+
+    void transitionAtlas(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+                         VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStages,
+                         VkPipelineStageFlags dstStages) {
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+
+        vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+}
+
+VulkanHud::VulkanHud(VulkanDevice &device, VkCommandPool commandPool, VkSampler sampler) : device(device) {
+    createAtlas(commandPool);
+    createPipelineObjects(sampler);
+    createVertexBuffers();
+}
+
+VulkanHud::~VulkanHud() {
+    VkDevice logicalDevice = device.logicalDevice;
+
+    for (auto &frame: frames) {
+        vkDestroyBuffer(logicalDevice, frame.vertexBuffer, nullptr);
+        device.memoryTracker.free(frame.vertexMemory);
+    }
+
+    vkDestroyDescriptorPool(logicalDevice, descriptorPool, nullptr);
+    vkDestroyShaderModule(logicalDevice, vertexShader, nullptr);
+    vkDestroyShaderModule(logicalDevice, fragmentShader, nullptr);
+    vkDestroyPipelineLayout(logicalDevice, drawLayout, nullptr);
+    vkDestroyDescriptorSetLayout(logicalDevice, setLayout, nullptr);
+    vkDestroyImageView(logicalDevice, atlasView, nullptr);
+    vkDestroyImage(logicalDevice, atlas, nullptr);
+    device.memoryTracker.free(atlasMemory);
+}
+
+void VulkanHud::beginFrame(uint32_t frame) {
+    currentFrame = frame;
+    quadCount = 0;
+}
+
+float VulkanHud::addText(float x, float y, const char *text, uint32_t color, float scale) {
+    float glyphWidth = GLYPH_WIDTH * scale;
+    float glyphHeight = GLYPH_HEIGHT * scale;
+    float lineX = x;
+    float width = 0.0f;
+
+    for (const char *c = text; *c != '\0'; c++) {
+        if (*c == '\n') {
+            lineX = x;
+            y += glyphHeight;
+            continue;
+        }
+
+        uint32_t cell = *c >= ' ' && *c <= '~' ? static_cast<uint32_t>(*c - ' ') : static_cast<uint32_t>('?' - ' ');
+
+        if (cell != 0) {
+            float u = static_cast<float>((cell % ATLAS_COLUMNS) * GLYPH_WIDTH) / ATLAS_WIDTH;
+            float v = static_cast<float>((cell / ATLAS_COLUMNS) * GLYPH_HEIGHT) / ATLAS_HEIGHT;
+
+            addQuad(lineX, y, glyphWidth, glyphHeight, u, v, u + static_cast<float>(GLYPH_WIDTH) / ATLAS_WIDTH,
+                    v + static_cast<float>(GLYPH_HEIGHT) / ATLAS_HEIGHT, color);
+        }
+
+        lineX += glyphWidth;
+        width = std::max(width, lineX - x);
+    }
+
+    return width;
+}
+
+void VulkanHud::addRect(float x, float y, float width, float height, uint32_t color) {
+    // Every corner samples the middle of the solid cell.
+    float u = ((SOLID_CELL % ATLAS_COLUMNS) * GLYPH_WIDTH + GLYPH_WIDTH * 0.5f) / ATLAS_WIDTH;
+    float v = ((SOLID_CELL / ATLAS_COLUMNS) * GLYPH_HEIGHT + GLYPH_HEIGHT * 0.5f) / ATLAS_HEIGHT;
+
+    addQuad(x, y, width, height, u, v, u, v, color);
+}
+
+void VulkanHud::addGraph(float x, float y, float width, float height, const float *values, uint32_t count,
+                         uint32_t first, float maxValue, uint32_t color) {
+    if (count == 0 || maxValue <= 0.0f) {
+        return;
+    }
+
+    float barWidth = width / static_cast<float>(count);
+
+    for (uint32_t i = 0; i < count; i++) {
+        float value = std::min(std::max(values[(first + i) % count] / maxValue, 0.0f), 1.0f);
+        float barHeight = value * height;
+
+        if (barHeight > 0.0f) {
+            addRect(x + i * barWidth, y + height - barHeight, barWidth, barHeight, color);
+        }
+    }
+}
+
+void VulkanHud::recordDraw(VkCommandBuffer commandBuffer, VkPipeline pipeline, VkExtent2D extent) {
+    if (quadCount == 0) {
+        return;
+    }
+
+    // Pixels to normalized device coordinates, y points down in both.
+    float scale[2] = {2.0f / static_cast<float>(extent.width), 2.0f / static_cast<float>(extent.height)};
+    VkDeviceSize offset = 0;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, drawLayout, 0, 1, &descriptorSet, 0,
+                            nullptr);
+    vkCmdPushConstants(commandBuffer, drawLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(scale), scale);
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &frames[currentFrame].vertexBuffer, &offset);
+    vkCmdDraw(commandBuffer, quadCount * 6, 1, 0, 0);
+}
+
+VkVertexInputBindingDescription VulkanHud::getVertexBinding() {
+    VkVertexInputBindingDescription binding = {};
+    binding.binding = 0;
+    binding.stride = sizeof(HudVertex);
+    binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    return binding;
+}
+
+std::vector<VkVertexInputAttributeDescription> VulkanHud::getVertexAttributes() {
+    return {
+            {0, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(HudVertex, x)},
+            {1, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(HudVertex, u)},
+            {2, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(HudVertex, color)}
+    };
+}
+
+void VulkanHud::createAtlas(VkCommandPool commandPool) {
+    VkDevice logicalDevice = device.logicalDevice;
+
+    std::vector<uint8_t> texels(ATLAS_WIDTH * ATLAS_HEIGHT, 0);
+
+    for (uint32_t cell = 0; cell <= SOLID_CELL; cell++) {
+        uint32_t cellX = (cell % ATLAS_COLUMNS) * GLYPH_WIDTH;
+        uint32_t cellY = (cell / ATLAS_COLUMNS) * GLYPH_HEIGHT;
+
+        for (uint32_t y = 0; y < GLYPH_HEIGHT; y++) {
+            for (uint32_t x = 0; x < GLYPH_WIDTH; x++) {
+                bool set = cell == SOLID_CELL || (x < 5 && y < 7 && (FONT[cell][x] >> y & 1) != 0);
+                texels[(cellY + y) * ATLAS_WIDTH + cellX + x] = set ? 255 : 0;
+            }
+        }
+    }
+
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = VK_FORMAT_R8_UNORM;
+    imageInfo.extent = {ATLAS_WIDTH, ATLAS_HEIGHT, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VK_CHECK_RESULT(vkCreateImage(logicalDevice, &imageInfo, nullptr, &atlas))
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(logicalDevice, atlas, &requirements);
+
+    VkMemoryAllocateInfo allocateInfo = {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocateInfo.allocationSize = requirements.size;
+    allocateInfo.memoryTypeIndex = vtr::findMemoryType(requirements.memoryTypeBits, device.physicalDevice,
+                                                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    atlasMemory = device.memoryTracker.allocate(MemoryCategory::Image, allocateInfo);
+    VK_CHECK_RESULT(vkBindImageMemory(logicalDevice, atlas, atlasMemory, 0))
+
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = atlas;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R8_UNORM;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    VK_CHECK_RESULT(vkCreateImageView(logicalDevice, &viewInfo, nullptr, &atlasView))
+
+    // A few kilobytes, uploaded synchronously at startup.
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingMemory;
+    vtr::createBuffer(logicalDevice, device.physicalDevice, device.memoryTracker, MemoryCategory::Staging,
+                      texels.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer,
+                      stagingMemory);
+
+    void *mapping;
+    VK_CHECK_RESULT(vkMapMemory(logicalDevice, stagingMemory, 0, texels.size(), 0, &mapping))
+    memcpy(mapping, texels.data(), texels.size());
+    vkUnmapMemory(logicalDevice, stagingMemory);
+
+    VkCommandBuffer commandBuffer = vtr::beginSingleTimeCommands(logicalDevice, commandPool);
+
+    transitionAtlas(commandBuffer, atlas, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0,
+                    VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    VkBufferImageCopy region = {};
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent = {ATLAS_WIDTH, ATLAS_HEIGHT, 1};
+
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, atlas, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    transitionAtlas(commandBuffer, atlas, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+    vtr::endSingleTimeCommands(logicalDevice, commandPool, device.graphicsQueue, commandBuffer);
+
+    vkDestroyBuffer(logicalDevice, stagingBuffer, nullptr);
+    device.memoryTracker.free(stagingMemory);
+}
+
+void VulkanHud::createPipelineObjects(VkSampler sampler) {
+    VkDevice logicalDevice = device.logicalDevice;
+
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutCreateInfo setLayoutInfo = {};
+    setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    setLayoutInfo.bindingCount = 1;
+    setLayoutInfo.pBindings = &binding;
+
+    VK_CHECK_RESULT(vkCreateDescriptorSetLayout(logicalDevice, &setLayoutInfo, nullptr, &setLayout))
+
+    // The pixel to clip space scale.
+    VkPushConstantRange pushConstantRange = {};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(float) * 2;
+
+    VkPipelineLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &setLayout;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    VK_CHECK_RESULT(vkCreatePipelineLayout(logicalDevice, &layoutInfo, nullptr, &drawLayout))
+
+    VkDescriptorPoolSize poolSize = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1};
+
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    VK_CHECK_RESULT(vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &descriptorPool))
+
+    VkDescriptorSetAllocateInfo allocateInfo = {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocateInfo.descriptorPool = descriptorPool;
+    allocateInfo.descriptorSetCount = 1;
+    allocateInfo.pSetLayouts = &setLayout;
+
+    VK_CHECK_RESULT(vkAllocateDescriptorSets(logicalDevice, &allocateInfo, &descriptorSet))
+
+    VkDescriptorImageInfo imageInfo = {sampler, atlasView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+    VkWriteDescriptorSet write = {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = descriptorSet;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &imageInfo;
+
+    vkUpdateDescriptorSets(logicalDevice, 1, &write, 0, nullptr);
+
+    vertexShader = createShaderModule(logicalDevice, vtr::getShader("hud.vert"));
+    fragmentShader = createShaderModule(logicalDevice, vtr::getShader("hud.frag"));
+}
+
+void VulkanHud::createVertexBuffers() {
+    VkDeviceSize size = sizeof(HudVertex) * 6 * MAX_QUADS;
+
+    // Written once per frame and read once by the GPU, host visible memory is read in place.
+    for (auto &frame: frames) {
+        vtr::createBuffer(device.logicalDevice, device.physicalDevice, device.memoryTracker, MemoryCategory::Buffer,
+                          size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                          frame.vertexBuffer, frame.vertexMemory);
+        VK_CHECK_RESULT(vkMapMemory(device.logicalDevice, frame.vertexMemory, 0, size, 0,
+                                    reinterpret_cast<void **>(&frame.vertices)))
+    }
+}
+
+void VulkanHud::addQuad(float x, float y, float width, float height, float u0, float v0, float u1, float v1,
+                        uint32_t color) {
+    if (quadCount == MAX_QUADS) {
+        return;
+    }
+
+    // Two triangles, counter clockwise like the scene, though the pipeline culls nothing.
+    HudVertex *vertices = frames[currentFrame].vertices + 6 * quadCount++;
+    vertices[0] = {x, y, u0, v0, color};
+    vertices[1] = {x, y + height, u0, v1, color};
+    vertices[2] = {x + width, y + height, u1, v1, color};
+    vertices[3] = {x, y, u0, v0, color};
+    vertices[4] = {x + width, y + height, u1, v1, color};
+    vertices[5] = {x + width, y, u1, v0, color};
+}
@@ -0,0 +1,109 @@
+#ifndef VULKAN_TRY_VULKANHUD_H
+#define VULKAN_TRY_VULKANHUD_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include "VulkanDevice.h"
+
+// Position in pixels from the top left corner, color as R8G8B8A8_UNORM, so 0xAABBGGRR as a little endian word.
+struct HudVertex {
+    float x, y;
+    float u, v;
+    uint32_t color;
+};
+
+/*
+ * Text and flat rectangles in screen pixels, written straight into a persistently mapped vertex buffer per frame in
+ * flight and drawn with a single draw. Glyphs come from a 5x7 bitmap font baked into a small R8 atlas at creation.
+ * The atlas also has a solid cell that rectangles sample, so text and graphs share one pipeline and descriptor set.
+ *
+ * Quads past MAX_QUADS are dropped. Render thread only.
+ */
+class VulkanHud {
+public:
+    static const uint32_t MAX_QUADS = 4096;
+
+    // Atlas cell of a glyph in pixels, the glyph plus a column and a row of spacing.
+    static const uint32_t GLYPH_WIDTH = 6;
+    static const uint32_t GLYPH_HEIGHT = 8;
+
+    // Nearest filtering keeps glyphs sharp at whole number scales.
+    VulkanHud(VulkanDevice &device, VkCommandPool commandPool, VkSampler sampler);
+
+    VulkanHud(const VulkanHud &) = delete;
+
+    VulkanHud &operator=(const VulkanHud &) = delete;
+
+    ~VulkanHud();
+
+    // Once the frame's fence has been waited on, drops what was added for the frame last time.
+    void beginFrame(uint32_t frame);
+
+    // Printable ASCII, anything else is drawn as '?'. '\n' starts a new line. Returns the width of the widest line.
+    float addText(float x, float y, const char *text, uint32_t color, float scale = 1.0f);
+
+    void addRect(float x, float y, float width, float height, uint32_t color);
+
+    // One bar per value, bottom aligned, starting with values[first] and wrapping around. maxValue fills the height.
+    void addGraph(float x, float y, float width, float height, const float *values, uint32_t count, uint32_t first,
+                  float maxValue, uint32_t color);
+
+    // Everything added since beginFrame(), with a pipeline built from the getters below blending by source alpha.
+    void recordDraw(VkCommandBuffer commandBuffer, VkPipeline pipeline, VkExtent2D extent);
+
+    inline VkShaderModule getVertexShader() const {
+        return vertexShader;
+    }
+
+    inline VkShaderModule getFragmentShader() const {
+        return fragmentShader;
+    }
+
+    inline VkPipelineLayout getDrawLayout() const {
+        return drawLayout;
+    }
+
+    static VkVertexInputBindingDescription getVertexBinding();
+
+    static std::vector<VkVertexInputAttributeDescription> getVertexAttributes();
+
+    inline uint32_t getQuadCount() const {
+        return quadCount;
+    }
+
+private:
+    struct Frame {
+        VkBuffer vertexBuffer;
+        VkDeviceMemory vertexMemory;
+        HudVertex *vertices;
+    };
+
+    VulkanDevice &device;
+
+    VkImage atlas;
+    VkDeviceMemory atlasMemory;
+    VkImageView atlasView;
+
+    VkDescriptorSetLayout setLayout;
+    VkPipelineLayout drawLayout;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet descriptorSet;
+    VkShaderModule vertexShader;
+    VkShaderModule fragmentShader;
+
+    Frame frames[MAX_FRAMES_IN_FLIGHT];
+    uint32_t currentFrame = 0;
+    uint32_t quadCount = 0;
+
+    void createAtlas(VkCommandPool commandPool);
+
+    void createPipelineObjects(VkSampler sampler);
+
+    void createVertexBuffers();
+
+    void addQuad(float x, float y, float width, float height, float u0, float v0, float u1, float v1,
+                 uint32_t color);
+};
+
+
+#endif //VULKAN_TRY_VULKANHUD_H
@@ -0,0 +1,208 @@
+#include <algorithm>
+#include "VulkanMemoryTracker.h"
+#include "VulkanHelper.h"
+#include "../log/Logger.h"
+
+namespace {
+    const char *const categoryNames[MEMORY_CATEGORY_COUNT] = {"buffers", "images", "staging", "pipeline cache"};
+
+    inline double toMegabytes(VkDeviceSize bytes) {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+}
+
+void VulkanMemoryTracker::init(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, bool budgetExtension) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    this->physicalDevice = physicalDevice;
+    this->logicalDevice = logicalDevice;
+    this->budgetExtension = budgetExtension;
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    heaps.assign(memoryProperties.memoryHeapCount, Heap());
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+        heaps[i].size = memoryProperties.memoryHeaps[i].size;
+        heaps[i].deviceLocal = (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        heaps[i].budget = heaps[i].size;
+    }
+
+    heapOfType.resize(memoryProperties.memoryTypeCount);
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        heapOfType[i] = memoryProperties.memoryTypes[i].heapIndex;
+    }
+
+    queryBudgets();
+    lastDump = std::chrono::steady_clock::now();
+}
+
+void VulkanMemoryTracker::setSoftBudget(float fraction) {
+    std::lock_guard<std::mutex> lock(mutex);
+    softBudget = std::min(std::max(fraction, 0.0f), 1.0f);
+}
+
+void VulkanMemoryTracker::setDumpInterval(double seconds) {
+    std::lock_guard<std::mutex> lock(mutex);
+    dumpInterval = seconds;
+}
+
+VkDeviceMemory VulkanMemoryTracker::allocate(MemoryCategory category, const VkMemoryAllocateInfo &allocateInfo) {
+    VkDeviceMemory memory;
+    VkResult result = vkAllocateMemory(logicalDevice, &allocateInfo, nullptr, &memory);
+
+    if (result != VK_SUCCESS) {
+        LOG_ERROR("Failed to allocate %.1f MB of %s", toMegabytes(allocateInfo.allocationSize),
+                  categoryNames[static_cast<uint32_t>(category)]);
+        dump();
+        VK_CHECK_RESULT(result)
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    uint32_t heap = heapOfType[allocateInfo.memoryTypeIndex];
+    allocations[memory] = {category, heap, allocateInfo.allocationSize};
+
+    heaps[heap].categoryUsage[static_cast<uint32_t>(category)] += allocateInfo.allocationSize;
+    heaps[heap].unreportedUsage += static_cast<int64_t>(allocateInfo.allocationSize);
+
+    return memory;
+}
+
+void VulkanMemoryTracker::free(VkDeviceMemory memory) {
+    if (memory == VK_NULL_HANDLE) {
+        return;
+    }
+
+    vkFreeMemory(logicalDevice, memory, nullptr);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto found = allocations.find(memory);
+    if (found == allocations.end()) {
+        LOG_WARNING("Freed device memory the tracker did not allocate");
+        return;
+    }
+
+    const Allocation &allocation = found->second;
+    heaps[allocation.heap].categoryUsage[static_cast<uint32_t>(allocation.category)] -= allocation.size;
+    heaps[allocation.heap].unreportedUsage -= static_cast<int64_t>(allocation.size);
+
+    allocations.erase(found);
+}
+
+void VulkanMemoryTracker::setHostUsage(MemoryCategory category, VkDeviceSize size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    hostUsage[static_cast<uint32_t>(category)] = size;
+}
+
+bool VulkanMemoryTracker::fits(uint32_t memoryTypeIndex, VkDeviceSize size) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const Heap &heap = heaps[heapOfType[memoryTypeIndex]];
+    auto limit = static_cast<VkDeviceSize>(static_cast<double>(heap.budget) * softBudget);
+
+    return heapUsage(heap) + size <= limit;
+}
+
+void VulkanMemoryTracker::update() {
+    bool dueForDump;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queryBudgets();
+
+        std::chrono::duration<double> sinceDump = std::chrono::steady_clock::now() - lastDump;
+        dueForDump = dumpInterval > 0.0 && sinceDump.count() >= dumpInterval;
+    }
+
+    if (dueForDump) {
+        dump();
+    }
+}
+
+MemoryStats VulkanMemoryTracker::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return collectStats();
+}
+
+void VulkanMemoryTracker::dump() {
+    MemoryStats stats;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats = collectStats();
+        lastDump = std::chrono::steady_clock::now();
+    }
+
+    LOG_INFO("Device memory, %u allocations, budgets from %s", stats.allocationCount,
+             stats.driverBudget ? "VK_EXT_memory_budget" : "heap sizes");
+
+    for (size_t i = 0; i < stats.heaps.size(); i++) {
+        const MemoryHeapStats &heap = stats.heaps[i];
+
+        LOG_INFO("  heap %zu%s: %.1f / %.1f MB (soft %.1f MB), buffers %.1f, images %.1f, staging %.1f MB", i,
+                 heap.deviceLocal ? " device local" : "", toMegabytes(heap.usage), toMegabytes(heap.budget),
+                 toMegabytes(heap.softBudget), toMegabytes(heap.categoryUsage[0]),
+                 toMegabytes(heap.categoryUsage[1]), toMegabytes(heap.categoryUsage[2]));
+    }
+
+    LOG_INFO("  host: pipeline cache %.1f MB",
+             toMegabytes(stats.hostUsage[static_cast<uint32_t>(MemoryCategory::PipelineCache)]));
+}
+
+void VulkanMemoryTracker::queryBudgets() {
+    if (!budgetExtension) {
+        return;
+    }
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2 memoryProperties = {};
+    memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    memoryProperties.pNext = &budgetProperties;
+
+    vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &memoryProperties);
+
+    for (size_t i = 0; i < heaps.size(); i++) {
+        // Some drivers report 0 for heaps they do not track, the heap size is the best guess then.
+        heaps[i].budget = budgetProperties.heapBudget[i] != 0 ? budgetProperties.heapBudget[i] : heaps[i].size;
+        heaps[i].driverUsage = budgetProperties.heapUsage[i];
+        heaps[i].unreportedUsage = 0;
+    }
+}
+
+VkDeviceSize VulkanMemoryTracker::heapUsage(const Heap &heap) const {
+    if (budgetExtension) {
+        int64_t usage = static_cast<int64_t>(heap.driverUsage) + heap.unreportedUsage;
+        return usage > 0 ? static_cast<VkDeviceSize>(usage) : 0;
+    }
+
+    VkDeviceSize usage = 0;
+    for (VkDeviceSize categoryUsage: heap.categoryUsage) {
+        usage += categoryUsage;
+    }
+
+    return usage;
+}
+
+MemoryStats VulkanMemoryTracker::collectStats() const {
+    MemoryStats stats = {};
+    stats.driverBudget = budgetExtension;
+    stats.allocationCount = static_cast<uint32_t>(allocations.size());
+
+    for (const Heap &heap: heaps) {
+        MemoryHeapStats heapStats = {};
+        heapStats.size = heap.size;
+        heapStats.budget = heap.budget;
+        heapStats.usage = heapUsage(heap);
+        heapStats.softBudget = static_cast<VkDeviceSize>(static_cast<double>(heap.budget) * softBudget);
+        heapStats.deviceLocal = heap.deviceLocal;
+        std::copy(std::begin(heap.categoryUsage), std::end(heap.categoryUsage), heapStats.categoryUsage);
+
+        stats.heaps.push_back(heapStats);
+    }
+
+    std::copy(std::begin(hostUsage), std::end(hostUsage), stats.hostUsage);
+
+    return stats;
+}
@@ -0,0 +1,113 @@
+#ifndef VULKAN_TRY_VULKANMEMORYTRACKER_H
+#define VULKAN_TRY_VULKANMEMORYTRACKER_H
+
+#include <vulkan/vulkan.h>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+enum class MemoryCategory : uint32_t {
+    Buffer,
+    Image,
+    // Host visible memory for uploads and readbacks.
+    Staging,
+    // Lives in driver owned host memory, reported with setHostUsage().
+    PipelineCache
+};
+
+const uint32_t MEMORY_CATEGORY_COUNT = 4;
+
+struct MemoryHeapStats {
+    VkDeviceSize size;
+    // From VK_EXT_memory_budget when available, otherwise the heap size and what the engine allocated from it.
+    VkDeviceSize budget;
+    VkDeviceSize usage;
+    VkDeviceSize softBudget;
+    bool deviceLocal;
+    VkDeviceSize categoryUsage[MEMORY_CATEGORY_COUNT];
+};
+
+struct MemoryStats {
+    bool driverBudget;
+    uint32_t allocationCount;
+    std::vector<MemoryHeapStats> heaps;
+    VkDeviceSize hostUsage[MEMORY_CATEGORY_COUNT];
+};
+
+/*
+ * Accounts every device memory allocation of the engine by category and heap, and compares heap usage against
+ * the budget the driver reports through VK_EXT_memory_budget. Without the extension the whole heap is the budget
+ * and only engine allocations count as usage.
+ *
+ * The soft budget is a fraction of each heap's budget. Streaming code asks fits() before it allocates and degrades,
+ * e.g. by dropping top mips, instead of letting allocations fail once the heap is full. Thread safe.
+ */
+class VulkanMemoryTracker {
+public:
+    void init(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, bool budgetExtension);
+
+    void setSoftBudget(float fraction);
+
+    // 0 turns the periodic dump off.
+    void setDumpInterval(double seconds);
+
+    // Throws like VK_CHECK_RESULT when the allocation fails, after dumping the stats.
+    VkDeviceMemory allocate(MemoryCategory category, const VkMemoryAllocateInfo &allocateInfo);
+
+    void free(VkDeviceMemory memory);
+
+    // For memory the driver allocates on our behalf, like pipeline cache data.
+    void setHostUsage(MemoryCategory category, VkDeviceSize size);
+
+    // Whether size more bytes of memoryTypeIndex keep its heap under the soft budget.
+    bool fits(uint32_t memoryTypeIndex, VkDeviceSize size);
+
+    // Call once per frame, refreshes driver budgets and dumps the stats when the interval has passed.
+    void update();
+
+    MemoryStats getStats();
+
+    void dump();
+
+private:
+    struct Allocation {
+        MemoryCategory category;
+        uint32_t heap;
+        VkDeviceSize size;
+    };
+
+    struct Heap {
+        VkDeviceSize size;
+        bool deviceLocal;
+        VkDeviceSize budget;
+        VkDeviceSize driverUsage;
+        // Engine allocations since the driver was last asked, the driver usage does not include them yet.
+        int64_t unreportedUsage;
+        VkDeviceSize categoryUsage[MEMORY_CATEGORY_COUNT];
+    };
+
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice logicalDevice = VK_NULL_HANDLE;
+    bool budgetExtension = false;
+
+    std::mutex mutex;
+    std::vector<Heap> heaps;
+    std::vector<uint32_t> heapOfType;
+    std::unordered_map<VkDeviceMemory, Allocation> allocations;
+    VkDeviceSize hostUsage[MEMORY_CATEGORY_COUNT] = {};
+
+    float softBudget = 0.9f;
+    double dumpInterval = 0.0;
+    std::chrono::steady_clock::time_point lastDump;
+
+    void queryBudgets();
+
+    VkDeviceSize heapUsage(const Heap &heap) const;
+
+    MemoryStats collectStats() const;
+};
+
+
+#endif //VULKAN_TRY_VULKANMEMORYTRACKER_H
@@ -0,0 +1,500 @@
+#include <algorithm>
+#include "VulkanOcclusionCuller.h"
+#include "VulkanHelper.h"
+#include "VulkanShader.h"
+
+namespace {
+    const uint32_t CULL_GROUP_SIZE = 64;
+    const uint32_t REDUCE_GROUP_SIZE = 8;
+
+    struct CullConstants {
+        glm::mat4 viewProjection;
+        uint32_t objectCount;
+        uint32_t late;
+        uint32_t instanceCapacity;
+    };
+
+    struct ReduceConstants {
+        int32_t sourceSize[2];
+        int32_t destinationSize[2];
+    };
+
+    VkDescriptorSetLayout createSetLayout(VkDevice device, const std::vector<VkDescriptorType> &types) {
+        std::vector<VkDescriptorSetLayoutBinding> bindings(types.size());
+        for (uint32_t i = 0; i < types.size(); i++) {
+            bindings[i] = {};
+            bindings[i].binding = i;
+            bindings[i].descriptorType = types[i];
+            bindings[i].descriptorCount = 1;
+            bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings = bindings.data();
+
+        VkDescriptorSetLayout setLayout;
+        VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout))
+
+        return setLayout;
+    }
+
+    VkPipelineLayout createPipelineLayout(VkDevice device, VkDescriptorSetLayout setLayout, uint32_t constantSize) {
+        VkPushConstantRange pushConstantRange = {};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = constantSize;
+
+        VkPipelineLayoutCreateInfo layoutInfo = {};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layoutInfo.setLayoutCount = 1;
+        layoutInfo.pSetLayouts = &setLayout;
+        layoutInfo.pushConstantRangeCount = 1;
+        layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+        VkPipelineLayout layout;
+        VK_CHECK_RESULT(vkCreatePipelineLayout(device, &layoutInfo, nullptr, &layout))
+
+        return layout;
+    }
+
+    // Largest power of two not above extent.
+    uint32_t floorPowerOfTwo(uint32_t extent) {
+        uint32_t power = 1;
+        while (power * 2 <= extent) {
+            power *= 2;
+        }
+
+        return power;
+    }
+
+    void memoryBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                       VkPipelineStageFlags dstStages, VkAccessFlags dstAccess) {
+        VkMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+
+        vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+VulkanOcclusionCuller::VulkanOcclusionCuller(VulkanDevice &device, uint32_t capacity) : device(device),
+                                                                                        capacity(capacity) {
+    createPipelines();
+    createBuffers();
+    createDescriptorSets();
+}
+
+VulkanOcclusionCuller::~VulkanOcclusionCuller() {
+    destroyPyramid();
+
+    VkDevice logicalDevice = device.logicalDevice;
+
+    for (auto &frame: frames) {
+        vkDestroyBuffer(logicalDevice, frame.objectBuffer, nullptr);
+        device.memoryTracker.free(frame.objectMemory);
+        vkDestroyBuffer(logicalDevice, frame.indirectBuffer, nullptr);
+        device.memoryTracker.free(frame.indirectMemory);
+        vkDestroyBuffer(logicalDevice, frame.instanceBuffer, nullptr);
+        device.memoryTracker.free(frame.instanceMemory);
+    }
+
+    vkDestroyBuffer(logicalDevice, visibilityBuffer, nullptr);
+    device.memoryTracker.free(visibilityMemory);
+
+    vkDestroyDescriptorPool(logicalDevice, descriptorPool, nullptr);
+    vkDestroySampler(logicalDevice, sampler, nullptr);
+    vkDestroyPipeline(logicalDevice, cullPipeline, nullptr);
+    vkDestroyPipeline(logicalDevice, reducePipeline, nullptr);
+    vkDestroyPipelineLayout(logicalDevice, cullLayout, nullptr);
+    vkDestroyPipelineLayout(logicalDevice, reduceLayout, nullptr);
+    vkDestroyDescriptorSetLayout(logicalDevice, cullSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(logicalDevice, reduceSetLayout, nullptr);
+}
+
+void VulkanOcclusionCuller::createPipelines() {
+    VkDevice logicalDevice = device.logicalDevice;
+
+    cullSetLayout = createSetLayout(logicalDevice, {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER});
+    reduceSetLayout = createSetLayout(logicalDevice, {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                      VK_DESCRIPTOR_TYPE_STORAGE_IMAGE});
+
+    cullLayout = createPipelineLayout(logicalDevice, cullSetLayout, sizeof(CullConstants));
+    reduceLayout = createPipelineLayout(logicalDevice, reduceSetLayout, sizeof(ReduceConstants));
+
+    cullPipeline = createComputePipeline(logicalDevice, cullLayout, "occlusion_cull.comp");
+    reducePipeline = createComputePipeline(logicalDevice, reduceLayout, "hiz_reduce.comp");
+
+    // Both shaders only ever texelFetch, the sampler is there because sampled images need one.
+    VkSamplerCreateInfo samplerInfo = {};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    VK_CHECK_RESULT(vkCreateSampler(logicalDevice, &samplerInfo, nullptr, &sampler))
+}
+
+void VulkanOcclusionCuller::createBuffers() {
+    VkDevice logicalDevice = device.logicalDevice;
+    VkPhysicalDevice physicalDevice = device.physicalDevice;
+    VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    for (auto &frame: frames) {
+        VkDeviceSize objectSize = sizeof(Object) * capacity;
+        vtr::createBuffer(logicalDevice, physicalDevice, device.memoryTracker, MemoryCategory::Buffer, objectSize,
+                          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible, frame.objectBuffer, frame.objectMemory);
+        VK_CHECK_RESULT(vkMapMemory(logicalDevice, frame.objectMemory, 0, objectSize, 0,
+                                    reinterpret_cast<void **>(&frame.objects)))
+
+        vtr::createBuffer(logicalDevice, physicalDevice, device.memoryTracker, MemoryCategory::Buffer,
+                          sizeof(Commands), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                          hostVisible, frame.indirectBuffer, frame.indirectMemory);
+        VK_CHECK_RESULT(vkMapMemory(logicalDevice, frame.indirectMemory, 0, sizeof(Commands), 0,
+                                    reinterpret_cast<void **>(&frame.commands)))
+
+        // Early instances, then late ones.
+        vtr::createBuffer(logicalDevice, physicalDevice, device.memoryTracker, MemoryCategory::Buffer,
+                          sizeof(glm::mat4) * capacity * 2,
+                          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.instanceBuffer, frame.instanceMemory);
+
+        frame.objectCount = 0;
+        frame.pending = false;
+    }
+
+    vtr::createBuffer(logicalDevice, physicalDevice, device.memoryTracker, MemoryCategory::Buffer,
+                      sizeof(uint32_t) * capacity,
+                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, visibilityBuffer, visibilityMemory);
+}
+
+void VulkanOcclusionCuller::createDescriptorSets() {
+    VkDescriptorPoolSize poolSizes[] = {
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         4 * MAX_FRAMES_IN_FLIGHT},
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_FRAMES_IN_FLIGHT + MAX_PYRAMID_LEVELS},
+            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          MAX_PYRAMID_LEVELS}
+    };
+
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = MAX_FRAMES_IN_FLIGHT + MAX_PYRAMID_LEVELS;
+    poolInfo.poolSizeCount = 3;
+    poolInfo.pPoolSizes = poolSizes;
+
+    VK_CHECK_RESULT(vkCreateDescriptorPool(device.logicalDevice, &poolInfo, nullptr, &descriptorPool))
+
+    std::vector<VkDescriptorSetLayout> setLayouts(MAX_FRAMES_IN_FLIGHT, cullSetLayout);
+    setLayouts.insert(setLayouts.end(), MAX_PYRAMID_LEVELS, reduceSetLayout);
+
+    std::vector<VkDescriptorSet> sets(setLayouts.size());
+
+    VkDescriptorSetAllocateInfo allocateInfo = {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocateInfo.descriptorPool = descriptorPool;
+    allocateInfo.descriptorSetCount = static_cast<uint32_t>(sets.size());
+    allocateInfo.pSetLayouts = setLayouts.data();
+
+    VK_CHECK_RESULT(vkAllocateDescriptorSets(device.logicalDevice, &allocateInfo, sets.data()))
+
+    std::copy(sets.begin() + MAX_FRAMES_IN_FLIGHT, sets.end(), reduceSets);
+
+    // The buffers never change, the pyramid binding is written by setDepthTarget().
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        Frame &frame = frames[i];
+        frame.descriptorSet = sets[i];
+
+        VkDescriptorBufferInfo bufferInfos[] = {
+                {frame.objectBuffer,   0, VK_WHOLE_SIZE},
+                {visibilityBuffer,     0, VK_WHOLE_SIZE},
+                {frame.instanceBuffer, 0, VK_WHOLE_SIZE},
+                {frame.indirectBuffer, 0, VK_WHOLE_SIZE}
+        };
+
+        VkWriteDescriptorSet write = {};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = frame.descriptorSet;
+        write.dstBinding = 0;
+        write.descriptorCount = 4;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.pBufferInfo = bufferInfos;
+
+        vkUpdateDescriptorSets(device.logicalDevice, 1, &write, 0, nullptr);
+    }
+}
+
+void VulkanOcclusionCuller::setDepthTarget(VkImageView depthView, VkExtent2D extent) {
+    destroyPyramid();
+
+    VkDevice logicalDevice = device.logicalDevice;
+    depthExtent = extent;
+
+    // Level 0 is at most half a texel coarser than the depth buffer, which keeps every level an exact halving.
+    VkExtent2D pyramidExtent = {floorPowerOfTwo(extent.width), floorPowerOfTwo(extent.height)};
+
+    levelCount = 1;
+    while (levelCount < MAX_PYRAMID_LEVELS && std::max(pyramidExtent.width, pyramidExtent.height) >> levelCount) {
+        levelCount++;
+    }
+
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = VK_FORMAT_R32_SFLOAT;
+    imageInfo.extent = {pyramidExtent.width, pyramidExtent.height, 1};
+    imageInfo.mipLevels = levelCount;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VK_CHECK_RESULT(vkCreateImage(logicalDevice, &imageInfo, nullptr, &pyramid))
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(logicalDevice, pyramid, &memoryRequirements);
+
+    VkMemoryAllocateInfo allocateInfo = {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocateInfo.allocationSize = memoryRequirements.size;
+    allocateInfo.memoryTypeIndex = vtr::findMemoryType(memoryRequirements.memoryTypeBits, device.physicalDevice,
+                                                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    pyramidMemory = device.memoryTracker.allocate(MemoryCategory::Image, allocateInfo);
+    VK_CHECK_RESULT(vkBindImageMemory(logicalDevice, pyramid, pyramidMemory, 0))
+
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = pyramid;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R32_SFLOAT;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = levelCount;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    VK_CHECK_RESULT(vkCreateImageView(logicalDevice, &viewInfo, nullptr, &pyramidView))
+
+    viewInfo.subresourceRange.levelCount = 1;
+    for (uint32_t level = 0; level < levelCount; level++) {
+        viewInfo.subresourceRange.baseMipLevel = level;
+        VK_CHECK_RESULT(vkCreateImageView(logicalDevice, &viewInfo, nullptr, &levelViews[level]))
+
+        levelExtents[level] = {std::max(pyramidExtent.width >> level, 1u),
+                               std::max(pyramidExtent.height >> level, 1u)};
+    }
+
+    // Each level reads the one above it, level 0 reads the depth buffer.
+    for (uint32_t level = 0; level < levelCount; level++) {
+        VkDescriptorImageInfo imageInfos[2] = {};
+        imageInfos[0].sampler = sampler;
+        imageInfos[0].imageView = level == 0 ? depthView : levelViews[level - 1];
+        imageInfos[0].imageLayout = level == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+                                               : VK_IMAGE_LAYOUT_GENERAL;
+        imageInfos[1].imageView = levelViews[level];
+        imageInfos[1].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        VkWriteDescriptorSet writes[2] = {};
+        for (uint32_t i = 0; i < 2; i++) {
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = reduceSets[level];
+            writes[i].dstBinding = i;
+            writes[i].descriptorCount = 1;
+            writes[i].pImageInfo = &imageInfos[i];
+        }
+        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+
+        vkUpdateDescriptorSets(logicalDevice, 2, writes, 0, nullptr);
+    }
+
+    VkDescriptorImageInfo pyramidInfo = {sampler, pyramidView, VK_IMAGE_LAYOUT_GENERAL};
+    for (auto &frame: frames) {
+        VkWriteDescriptorSet write = {};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = frame.descriptorSet;
+        write.dstBinding = 4;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.pImageInfo = &pyramidInfo;
+
+        vkUpdateDescriptorSets(logicalDevice, 1, &write, 0, nullptr);
+    }
+}
+
+void VulkanOcclusionCuller::destroyPyramid() {
+    if (pyramid == VK_NULL_HANDLE) {
+        return;
+    }
+
+    for (uint32_t level = 0; level < levelCount; level++) {
+        vkDestroyImageView(device.logicalDevice, levelViews[level], nullptr);
+        levelViews[level] = VK_NULL_HANDLE;
+    }
+
+    vkDestroyImageView(device.logicalDevice, pyramidView, nullptr);
+    vkDestroyImage(device.logicalDevice, pyramid, nullptr);
+    device.memoryTracker.free(pyramidMemory);
+
+    pyramidView = VK_NULL_HANDLE;
+    pyramid = VK_NULL_HANDLE;
+    pyramidMemory = VK_NULL_HANDLE;
+    levelCount = 0;
+}
+
+bool VulkanOcclusionCuller::beginFrame(uint32_t frame, const vtr::MeshLod *lods, uint32_t lodCount,
+                                       const glm::mat4 *worldMatrices, const vtr::SphereBounds &bounds,
+                                       const uint32_t *visible, const uint32_t *visibleLods, uint32_t visibleCount) {
+    if (visibleCount > capacity) {
+        throw std::runtime_error("more objects than the occlusion culler was created for!");
+    }
+
+    currentFrame = frame;
+    Frame &current = frames[frame];
+
+    // The fence of this slot has signaled, so have the counts it recorded.
+    bool counted = current.pending;
+    if (current.pending) {
+        const Commands &commands = *current.commands;
+        stats = {current.objectCount, 0, 0, commands.occludedCount};
+        for (uint32_t lod = 0; lod < vtr::MESH_MAX_LODS; lod++) {
+            stats.early += commands.draws[0][lod].instanceCount;
+            stats.late += commands.draws[1][lod].instanceCount;
+        }
+        current.pending = false;
+    }
+
+    // Every level gets the instance range its objects would fill if all of them were drawn in one phase.
+    uint32_t lodBases[vtr::MESH_MAX_LODS] = {};
+    for (uint32_t i = 0; i < visibleCount; i++) {
+        lodBases[visibleLods[i]]++;
+    }
+    for (uint32_t lod = 0, base = 0; lod < vtr::MESH_MAX_LODS; lod++) {
+        uint32_t count = lodBases[lod];
+        lodBases[lod] = base;
+        base += count;
+    }
+
+    for (uint32_t i = 0; i < visibleCount; i++) {
+        uint32_t index = visible[i];
+
+        Object &object = current.objects[i];
+        object.world = worldMatrices[index];
+        object.sphere = glm::vec4(bounds.centerX[index], bounds.centerY[index], bounds.centerZ[index],
+                                  bounds.radius[index]);
+        object.id = index;
+        object.lod = visibleLods[i];
+    }
+
+    current.objectCount = visibleCount;
+
+    // Instance counts are appended to by the cull shader.
+    Commands &commands = *current.commands;
+    for (auto &phase: commands.draws) {
+        for (uint32_t lod = 0; lod < vtr::MESH_MAX_LODS; lod++) {
+            phase[lod] = {0, 0, 0, 0, lodBases[lod]};
+            if (lod < lodCount) {
+                phase[lod].indexCount = lods[lod].indexCount;
+                phase[lod].firstIndex = lods[lod].indexOffset;
+            }
+        }
+    }
+    commands.occludedCount = 0;
+
+    return counted;
+}
+
+void VulkanOcclusionCuller::recordCull(VkCommandBuffer commandBuffer, bool late, const glm::mat4 &viewProjection) {
+    Frame &frame = frames[currentFrame];
+
+    if (!late) {
+        // Everything starts out visible, the first frame is drawn early in full and tested late.
+        if (!visibilityCleared) {
+            vkCmdFillBuffer(commandBuffer, visibilityBuffer, 0, VK_WHOLE_SIZE, 1);
+            visibilityCleared = true;
+        }
+
+        // Visibility was written by the late phase of the previous frame.
+        memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                      VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    }
+
+    if (frame.objectCount > 0) {
+        CullConstants constants = {viewProjection, frame.objectCount, late ? 1u : 0u, capacity};
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullLayout, 0, 1,
+                                &frame.descriptorSet, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants),
+                           &constants);
+        vkCmdDispatch(commandBuffer, (frame.objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+    }
+
+    if (late) {
+        // Makes the counts visible to host reads once the fence has signaled.
+        memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                      VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+        frame.pending = true;
+    }
+}
+
+void VulkanOcclusionCuller::recordPyramid(VkCommandBuffer commandBuffer) {
+    if (levelCount == 0) {
+        throw std::runtime_error("occlusion culler has no depth target!");
+    }
+
+    // Rebuilt from scratch every frame, the previous contents are discarded once the last late cull read them.
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = pyramid;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = levelCount;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         0, nullptr, 0, nullptr, 1, &barrier);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, reducePipeline);
+
+    for (uint32_t level = 0; level < levelCount; level++) {
+        VkExtent2D source = level == 0 ? depthExtent : levelExtents[level - 1];
+        VkExtent2D destination = levelExtents[level];
+
+        ReduceConstants constants = {
+                {static_cast<int32_t>(source.width), static_cast<int32_t>(source.height)},
+                {static_cast<int32_t>(destination.width), static_cast<int32_t>(destination.height)}
+        };
+
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, reduceLayout, 0, 1, &reduceSets[level],
+                                0, nullptr);
+        vkCmdPushConstants(commandBuffer, reduceLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants),
+                           &constants);
+        vkCmdDispatch(commandBuffer, (destination.width + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE,
+                      (destination.height + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE, 1);
+
+        // The next level, or after the last one the late cull, reads what was just written.
+        memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    }
+}
@@ -0,0 +1,162 @@
+#ifndef VULKAN_TRY_VULKANOCCLUSIONCULLER_H
+#define VULKAN_TRY_VULKANOCCLUSIONCULLER_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include "VulkanDevice.h"
+#include "../scene/SceneMath.h"
+#include "../scene/FrustumCuller.h"
+#include "../mesh/MeshFormat.h"
+
+struct OcclusionStats {
+    // Objects handed to the GPU, the ones that survived frustum culling.
+    uint32_t objects;
+    // Drawn because they were visible the frame before, and drawn after passing the pyramid test.
+    uint32_t early;
+    uint32_t late;
+    uint32_t occluded;
+};
+
+/*
+ * Two phase occlusion culling against a hierarchical depth pyramid, for the instances of one mesh. Each object
+ * keeps the level of detail it was given, every phase has one indirect draw per level. Per frame:
+ *
+ *  - recordCull(early) appends the objects that were visible last frame to the instance buffer and counts them
+ *    into the early indirect draws, which the caller draws into depth,
+ *  - recordPyramid() reduces that depth buffer to a max depth mip chain,
+ *  - recordCull(late) tests every object against the pyramid, remembers the result for the next frame and
+ *    appends the newly visible objects to the late indirect draws, drawn on top of the early ones.
+ *
+ * Objects that were visible last frame are drawn early without a test, so nothing pops while the camera is still.
+ * Ordering between the phases and the draws is up to the caller, except that recordPyramid() and the late
+ * cull synchronize with each other. Counts come back to the host and are reported MAX_FRAMES_IN_FLIGHT frames
+ * late, by getStats().
+ */
+class VulkanOcclusionCuller {
+public:
+    static const uint32_t MAX_PYRAMID_LEVELS = 16;
+
+    // capacity is the largest object count beginFrame() is ever handed, object ids have to stay below it as well.
+    VulkanOcclusionCuller(VulkanDevice &device, uint32_t capacity);
+
+    VulkanOcclusionCuller(const VulkanOcclusionCuller &) = delete;
+
+    VulkanOcclusionCuller &operator=(const VulkanOcclusionCuller &) = delete;
+
+    ~VulkanOcclusionCuller();
+
+    // The depth buffer the early draws go to, read in VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL. Rebuilds
+    // the pyramid, so nothing recorded with the old target may still be executing.
+    void setDepthTarget(VkImageView depthView, VkExtent2D extent);
+
+    // Once the frame's fence has been waited on. Objects are the visible ones of worldMatrices and bounds, their
+    // indices double as ids, and visibleLods holds the level of detail of each. True when the counts of an earlier
+    // frame came back, getStats() holds them then.
+    bool beginFrame(uint32_t frame, const vtr::MeshLod *lods, uint32_t lodCount, const glm::mat4 *worldMatrices,
+                    const vtr::SphereBounds &bounds, const uint32_t *visible, const uint32_t *visibleLods,
+                    uint32_t visibleCount);
+
+    void recordCull(VkCommandBuffer commandBuffer, bool late, const glm::mat4 &viewProjection);
+
+    void recordPyramid(VkCommandBuffer commandBuffer);
+
+    // Both phases draw from the same buffer, late instances start at getInstanceOffset(true).
+    inline VkBuffer getInstanceBuffer() const {
+        return frames[currentFrame].instanceBuffer;
+    }
+
+    inline VkDeviceSize getInstanceOffset(bool late) const {
+        return late ? sizeof(glm::mat4) * capacity : 0;
+    }
+
+    // One VkDrawIndexedIndirectCommand per phase and level of detail.
+    inline VkBuffer getIndirectBuffer() const {
+        return frames[currentFrame].indirectBuffer;
+    }
+
+    inline VkDeviceSize getIndirectOffset(bool late, uint32_t lod) const {
+        return sizeof(VkDrawIndexedIndirectCommand) * ((late ? vtr::MESH_MAX_LODS : 0) + lod);
+    }
+
+    // Of the last frame whose counts made it back.
+    inline const OcclusionStats &getStats() const {
+        return stats;
+    }
+
+private:
+    // Layouts shared with occlusion_cull.comp.
+    struct Object {
+        glm::mat4 world;
+        glm::vec4 sphere;
+        uint32_t id;
+        uint32_t lod;
+        uint32_t padding[2];
+    };
+
+    struct Commands {
+        VkDrawIndexedIndirectCommand draws[2][vtr::MESH_MAX_LODS];
+        uint32_t occludedCount;
+    };
+
+    struct Frame {
+        VkBuffer objectBuffer;
+        VkDeviceMemory objectMemory;
+        Object *objects;
+
+        VkBuffer indirectBuffer;
+        VkDeviceMemory indirectMemory;
+        Commands *commands;
+
+        VkBuffer instanceBuffer;
+        VkDeviceMemory instanceMemory;
+
+        VkDescriptorSet descriptorSet;
+
+        uint32_t objectCount;
+        // Counts were recorded for readback and not read yet.
+        bool pending;
+    };
+
+    VulkanDevice &device;
+    uint32_t capacity;
+
+    VkDescriptorSetLayout cullSetLayout;
+    VkDescriptorSetLayout reduceSetLayout;
+    VkPipelineLayout cullLayout;
+    VkPipelineLayout reduceLayout;
+    VkPipeline cullPipeline;
+    VkPipeline reducePipeline;
+    VkDescriptorPool descriptorPool;
+    VkSampler sampler;
+
+    // Written by the late phase, read by the early phase of the next frame.
+    VkBuffer visibilityBuffer;
+    VkDeviceMemory visibilityMemory;
+    bool visibilityCleared = false;
+
+    Frame frames[MAX_FRAMES_IN_FLIGHT];
+    uint32_t currentFrame = 0;
+
+    VkExtent2D depthExtent = {};
+    VkImage pyramid = VK_NULL_HANDLE;
+    VkDeviceMemory pyramidMemory = VK_NULL_HANDLE;
+    // The whole chain for the late cull, and one view per level for the reduction.
+    VkImageView pyramidView = VK_NULL_HANDLE;
+    VkImageView levelViews[MAX_PYRAMID_LEVELS] = {};
+    VkExtent2D levelExtents[MAX_PYRAMID_LEVELS] = {};
+    VkDescriptorSet reduceSets[MAX_PYRAMID_LEVELS] = {};
+    uint32_t levelCount = 0;
+
+    OcclusionStats stats = {};
+
+    void createPipelines();
+
+    void createBuffers();
+
+    void createDescriptorSets();
+
+    void destroyPyramid();
+};
+
+
+#endif //VULKAN_TRY_VULKANOCCLUSIONCULLER_H
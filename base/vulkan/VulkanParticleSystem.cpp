@@ -0,0 +1,316 @@
+#include <cmath>
+#include <cstddef>
+#include "VulkanParticleSystem.h"
+#include "VulkanHelper.h"
+#include "VulkanShader.h"
+#include "../log/Profiler.h"
+
+namespace {
+    // particle_simulate.comp and particle_emit.comp.
+    const uint32_t PARTICLE_GROUP_SIZE = 64;
+
+    struct SimulateConstants {
+        glm::vec4 emitter;
+        glm::vec4 gravity;
+        float deltaSeconds;
+        float lifetime;
+        uint32_t capacity;
+        uint32_t emitCount;
+        uint32_t seed;
+    };
+
+    struct DrawConstants {
+        glm::mat4 viewProjection;
+        float size;
+    };
+
+    VkDescriptorSetLayout createSetLayout(VkDevice device, uint32_t bindingCount, VkShaderStageFlags stages) {
+        std::vector<VkDescriptorSetLayoutBinding> bindings(bindingCount);
+        for (uint32_t i = 0; i < bindingCount; i++) {
+            bindings[i] = {};
+            bindings[i].binding = i;
+            bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            bindings[i].descriptorCount = 1;
+            bindings[i].stageFlags = stages;
+        }
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = bindingCount;
+        layoutInfo.pBindings = bindings.data();
+
+        VkDescriptorSetLayout setLayout;
+        VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout))
+
+        return setLayout;
+    }
+
+    VkPipelineLayout createPipelineLayout(VkDevice device, VkDescriptorSetLayout setLayout, VkShaderStageFlags stages,
+                                          uint32_t constantSize) {
+        VkPushConstantRange pushConstantRange = {};
+        pushConstantRange.stageFlags = stages;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = constantSize;
+
+        VkPipelineLayoutCreateInfo layoutInfo = {};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layoutInfo.setLayoutCount = 1;
+        layoutInfo.pSetLayouts = &setLayout;
+        layoutInfo.pushConstantRangeCount = 1;
+        layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+        VkPipelineLayout layout;
+        VK_CHECK_RESULT(vkCreatePipelineLayout(device, &layoutInfo, nullptr, &layout))
+
+        return layout;
+    }
+
+    void memoryBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                       VkPipelineStageFlags dstStages, VkAccessFlags dstAccess) {
+        VkMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+
+        vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+VulkanParticleSystem::VulkanParticleSystem(VulkanDevice &device, uint32_t capacity) : device(device),
+                                                                                      capacity(capacity) {
+    createPipelines();
+    createBuffers();
+    createDescriptorSets();
+    createCommandBuffers();
+}
+
+VulkanParticleSystem::~VulkanParticleSystem() {
+    VkDevice logicalDevice = device.logicalDevice;
+
+    for (auto &frame: frames) {
+        vkDestroyBuffer(logicalDevice, frame.particleBuffer, nullptr);
+        device.memoryTracker.free(frame.particleMemory);
+        vkDestroyBuffer(logicalDevice, frame.stateBuffer, nullptr);
+        device.memoryTracker.free(frame.stateMemory);
+        vkDestroySemaphore(logicalDevice, frame.simulated, nullptr);
+    }
+
+    vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
+    vkDestroyDescriptorPool(logicalDevice, descriptorPool, nullptr);
+    vkDestroyShaderModule(logicalDevice, vertexShader, nullptr);
+    vkDestroyShaderModule(logicalDevice, fragmentShader, nullptr);
+    vkDestroyPipeline(logicalDevice, simulatePipeline, nullptr);
+    vkDestroyPipeline(logicalDevice, emitPipeline, nullptr);
+    vkDestroyPipeline(logicalDevice, finalizePipeline, nullptr);
+    vkDestroyPipelineLayout(logicalDevice, computeLayout, nullptr);
+    vkDestroyPipelineLayout(logicalDevice, drawLayout, nullptr);
+    vkDestroyDescriptorSetLayout(logicalDevice, computeSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(logicalDevice, drawSetLayout, nullptr);
+}
+
+void VulkanParticleSystem::createPipelines() {
+    VkDevice logicalDevice = device.logicalDevice;
+
+    // Source particles and state, destination particles and state. The draw reads one frame's particles.
+    computeSetLayout = createSetLayout(logicalDevice, 4, VK_SHADER_STAGE_COMPUTE_BIT);
+    drawSetLayout = createSetLayout(logicalDevice, 1, VK_SHADER_STAGE_VERTEX_BIT);
+
+    computeLayout = createPipelineLayout(logicalDevice, computeSetLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+                                         sizeof(SimulateConstants));
+    drawLayout = createPipelineLayout(logicalDevice, drawSetLayout, VK_SHADER_STAGE_VERTEX_BIT,
+                                      sizeof(DrawConstants));
+
+    simulatePipeline = createComputePipeline(logicalDevice, computeLayout, "particle_simulate.comp");
+    emitPipeline = createComputePipeline(logicalDevice, computeLayout, "particle_emit.comp");
+    finalizePipeline = createComputePipeline(logicalDevice, computeLayout, "particle_finalize.comp");
+
+    vertexShader = createShaderModule(logicalDevice, vtr::getShader("particle.vert"));
+    fragmentShader = createShaderModule(logicalDevice, vtr::getShader("particle.frag"));
+}
+
+void VulkanParticleSystem::createBuffers() {
+    VkDevice logicalDevice = device.logicalDevice;
+    VkPhysicalDevice physicalDevice = device.physicalDevice;
+
+    std::vector<uint32_t> queueFamilies = {device.queueFamilyIndices.graphicsFamily.value()};
+    if (device.asyncCompute) {
+        queueFamilies.push_back(device.queueFamilyIndices.computeFamily.value());
+    }
+
+    for (auto &frame: frames) {
+        vtr::createBuffer(logicalDevice, physicalDevice, device.memoryTracker, MemoryCategory::Buffer,
+                          sizeof(glm::vec4) * 2 * capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.particleBuffer, frame.particleMemory,
+                          queueFamilies);
+
+        vtr::createBuffer(logicalDevice, physicalDevice, device.memoryTracker, MemoryCategory::Buffer,
+                          sizeof(State),
+                          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                          VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                          frame.stateBuffer, frame.stateMemory, queueFamilies);
+        VK_CHECK_RESULT(vkMapMemory(logicalDevice, frame.stateMemory, 0, sizeof(State), 0,
+                                    reinterpret_cast<void **>(&frame.state)))
+
+        // Empty, the first step dispatches no simulation groups and the first draw no instances.
+        *frame.state = {0, {0, 1, 1}, {6, 0, 0, 0}};
+    }
+}
+
+void VulkanParticleSystem::createDescriptorSets() {
+    VkDescriptorPoolSize poolSize = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5 * MAX_FRAMES_IN_FLIGHT};
+
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 2 * MAX_FRAMES_IN_FLIGHT;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    VK_CHECK_RESULT(vkCreateDescriptorPool(device.logicalDevice, &poolInfo, nullptr, &descriptorPool))
+
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        Frame &frame = frames[i];
+        const Frame &previous = frames[(i + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT];
+
+        VkDescriptorSetLayout setLayouts[] = {computeSetLayout, drawSetLayout};
+        VkDescriptorSet sets[2];
+
+        VkDescriptorSetAllocateInfo allocateInfo = {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocateInfo.descriptorPool = descriptorPool;
+        allocateInfo.descriptorSetCount = 2;
+        allocateInfo.pSetLayouts = setLayouts;
+
+        VK_CHECK_RESULT(vkAllocateDescriptorSets(device.logicalDevice, &allocateInfo, sets))
+
+        frame.computeSet = sets[0];
+        frame.drawSet = sets[1];
+
+        VkDescriptorBufferInfo bufferInfos[] = {
+                {previous.particleBuffer, 0, VK_WHOLE_SIZE},
+                {previous.stateBuffer,    0, VK_WHOLE_SIZE},
+                {frame.particleBuffer,    0, VK_WHOLE_SIZE},
+                {frame.stateBuffer,       0, VK_WHOLE_SIZE}
+        };
+
+        VkWriteDescriptorSet writes[2] = {};
+        writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[0].dstSet = frame.computeSet;
+        writes[0].dstBinding = 0;
+        writes[0].descriptorCount = 4;
+        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[0].pBufferInfo = bufferInfos;
+
+        writes[1] = writes[0];
+        writes[1].dstSet = frame.drawSet;
+        writes[1].descriptorCount = 1;
+        writes[1].pBufferInfo = &bufferInfos[2];
+
+        vkUpdateDescriptorSets(device.logicalDevice, 2, writes, 0, nullptr);
+    }
+}
+
+void VulkanParticleSystem::createCommandBuffers() {
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = device.queueFamilyIndices.computeFamily.value();
+
+    VK_CHECK_RESULT(vkCreateCommandPool(device.logicalDevice, &poolInfo, nullptr, &commandPool))
+
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    for (auto &frame: frames) {
+        VkCommandBufferAllocateInfo allocateInfo = {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocateInfo.commandPool = commandPool;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandBufferCount = 1;
+
+        VK_CHECK_RESULT(vkAllocateCommandBuffers(device.logicalDevice, &allocateInfo, &frame.commandBuffer))
+        VK_CHECK_RESULT(vkCreateSemaphore(device.logicalDevice, &semaphoreInfo, nullptr, &frame.simulated))
+    }
+}
+
+void VulkanParticleSystem::simulate(uint32_t frame, float deltaSeconds) {
+    PROFILE_ZONE("particle step");
+
+    currentFrame = frame;
+    Frame &current = frames[frame];
+    const Frame &previous = frames[(frame + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT];
+
+    // The fence of this frame has signaled, and with it the graphics submit that waited for its last step.
+    aliveCount = current.state->count;
+
+    float emitted = emitter.rate * deltaSeconds + emitRemainder;
+    uint32_t emitCount = static_cast<uint32_t>(std::min(std::floor(emitted), static_cast<float>(capacity)));
+    emitRemainder = emitted - std::floor(emitted);
+    seed = seed * 1664525u + 1013904223u;
+
+    SimulateConstants constants = {glm::vec4(emitter.position, emitter.speed),
+                                   glm::vec4(emitter.gravity, emitter.drag), deltaSeconds, emitter.lifetime,
+                                   capacity, emitCount, seed};
+
+    VkCommandBuffer commandBuffer = current.commandBuffer;
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &beginInfo))
+
+    // The previous step wrote its particles and state, and read this frame's as its source.
+    memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                  VK_ACCESS_SHADER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                  VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                  VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+
+    vkCmdFillBuffer(commandBuffer, current.stateBuffer, 0, sizeof(uint32_t), 0);
+
+    memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computeLayout, 0, 1, &current.computeSet,
+                            0, nullptr);
+    vkCmdPushConstants(commandBuffer, computeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+
+    // One thread per particle of the previous step, as many groups as its finalize dispatch asked for.
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, simulatePipeline);
+    vkCmdDispatchIndirect(commandBuffer, previous.stateBuffer, offsetof(State, dispatch));
+
+    memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    if (emitCount > 0) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, emitPipeline);
+        vkCmdDispatch(commandBuffer, (emitCount + PARTICLE_GROUP_SIZE - 1) / PARTICLE_GROUP_SIZE, 1, 1);
+
+        memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    }
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, finalizePipeline);
+    vkCmdDispatch(commandBuffer, 1, 1, 1);
+
+    // The graphics queue is covered by the semaphore, the count is read on the host once the fence has signaled.
+    memoryBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                  VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+
+    VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer))
+
+    device.submitScheduler.enqueue(device.computeQueue, {{commandBuffer}, {}, {}, {current.simulated}});
+}
+
+void VulkanParticleSystem::recordDraw(VkCommandBuffer commandBuffer, VkPipeline pipeline,
+                                      const glm::mat4 &viewProjection) {
+    const Frame &frame = frames[currentFrame];
+    DrawConstants constants = {viewProjection, emitter.size};
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, drawLayout, 0, 1, &frame.drawSet, 0,
+                            nullptr);
+    vkCmdPushConstants(commandBuffer, drawLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+    vkCmdDrawIndirect(commandBuffer, frame.stateBuffer, offsetof(State, draw), 1, sizeof(VkDrawIndirectCommand));
+}
@@ -0,0 +1,136 @@
+#ifndef VULKAN_TRY_VULKANPARTICLESYSTEM_H
+#define VULKAN_TRY_VULKANPARTICLESYSTEM_H
+
+#include <vulkan/vulkan.h>
+#include "VulkanDevice.h"
+#include "../scene/SceneMath.h"
+
+struct ParticleEmitter {
+    glm::vec3 position = glm::vec3(0.0f, 0.8f, 0.5f);
+    float speed = 1.2f;
+    glm::vec3 gravity = glm::vec3(0.0f, 0.9f, 0.0f);
+    float drag = 0.2f;
+    // Particles per second, and the longest a particle lives in seconds.
+    float rate = 500000.0f;
+    float lifetime = 3.0f;
+    // Half the quad's edge, in clip space units.
+    float size = 0.004f;
+};
+
+/*
+ * Particles simulated entirely on the GPU, on the device's compute queue. Every step reads the particles of the
+ * step before and writes the survivors, compacted, followed by the newly emitted ones to the buffer of the current
+ * frame. A last dispatch turns their count into the indirect arguments of both the draw and the next step, so the
+ * host never learns the count in time to use it and only records a handful of dispatches.
+ *
+ * simulate() enqueues the step and leaves a semaphore for the frame's graphics work to wait on. With an async
+ * compute queue the next frame's step runs while the graphics queue still draws this one, they only share reads.
+ * Buffers are shared concurrently between both queue families, so no ownership transfers are needed.
+ */
+class VulkanParticleSystem {
+public:
+    ParticleEmitter emitter;
+
+    VulkanParticleSystem(VulkanDevice &device, uint32_t capacity);
+
+    VulkanParticleSystem(const VulkanParticleSystem &) = delete;
+
+    VulkanParticleSystem &operator=(const VulkanParticleSystem &) = delete;
+
+    ~VulkanParticleSystem();
+
+    // Once the frame's fence has been waited on, exactly once per frame that is submitted.
+    void simulate(uint32_t frame, float deltaSeconds);
+
+    // Signaled by the frame's step, the graphics submit waits on it at getWaitStages().
+    inline VkSemaphore getSemaphore() const {
+        return frames[currentFrame].simulated;
+    }
+
+    inline VkPipelineStageFlags getWaitStages() const {
+        return VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+    }
+
+    // Draws the particles of the current frame with a pipeline built from the getters below, blending additively.
+    void recordDraw(VkCommandBuffer commandBuffer, VkPipeline pipeline, const glm::mat4 &viewProjection);
+
+    inline VkShaderModule getVertexShader() const {
+        return vertexShader;
+    }
+
+    inline VkShaderModule getFragmentShader() const {
+        return fragmentShader;
+    }
+
+    inline VkPipelineLayout getDrawLayout() const {
+        return drawLayout;
+    }
+
+    // Of the step MAX_FRAMES_IN_FLIGHT frames back.
+    inline uint32_t getAliveCount() const {
+        return aliveCount;
+    }
+
+    inline uint32_t getCapacity() const {
+        return capacity;
+    }
+
+private:
+    // Layout shared with the particle shaders.
+    struct State {
+        uint32_t count;
+        VkDispatchIndirectCommand dispatch;
+        VkDrawIndirectCommand draw;
+    };
+
+    struct Frame {
+        VkBuffer particleBuffer;
+        VkDeviceMemory particleMemory;
+
+        // Host visible, so the count can be read back.
+        VkBuffer stateBuffer;
+        VkDeviceMemory stateMemory;
+        State *state;
+
+        // Reads the previous frame's particles and writes this one's.
+        VkDescriptorSet computeSet;
+        VkDescriptorSet drawSet;
+
+        VkCommandBuffer commandBuffer;
+        VkSemaphore simulated;
+    };
+
+    VulkanDevice &device;
+    uint32_t capacity;
+
+    VkDescriptorSetLayout computeSetLayout;
+    VkDescriptorSetLayout drawSetLayout;
+    VkPipelineLayout computeLayout;
+    VkPipelineLayout drawLayout;
+    VkPipeline simulatePipeline;
+    VkPipeline emitPipeline;
+    VkPipeline finalizePipeline;
+    VkShaderModule vertexShader;
+    VkShaderModule fragmentShader;
+    VkDescriptorPool descriptorPool;
+    VkCommandPool commandPool;
+
+    Frame frames[MAX_FRAMES_IN_FLIGHT];
+    uint32_t currentFrame = MAX_FRAMES_IN_FLIGHT - 1;
+
+    // Fractions of a particle carried over to the next step.
+    float emitRemainder = 0.0f;
+    uint32_t seed = 0;
+    uint32_t aliveCount = 0;
+
+    void createPipelines();
+
+    void createBuffers();
+
+    void createDescriptorSets();
+
+    void createCommandBuffers();
+};
+
+
+#endif //VULKAN_TRY_VULKANPARTICLESYSTEM_H
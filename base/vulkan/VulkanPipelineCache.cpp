@@ -0,0 +1,431 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include "VulkanPipelineCache.h"
+#include "VulkanHelper.h"
+#include "../log/Logger.h"
+
+namespace {
+    const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+    const uint64_t FNV_PRIME = 0x100000001b3ull;
+
+    inline void hashBytes(uint64_t &hash, const void *data, size_t size) {
+        const auto *bytes = static_cast<const uint8_t *>(data);
+
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * FNV_PRIME;
+        }
+    }
+
+    template<typename T>
+    inline void hashValue(uint64_t &hash, const T &value) {
+        hashBytes(hash, &value, sizeof(T));
+    }
+
+    // The element counts go in too, so neighbouring vectors cannot trade elements without changing the hash.
+    template<typename T>
+    inline void hashVector(uint64_t &hash, const std::vector<T> &values) {
+        hashValue(hash, values.size());
+        hashBytes(hash, values.data(), values.size() * sizeof(T));
+    }
+
+    // Vulkan structs have no operator==, the ones used here have no padding to trip over.
+    template<typename T>
+    inline bool sameElements(const std::vector<T> &a, const std::vector<T> &b) {
+        return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+    }
+}
+
+bool GraphicsPipelineDesc::operator==(const GraphicsPipelineDesc &other) const {
+    return vertexShader == other.vertexShader && fragmentShader == other.fragmentShader &&
+           sameElements(specializationEntries, other.specializationEntries) &&
+           specializationData == other.specializationData &&
+           sameElements(vertexBindings, other.vertexBindings) &&
+           sameElements(vertexAttributes, other.vertexAttributes) && topology == other.topology &&
+           polygonMode == other.polygonMode && cullMode == other.cullMode && frontFace == other.frontFace &&
+           depthTest == other.depthTest && depthWrite == other.depthWrite &&
+           depthCompareOp == other.depthCompareOp && blendEnable == other.blendEnable &&
+           srcColorBlendFactor == other.srcColorBlendFactor && dstColorBlendFactor == other.dstColorBlendFactor &&
+           colorBlendOp == other.colorBlendOp && srcAlphaBlendFactor == other.srcAlphaBlendFactor &&
+           dstAlphaBlendFactor == other.dstAlphaBlendFactor && alphaBlendOp == other.alphaBlendOp &&
+           colorWriteMask == other.colorWriteMask && colorFormats == other.colorFormats &&
+           depthFormat == other.depthFormat && layout == other.layout;
+}
+
+uint64_t GraphicsPipelineDesc::hash() const {
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    hashValue(hash, vertexShader);
+    hashValue(hash, fragmentShader);
+    hashVector(hash, specializationEntries);
+    hashVector(hash, specializationData);
+    hashVector(hash, vertexBindings);
+    hashVector(hash, vertexAttributes);
+    hashValue(hash, topology);
+    hashValue(hash, polygonMode);
+    hashValue(hash, cullMode);
+    hashValue(hash, frontFace);
+    hashValue(hash, depthTest);
+    hashValue(hash, depthWrite);
+    hashValue(hash, depthCompareOp);
+    hashValue(hash, blendEnable);
+    hashValue(hash, srcColorBlendFactor);
+    hashValue(hash, dstColorBlendFactor);
+    hashValue(hash, colorBlendOp);
+    hashValue(hash, srcAlphaBlendFactor);
+    hashValue(hash, dstAlphaBlendFactor);
+    hashValue(hash, alphaBlendOp);
+    hashValue(hash, colorWriteMask);
+    hashVector(hash, colorFormats);
+    hashValue(hash, depthFormat);
+    hashValue(hash, layout);
+
+    return hash;
+}
+
+VulkanPipelineCache::VulkanPipelineCache(VulkanDevice &device, const std::string &cachePath)
+        : device(device), cachePath(cachePath) {
+    std::vector<uint8_t> initialData;
+
+    FILE *file = fopen(cachePath.c_str(), "rb");
+    if (file != nullptr) {
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        if (size > 0) {
+            initialData.resize(static_cast<size_t>(size));
+            if (fread(initialData.data(), 1, initialData.size(), file) != initialData.size()) {
+                initialData.clear();
+            }
+        }
+
+        fclose(file);
+    }
+
+    // The driver checks the header itself and starts empty when the data came from another device or driver.
+    VkPipelineCacheCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = initialData.size();
+    createInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+    VK_CHECK_RESULT(vkCreatePipelineCache(device.logicalDevice, &createInfo, nullptr, &pipelineCache))
+
+    LOG_VERBOSE("Pipeline cache %s, %zu bytes", cachePath.c_str(), initialData.size());
+
+    thread = std::thread(&VulkanPipelineCache::compileLoop, this);
+}
+
+VulkanPipelineCache::~VulkanPipelineCache() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+        queue.clear();
+    }
+
+    queuedCondition.notify_one();
+    thread.join();
+
+    save();
+
+    PipelineCacheStats stats = getStats();
+    LOG_INFO("Pipelines: %u compiled in %.1f ms, %u failed, %llu hits, %llu misses", stats.compiled,
+             stats.compileSeconds * 1000.0, stats.failed, (unsigned long long) stats.hits,
+             (unsigned long long) stats.misses);
+
+    for (auto &shard: shards) {
+        for (auto &entry: shard.entries) {
+            if (entry.second.pipeline != VK_NULL_HANDLE) {
+                vkDestroyPipeline(device.logicalDevice, entry.second.pipeline, nullptr);
+            }
+        }
+    }
+
+    vkDestroyPipelineCache(device.logicalDevice, pipelineCache, nullptr);
+}
+
+bool VulkanPipelineCache::findEntry(const GraphicsPipelineDesc &desc, Entry &entry) {
+    Shard &shard = shardOf(desc);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+    auto found = shard.entries.find(desc);
+    if (found == shard.entries.end()) {
+        return false;
+    }
+
+    entry = found->second;
+    return true;
+}
+
+VkPipeline VulkanPipelineCache::getPipeline(const GraphicsPipelineDesc &desc) {
+    Entry entry = {};
+
+    if (findEntry(desc, entry)) {
+        if (entry.state == EntryState::Ready) {
+            hits++;
+        }
+
+        return entry.pipeline;
+    }
+
+    {
+        Shard &shard = shardOf(desc);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+        // Another thread may have queued it between the two locks.
+        auto inserted = shard.entries.emplace(desc, Entry{EntryState::Queued, VK_NULL_HANDLE});
+        if (!inserted.second) {
+            return inserted.first->second.pipeline;
+        }
+    }
+
+    misses++;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        queue.push_back(desc);
+    }
+
+    queuedCondition.notify_one();
+
+    return VK_NULL_HANDLE;
+}
+
+VkPipeline VulkanPipelineCache::getPipelineBlocking(const GraphicsPipelineDesc &desc) {
+    VkPipeline pipeline = getPipeline(desc);
+    if (pipeline != VK_NULL_HANDLE) {
+        return pipeline;
+    }
+
+    Entry entry = {EntryState::Queued, VK_NULL_HANDLE};
+
+    std::unique_lock<std::mutex> lock(queueMutex);
+    compiledCondition.wait(lock, [&]() {
+        return stopping || (findEntry(desc, entry) && entry.state != EntryState::Queued);
+    });
+
+    if (entry.state != EntryState::Ready) {
+        throw std::runtime_error("failed to create graphics pipeline!");
+    }
+
+    return entry.pipeline;
+}
+
+void VulkanPipelineCache::waitIdle() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    compiledCondition.wait(lock, [this]() { return stopping || (queue.empty() && !compiling); });
+}
+
+PipelineCacheStats VulkanPipelineCache::getStats() {
+    std::lock_guard<std::mutex> lock(queueMutex);
+
+    return {hits.load(), misses.load(), compiledCount, failedCount, compileSeconds};
+}
+
+void VulkanPipelineCache::compileLoop() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+
+    while (true) {
+        queuedCondition.wait(lock, [this]() { return !queue.empty() || stopping; });
+
+        if (stopping) {
+            break;
+        }
+
+        GraphicsPipelineDesc desc = std::move(queue.front());
+        queue.pop_front();
+        compiling = true;
+        lock.unlock();
+
+        auto start = std::chrono::steady_clock::now();
+        VkPipeline pipeline = VK_NULL_HANDLE;
+
+        // Runs on the compile thread, a broken pipeline is reported and the frame keeps skipping its draws.
+        try {
+            pipeline = compile(desc);
+        } catch (const std::exception &exception) {
+            LOG_ERROR("Failed to compile pipeline: %s", exception.what());
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        {
+            Shard &shard = shardOf(desc);
+            std::unique_lock<std::shared_mutex> shardLock(shard.mutex);
+
+            Entry &entry = shard.entries[desc];
+            entry.state = pipeline != VK_NULL_HANDLE ? EntryState::Ready : EntryState::Failed;
+            entry.pipeline = pipeline;
+        }
+
+        reportCacheSize();
+
+        lock.lock();
+        compiling = false;
+        compileSeconds += seconds;
+        if (pipeline != VK_NULL_HANDLE) {
+            compiledCount++;
+        } else {
+            failedCount++;
+        }
+
+        compiledCondition.notify_all();
+    }
+
+    // Waiters would otherwise block forever on pipelines that are never going to be compiled.
+    compiling = false;
+    compiledCondition.notify_all();
+}
+
+VkPipeline VulkanPipelineCache::compile(const GraphicsPipelineDesc &desc) {
+    VkSpecializationInfo specializationInfo = {};
+    specializationInfo.mapEntryCount = static_cast<uint32_t>(desc.specializationEntries.size());
+    specializationInfo.pMapEntries = desc.specializationEntries.data();
+    specializationInfo.dataSize = desc.specializationData.size();
+    specializationInfo.pData = desc.specializationData.data();
+
+    VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = desc.vertexShader;
+    shaderStages[0].pName = "main";
+
+    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = desc.fragmentShader;
+    shaderStages[1].pName = "main";
+
+    if (!desc.specializationEntries.empty()) {
+        shaderStages[0].pSpecializationInfo = &specializationInfo;
+        shaderStages[1].pSpecializationInfo = &specializationInfo;
+    }
+
+    VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo = {};
+    vertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputStateCreateInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(desc.vertexBindings.size());
+    vertexInputStateCreateInfo.pVertexBindingDescriptions = desc.vertexBindings.data();
+    vertexInputStateCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(desc.vertexAttributes.size());
+    vertexInputStateCreateInfo.pVertexAttributeDescriptions = desc.vertexAttributes.data();
+
+    VkPipelineInputAssemblyStateCreateInfo assemblyStateCreateInfo = {};
+    assemblyStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    assemblyStateCreateInfo.topology = desc.topology;
+    assemblyStateCreateInfo.primitiveRestartEnable = VK_FALSE;
+
+    // Viewport and scissor are set while recording, so pipelines outlive swapchain resizes.
+    VkPipelineViewportStateCreateInfo viewportStateCreateInfo = {};
+    viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportStateCreateInfo.scissorCount = 1;
+    viewportStateCreateInfo.viewportCount = 1;
+
+    VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+
+    VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
+    dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicStateCreateInfo.dynamicStateCount = 2;
+    dynamicStateCreateInfo.pDynamicStates = dynamicStates;
+
+    VkPipelineRasterizationStateCreateInfo rasterizationStateCreateInfo = {};
+    rasterizationStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizationStateCreateInfo.cullMode = desc.cullMode;
+    rasterizationStateCreateInfo.lineWidth = 1.0f;
+    rasterizationStateCreateInfo.frontFace = desc.frontFace;
+    rasterizationStateCreateInfo.polygonMode = desc.polygonMode;
+    rasterizationStateCreateInfo.rasterizerDiscardEnable = VK_FALSE;
+    rasterizationStateCreateInfo.depthBiasEnable = VK_FALSE;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = desc.depthTest ? VK_TRUE : VK_FALSE;
+    depthStencil.depthWriteEnable = desc.depthWrite ? VK_TRUE : VK_FALSE;
+    depthStencil.depthCompareOp = desc.depthCompareOp;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling = {};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+    colorBlendAttachment.colorWriteMask = desc.colorWriteMask;
+    colorBlendAttachment.blendEnable = desc.blendEnable ? VK_TRUE : VK_FALSE;
+    colorBlendAttachment.srcColorBlendFactor = desc.srcColorBlendFactor;
+    colorBlendAttachment.dstColorBlendFactor = desc.dstColorBlendFactor;
+    colorBlendAttachment.colorBlendOp = desc.colorBlendOp;
+    colorBlendAttachment.srcAlphaBlendFactor = desc.srcAlphaBlendFactor;
+    colorBlendAttachment.dstAlphaBlendFactor = desc.dstAlphaBlendFactor;
+    colorBlendAttachment.alphaBlendOp = desc.alphaBlendOp;
+
+    std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments(desc.colorFormats.size(),
+                                                                           colorBlendAttachment);
+
+    VkPipelineColorBlendStateCreateInfo colorBlending = {};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.logicOp = VK_LOGIC_OP_COPY;
+    colorBlending.attachmentCount = static_cast<uint32_t>(colorBlendAttachments.size());
+    colorBlending.pAttachments = colorBlendAttachments.data();
+
+    VkPipelineRenderingCreateInfoKHR renderingInfo = {};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    renderingInfo.colorAttachmentCount = static_cast<uint32_t>(desc.colorFormats.size());
+    renderingInfo.pColorAttachmentFormats = desc.colorFormats.data();
+    renderingInfo.depthAttachmentFormat = desc.depthFormat;
+    renderingInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = device.dynamicRendering ? &renderingInfo : nullptr;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputStateCreateInfo;
+    pipelineInfo.pInputAssemblyState = &assemblyStateCreateInfo;
+    pipelineInfo.pViewportState = &viewportStateCreateInfo;
+    pipelineInfo.pRasterizationState = &rasterizationStateCreateInfo;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = desc.depthFormat != VK_FORMAT_UNDEFINED ? &depthStencil : nullptr;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicStateCreateInfo;
+    pipelineInfo.layout = desc.layout;
+    pipelineInfo.renderPass = device.dynamicRendering ? VK_NULL_HANDLE : desc.renderPass;
+    pipelineInfo.subpass = 0;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    VkPipeline pipeline;
+    VK_CHECK_RESULT(vkCreateGraphicsPipelines(device.logicalDevice, pipelineCache, 1, &pipelineInfo, nullptr,
+                                              &pipeline))
+
+    return pipeline;
+}
+
+void VulkanPipelineCache::reportCacheSize() {
+    size_t size = 0;
+    if (vkGetPipelineCacheData(device.logicalDevice, pipelineCache, &size, nullptr) == VK_SUCCESS) {
+        device.memoryTracker.setHostUsage(MemoryCategory::PipelineCache, size);
+    }
+}
+
+void VulkanPipelineCache::save() {
+    size_t size = 0;
+    if (vkGetPipelineCacheData(device.logicalDevice, pipelineCache, &size, nullptr) != VK_SUCCESS || size == 0) {
+        return;
+    }
+
+    std::vector<uint8_t> data(size);
+    if (vkGetPipelineCacheData(device.logicalDevice, pipelineCache, &size, data.data()) != VK_SUCCESS) {
+        return;
+    }
+
+    FILE *file = fopen(cachePath.c_str(), "wb");
+    if (file == nullptr) {
+        LOG_WARNING("Failed to save the pipeline cache to %s", cachePath.c_str());
+        return;
+    }
+
+    if (fwrite(data.data(), 1, size, file) != size) {
+        LOG_WARNING("Failed to save the pipeline cache to %s", cachePath.c_str());
+    }
+
+    fclose(file);
+}
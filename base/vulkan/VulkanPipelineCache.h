@@ -0,0 +1,165 @@
+#ifndef VULKAN_TRY_VULKANPIPELINECACHE_H
+#define VULKAN_TRY_VULKANPIPELINECACHE_H
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "VulkanDevice.h"
+
+/*
+ * Everything a graphics pipeline is built from. Viewport and scissor are always dynamic. Two descriptions that
+ * compare equal share one pipeline.
+ */
+struct GraphicsPipelineDesc {
+    VkShaderModule vertexShader = VK_NULL_HANDLE;
+    VkShaderModule fragmentShader = VK_NULL_HANDLE;
+
+    // One block of specialization constants, handed to both stages.
+    std::vector<VkSpecializationMapEntry> specializationEntries;
+    std::vector<uint8_t> specializationData;
+
+    std::vector<VkVertexInputBindingDescription> vertexBindings;
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+    // Ignored while depthFormat is VK_FORMAT_UNDEFINED.
+    bool depthTest = false;
+    bool depthWrite = false;
+    VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+
+    // Applies to every color attachment.
+    bool blendEnable = false;
+    VkBlendFactor srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    VkBlendFactor dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+    VkBlendOp colorBlendOp = VK_BLEND_OP_ADD;
+    VkBlendFactor srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    VkBlendFactor dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    VkBlendOp alphaBlendOp = VK_BLEND_OP_ADD;
+    VkColorComponentFlags colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                           VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    std::vector<VkFormat> colorFormats;
+    VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+
+    // Without dynamic rendering pipelines are built against a render pass. Any render pass compatible with the
+    // formats above will do, so it is not part of the key, but it has to stay alive until the pipeline is built.
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+
+    bool operator==(const GraphicsPipelineDesc &other) const;
+
+    uint64_t hash() const;
+};
+
+struct GraphicsPipelineDescHash {
+    inline size_t operator()(const GraphicsPipelineDesc &desc) const {
+        return static_cast<size_t>(desc.hash());
+    }
+};
+
+struct PipelineCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint32_t compiled;
+    uint32_t failed;
+    double compileSeconds;
+};
+
+/*
+ * Pipelines keyed by their description. Lookups go to one of SHARD_COUNT maps behind reader writer locks, so any
+ * thread can ask for pipelines while the compile thread publishes new ones. A miss queues the description and
+ * returns VK_NULL_HANDLE right away, the caller skips the draw until a later frame finds the pipeline ready.
+ *
+ * Compiles go through a VkPipelineCache that is loaded from and saved to cachePath, so later runs mostly hit the
+ * driver's cache.
+ */
+class VulkanPipelineCache {
+public:
+    static const uint32_t SHARD_COUNT = 16;
+
+    VulkanPipelineCache(VulkanDevice &device, const std::string &cachePath);
+
+    VulkanPipelineCache(const VulkanPipelineCache &) = delete;
+
+    VulkanPipelineCache &operator=(const VulkanPipelineCache &) = delete;
+
+    ~VulkanPipelineCache();
+
+    // VK_NULL_HANDLE while the pipeline is compiling, or when it failed to compile.
+    VkPipeline getPipeline(const GraphicsPipelineDesc &desc);
+
+    // Waits for the compile thread, for loading screens and batch runs. Throws when the pipeline failed.
+    VkPipeline getPipelineBlocking(const GraphicsPipelineDesc &desc);
+
+    // Returns once every queued description is compiled.
+    void waitIdle();
+
+    PipelineCacheStats getStats();
+
+private:
+    enum class EntryState {
+        Queued, Ready, Failed
+    };
+
+    struct Entry {
+        EntryState state;
+        VkPipeline pipeline;
+    };
+
+    struct Shard {
+        std::shared_mutex mutex;
+        std::unordered_map<GraphicsPipelineDesc, Entry, GraphicsPipelineDescHash> entries;
+    };
+
+    VulkanDevice &device;
+    std::string cachePath;
+    VkPipelineCache pipelineCache;
+
+    Shard shards[SHARD_COUNT];
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+
+    // Guards the queue and the compile counters, compiled is signaled after each pipeline.
+    std::mutex queueMutex;
+    std::condition_variable queuedCondition;
+    std::condition_variable compiledCondition;
+    std::deque<GraphicsPipelineDesc> queue;
+    bool compiling = false;
+    bool stopping = false;
+    uint32_t compiledCount = 0;
+    uint32_t failedCount = 0;
+    double compileSeconds = 0.0;
+
+    std::thread thread;
+
+    inline Shard &shardOf(const GraphicsPipelineDesc &desc) {
+        return shards[desc.hash() % SHARD_COUNT];
+    }
+
+    // False when the description was never requested.
+    bool findEntry(const GraphicsPipelineDesc &desc, Entry &entry);
+
+    void compileLoop();
+
+    VkPipeline compile(const GraphicsPipelineDesc &desc);
+
+    void reportCacheSize();
+
+    void save();
+};
+
+
+#endif //VULKAN_TRY_VULKANPIPELINECACHE_H
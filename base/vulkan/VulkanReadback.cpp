@@ -0,0 +1,209 @@
+#include <algorithm>
+#include "VulkanReadback.h"
+#include "VulkanHelper.h"
+
+VulkanReadback::VulkanReadback(VulkanDevice &device, uint32_t slotCount, Consumer consumer)
+        : device(device), consumer(std::move(consumer)), slots(slotCount) {
+    for (auto &slot: slots) {
+        slot = {};
+    }
+}
+
+VulkanReadback::~VulkanReadback() {
+    for (auto &slot: slots) {
+        if (slot.fence != VK_NULL_HANDLE) {
+            vkWaitForFences(device.logicalDevice, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+        }
+
+        releaseSlot(slot);
+    }
+}
+
+uint32_t VulkanReadback::texelSize(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+        case VK_FORMAT_A8B8G8R8_UNORM_PACK32:
+        case VK_FORMAT_A8B8G8R8_SRGB_PACK32:
+            return 4;
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+            return 8;
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+            return 16;
+        default:
+            throw std::runtime_error("unsupported readback format");
+    }
+}
+
+void VulkanReadback::allocateSlot(Slot &slot, VkDeviceSize size) {
+    releaseSlot(slot);
+
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VK_CHECK_RESULT(vkCreateBuffer(device.logicalDevice, &bufferInfo, nullptr, &slot.buffer))
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device.logicalDevice, slot.buffer, &requirements);
+
+    // Reads through uncached memory are slow, prefer cached memory and invalidate it by hand.
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(device.physicalDevice, &memoryProperties);
+
+    const VkMemoryPropertyFlags preferred[] = {
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    };
+
+    uint32_t memoryType = UINT32_MAX;
+    for (uint32_t p = 0; p < 2 && memoryType == UINT32_MAX; p++) {
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+            if ((requirements.memoryTypeBits & (1u << i)) != 0 &&
+                (memoryProperties.memoryTypes[i].propertyFlags & preferred[p]) == preferred[p]) {
+                memoryType = i;
+                break;
+            }
+        }
+    }
+
+    if (memoryType == UINT32_MAX) {
+        throw std::runtime_error("failed to find host visible memory for readback!");
+    }
+
+    slot.coherent = (memoryProperties.memoryTypes[memoryType].propertyFlags &
+                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+    VkMemoryAllocateInfo allocateInfo = {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocateInfo.allocationSize = requirements.size;
+    allocateInfo.memoryTypeIndex = memoryType;
+
+    slot.memory = device.memoryTracker.allocate(MemoryCategory::Staging, allocateInfo);
+    VK_CHECK_RESULT(vkBindBufferMemory(device.logicalDevice, slot.buffer, slot.memory, 0))
+
+    void *mapping;
+    VK_CHECK_RESULT(vkMapMemory(device.logicalDevice, slot.memory, 0, VK_WHOLE_SIZE, 0, &mapping))
+
+    slot.mapping = static_cast<uint8_t *>(mapping);
+    slot.capacity = size;
+}
+
+void VulkanReadback::releaseSlot(Slot &slot) {
+    if (slot.buffer == VK_NULL_HANDLE) {
+        return;
+    }
+
+    vkDestroyBuffer(device.logicalDevice, slot.buffer, nullptr);
+    device.memoryTracker.free(slot.memory);
+
+    slot.buffer = VK_NULL_HANDLE;
+    slot.memory = VK_NULL_HANDLE;
+    slot.mapping = nullptr;
+    slot.capacity = 0;
+}
+
+void VulkanReadback::update() {
+    std::vector<Slot *> finished;
+
+    for (auto &slot: slots) {
+        if (slot.fence != VK_NULL_HANDLE && vkGetFenceStatus(device.logicalDevice, slot.fence) == VK_SUCCESS) {
+            finished.push_back(&slot);
+        }
+    }
+
+    // Fences on one queue signal in submission order, this only keeps delivery in frame order.
+    std::sort(finished.begin(), finished.end(), [](const Slot *a, const Slot *b) {
+        return a->frameNumber < b->frameNumber;
+    });
+
+    for (Slot *slot: finished) {
+        if (!slot->coherent) {
+            VkMappedMemoryRange range = {};
+            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            range.memory = slot->memory;
+            range.offset = 0;
+            range.size = VK_WHOLE_SIZE;
+
+            VK_CHECK_RESULT(vkInvalidateMappedMemoryRanges(device.logicalDevice, 1, &range))
+        }
+
+        ReadbackFrame frame = {slot->mapping, slot->extent.width, slot->extent.height, slot->format,
+                               slot->frameNumber};
+
+        slot->fence = VK_NULL_HANDLE;
+        consumer(frame);
+    }
+}
+
+bool VulkanReadback::beginCapture(VkExtent2D extent, VkFormat format) {
+    for (uint32_t i = 0; i < slots.size(); i++) {
+        Slot &slot = slots[i];
+
+        if (slot.fence != VK_NULL_HANDLE) {
+            continue;
+        }
+
+        VkDeviceSize size = VkDeviceSize(extent.width) * extent.height * texelSize(format);
+        if (slot.capacity < size) {
+            allocateSlot(slot, size);
+        }
+
+        slot.extent = extent;
+        slot.format = format;
+        recording = i;
+
+        return true;
+    }
+
+    return false;
+}
+
+void VulkanReadback::recordCopy(VkCommandBuffer commandBuffer, VkImage image) {
+    if (recording == UINT32_MAX) {
+        throw std::runtime_error("readback copy recorded outside of a capture");
+    }
+
+    const Slot &slot = slots[recording];
+
+    VkBufferImageCopy region = {};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {slot.extent.width, slot.extent.height, 1};
+
+    vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer, 1, &region);
+
+    // Makes the copy visible to host reads once the fence has signaled.
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = slot.buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1,
+                         &barrier, 0, nullptr);
+}
+
+void VulkanReadback::endCapture(VkFence fence, uint64_t frameNumber) {
+    if (recording == UINT32_MAX) {
+        return;
+    }
+
+    slots[recording].fence = fence;
+    slots[recording].frameNumber = frameNumber;
+    recording = UINT32_MAX;
+}
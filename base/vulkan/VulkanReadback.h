@@ -0,0 +1,80 @@
+#ifndef VULKAN_TRY_VULKANREADBACK_H
+#define VULKAN_TRY_VULKANREADBACK_H
+
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <vector>
+#include "VulkanDevice.h"
+
+struct ReadbackFrame {
+    // Tightly packed rows, valid only during the consumer call.
+    const uint8_t *pixels;
+    uint32_t width;
+    uint32_t height;
+    VkFormat format;
+    uint64_t frameNumber;
+};
+
+/*
+ * Copies rendered images back to the host without waiting on the GPU. A capture records vkCmdCopyImageToBuffer
+ * into the frame's command buffer, targeting one buffer of a ring of host visible ones, and is handed to the
+ * consumer once the fence the frame was submitted with has signaled. When every buffer is still in flight the
+ * capture is refused instead of stalling.
+ *
+ * Per frame: update() after waiting for the frame fence and before resetting it, then beginCapture(),
+ * recordCopy() while recording and endCapture() with the fence the command buffer is submitted with.
+ */
+class VulkanReadback {
+public:
+    typedef std::function<void(const ReadbackFrame &frame)> Consumer;
+
+    VulkanReadback(VulkanDevice &device, uint32_t slotCount, Consumer consumer);
+
+    VulkanReadback(const VulkanReadback &) = delete;
+
+    VulkanReadback &operator=(const VulkanReadback &) = delete;
+
+    ~VulkanReadback();
+
+    // Hands finished captures to the consumer, on the calling thread.
+    void update();
+
+    // false when all slots are in flight, the frame is then not captured.
+    bool beginCapture(VkExtent2D extent, VkFormat format);
+
+    // image has to be in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL.
+    void recordCopy(VkCommandBuffer commandBuffer, VkImage image);
+
+    void endCapture(VkFence fence, uint64_t frameNumber);
+
+    static uint32_t texelSize(VkFormat format);
+
+private:
+    struct Slot {
+        VkBuffer buffer;
+        VkDeviceMemory memory;
+        VkDeviceSize capacity;
+        uint8_t *mapping;
+        bool coherent;
+
+        // Set while in flight.
+        VkFence fence;
+        VkExtent2D extent;
+        VkFormat format;
+        uint64_t frameNumber;
+    };
+
+    VulkanDevice &device;
+    Consumer consumer;
+
+    std::vector<Slot> slots;
+    // Slot between beginCapture() and endCapture(), UINT32_MAX otherwise.
+    uint32_t recording = UINT32_MAX;
+
+    void allocateSlot(Slot &slot, VkDeviceSize size);
+
+    void releaseSlot(Slot &slot);
+};
+
+
+#endif //VULKAN_TRY_VULKANREADBACK_H
@@ -0,0 +1,864 @@
+#include <algorithm>
+#include "VulkanRenderGraph.h"
+#include "VulkanHelper.h"
+#include "../log/Logger.h"
+#include "../log/Profiler.h"
+
+namespace {
+    struct UsageInfo {
+        VkPipelineStageFlags stages;
+        VkAccessFlags readAccess;
+        VkAccessFlags writeAccess;
+        VkImageLayout layout;
+        VkImageUsageFlags imageUsage;
+    };
+
+    const VkAccessFlags WRITE_ACCESS = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                       VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT |
+                                       VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT |
+                                       VK_ACCESS_MEMORY_WRITE_BIT;
+
+    UsageInfo usageInfo(RenderGraphUsage usage) {
+        switch (usage) {
+            case RenderGraphUsage::ColorAttachment:
+                return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT,
+                        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT};
+            case RenderGraphUsage::DepthAttachment:
+                return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                        VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT};
+            case RenderGraphUsage::DepthRead:
+                return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT, 0,
+                        VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT};
+            case RenderGraphUsage::Sampled:
+                return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, 0,
+                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT};
+            case RenderGraphUsage::Storage:
+                return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                        VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT};
+            case RenderGraphUsage::TransferSource:
+                return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, 0,
+                        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT};
+            case RenderGraphUsage::TransferDestination:
+                return {VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT};
+            case RenderGraphUsage::VertexBuffer:
+                return {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, 0,
+                        VK_IMAGE_LAYOUT_UNDEFINED, 0};
+            case RenderGraphUsage::IndexBuffer:
+                return {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED, 0};
+            case RenderGraphUsage::IndirectBuffer:
+                return {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, 0,
+                        VK_IMAGE_LAYOUT_UNDEFINED, 0};
+            case RenderGraphUsage::UniformBuffer:
+                return {VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                        VK_ACCESS_UNIFORM_READ_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED, 0};
+        }
+
+        throw std::runtime_error("unknown render graph usage");
+    }
+
+    bool isDepthFormat(VkFormat format) {
+        return format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_D32_SFLOAT || format == VK_FORMAT_D24_UNORM_S8_UINT ||
+               format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+    }
+
+    VkImageAspectFlags aspectMask(VkFormat format) {
+        return isDepthFormat(format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+
+    // What the barrier generation knows about a resource at a point of the frame.
+    struct ResourceState {
+        VkImageLayout layout;
+        // Last write, and the reads since then. A write waits on both, a read only on the write.
+        VkPipelineStageFlags writeStages;
+        VkAccessFlags writeAccess;
+        VkPipelineStageFlags readStages;
+        // Reads the last write has already been made visible to.
+        VkPipelineStageFlags visibleStages;
+        VkAccessFlags visibleAccess;
+    };
+}
+
+VulkanRenderGraph::VulkanRenderGraph(VulkanDevice &device) : device(device) {
+}
+
+VulkanRenderGraph::~VulkanRenderGraph() {
+    destroyObjects();
+}
+
+void VulkanRenderGraph::reset() {
+    destroyObjects();
+
+    resources.clear();
+    passes.clear();
+    order.clear();
+    barriers.clear();
+
+    compiled = false;
+    culledPassCount = 0;
+    barrierCount = 0;
+    transientMemorySize = 0;
+    unaliasedMemorySize = 0;
+}
+
+void VulkanRenderGraph::destroyObjects() {
+    for (auto &pass: passes) {
+        for (auto &framebuffer: pass.framebuffers) {
+            vkDestroyFramebuffer(device.logicalDevice, framebuffer.second, nullptr);
+        }
+        pass.framebuffers.clear();
+
+        if (pass.renderPass != VK_NULL_HANDLE) {
+            vkDestroyRenderPass(device.logicalDevice, pass.renderPass, nullptr);
+            pass.renderPass = VK_NULL_HANDLE;
+        }
+    }
+
+    for (auto &resource: resources) {
+        if (resource.imported || resource.image == VK_NULL_HANDLE) {
+            continue;
+        }
+
+        vkDestroyImageView(device.logicalDevice, resource.imageView, nullptr);
+        vkDestroyImage(device.logicalDevice, resource.image, nullptr);
+        resource.imageView = VK_NULL_HANDLE;
+        resource.image = VK_NULL_HANDLE;
+    }
+
+    for (auto &block: memoryBlocks) {
+        device.memoryTracker.free(block.memory);
+    }
+    memoryBlocks.clear();
+}
+
+RenderGraphResource VulkanRenderGraph::importImage(const std::string &name, VkFormat format, VkExtent2D extent,
+                                                   VkImageLayout finalLayout) {
+    Resource resource = {};
+    resource.name = name;
+    resource.imported = true;
+    resource.desc = {format, extent, 0};
+    resource.finalLayout = finalLayout;
+
+    resources.push_back(resource);
+
+    return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+
+RenderGraphResource VulkanRenderGraph::importBuffer(const std::string &name) {
+    Resource resource = {};
+    resource.name = name;
+    resource.imported = true;
+    resource.isBuffer = true;
+
+    resources.push_back(resource);
+
+    return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+
+RenderGraphResource VulkanRenderGraph::createImage(const std::string &name, const RenderGraphImageDesc &desc) {
+    Resource resource = {};
+    resource.name = name;
+    resource.desc = desc;
+    resource.usage = desc.extraUsage;
+
+    resources.push_back(resource);
+
+    return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+
+RenderGraphPass VulkanRenderGraph::addPass(const std::string &name, PassCallback callback) {
+    if (compiled) {
+        throw std::runtime_error("render graph is compiled, reset() it before adding passes");
+    }
+
+    Pass pass = {};
+    pass.name = name;
+    pass.callback = std::move(callback);
+
+    passes.push_back(std::move(pass));
+
+    return static_cast<RenderGraphPass>(passes.size() - 1);
+}
+
+void VulkanRenderGraph::addColorAttachment(RenderGraphPass pass, RenderGraphResource image, VkAttachmentLoadOp loadOp,
+                                           VkClearValue clearValue) {
+    addAccess(pass, image, RenderGraphUsage::ColorAttachment, 0, true);
+
+    // Loading keeps the previous contents, which makes the pass a reader as well.
+    if (loadOp == VK_ATTACHMENT_LOAD_OP_LOAD) {
+        addAccess(pass, image, RenderGraphUsage::ColorAttachment, 0, false);
+    }
+
+    passes[pass].attachments.push_back({image, loadOp, clearValue, false, VK_ATTACHMENT_STORE_OP_STORE});
+}
+
+void VulkanRenderGraph::addDepthAttachment(RenderGraphPass pass, RenderGraphResource image, VkAttachmentLoadOp loadOp,
+                                           VkClearValue clearValue) {
+    addAccess(pass, image, RenderGraphUsage::DepthAttachment, 0, true);
+
+    if (loadOp == VK_ATTACHMENT_LOAD_OP_LOAD) {
+        addAccess(pass, image, RenderGraphUsage::DepthAttachment, 0, false);
+    }
+
+    passes[pass].attachments.push_back({image, loadOp, clearValue, true, VK_ATTACHMENT_STORE_OP_STORE});
+}
+
+void VulkanRenderGraph::read(RenderGraphPass pass, RenderGraphResource resource, RenderGraphUsage usage,
+                             VkPipelineStageFlags stages) {
+    addAccess(pass, resource, usage, stages, false);
+}
+
+void VulkanRenderGraph::write(RenderGraphPass pass, RenderGraphResource resource, RenderGraphUsage usage,
+                              VkPipelineStageFlags stages) {
+    addAccess(pass, resource, usage, stages, true);
+}
+
+void VulkanRenderGraph::addAccess(RenderGraphPass pass, RenderGraphResource resource, RenderGraphUsage usage,
+                                  VkPipelineStageFlags stages, bool writes) {
+    if (compiled) {
+        throw std::runtime_error("render graph is compiled, reset() it before declaring accesses");
+    }
+
+    UsageInfo info = usageInfo(usage);
+    Resource &target = resources[resource];
+
+    if (writes && info.writeAccess == 0) {
+        throw std::runtime_error("render graph usage is read only, " + target.name + " can not be written with it");
+    }
+
+    Access access = {};
+    access.resource = resource;
+    access.stages = stages != 0 ? stages : info.stages;
+    access.access = writes ? info.writeAccess : info.readAccess;
+    access.layout = target.isBuffer ? VK_IMAGE_LAYOUT_UNDEFINED : info.layout;
+    access.reads = !writes;
+    access.writes = writes;
+
+    target.usage |= info.imageUsage;
+
+    // One pass sees a resource in one layout, repeated accesses are merged.
+    for (auto &existing: passes[pass].accesses) {
+        if (existing.resource != resource) {
+            continue;
+        }
+
+        if (existing.layout != access.layout) {
+            throw std::runtime_error("pass " + passes[pass].name + " uses " + target.name + " in two layouts");
+        }
+
+        existing.stages |= access.stages;
+        existing.access |= access.access;
+        existing.reads |= access.reads;
+        existing.writes |= access.writes;
+        return;
+    }
+
+    passes[pass].accesses.push_back(access);
+}
+
+void VulkanRenderGraph::setSideEffects(RenderGraphPass pass) {
+    passes[pass].sideEffects = true;
+}
+
+void VulkanRenderGraph::bindImage(RenderGraphResource resource, VkImage image, VkImageView imageView) {
+    if (!resources[resource].imported) {
+        throw std::runtime_error("only imported images can be bound, " + resources[resource].name + " is transient");
+    }
+
+    resources[resource].image = image;
+    resources[resource].imageView = imageView;
+}
+
+VkRenderPass VulkanRenderGraph::getRenderPass(RenderGraphPass pass) const {
+    return passes[pass].renderPass;
+}
+
+const VkPipelineRenderingCreateInfoKHR *VulkanRenderGraph::getPipelineRenderingInfo(RenderGraphPass pass) const {
+    if (!device.dynamicRendering || passes[pass].attachments.empty()) {
+        return nullptr;
+    }
+
+    return &passes[pass].renderingInfo;
+}
+
+VkImageView VulkanRenderGraph::getImageView(RenderGraphResource resource) const {
+    return resources[resource].imageView;
+}
+
+VkExtent2D VulkanRenderGraph::getExtent(RenderGraphPass pass) const {
+    return passes[pass].extent;
+}
+
+void VulkanRenderGraph::compile() {
+    if (compiled) {
+        return;
+    }
+
+    cullPasses();
+
+    order.clear();
+    for (RenderGraphPass pass = 0; pass < passes.size(); pass++) {
+        if (!passes[pass].culled) {
+            order.push_back(pass);
+        }
+    }
+
+    allocateTransients();
+    createRenderPasses();
+    buildBarriers();
+
+    compiled = true;
+
+    LOG_INFO("Render graph compiled with %s, %zu passes, %u culled, %u barriers, transients use %llu of %llu bytes",
+             device.dynamicRendering ? "dynamic rendering" : "render passes", order.size(), culledPassCount,
+             barrierCount, (unsigned long long) transientMemorySize, (unsigned long long) unaliasedMemorySize);
+}
+
+void VulkanRenderGraph::cullPasses() {
+    // Walk backwards keeping the set of resources whose current contents someone still needs. Imported ones are
+    // needed after the frame, a pass survives if it writes anything needed.
+    std::vector<bool> needed(resources.size());
+    for (size_t i = 0; i < resources.size(); i++) {
+        needed[i] = resources[i].imported;
+    }
+
+    culledPassCount = 0;
+
+    for (size_t i = passes.size(); i-- > 0;) {
+        Pass &pass = passes[i];
+
+        bool alive = pass.sideEffects;
+        for (const auto &access: pass.accesses) {
+            alive |= access.writes && needed[access.resource];
+        }
+
+        pass.culled = !alive;
+        if (!alive) {
+            culledPassCount++;
+            continue;
+        }
+
+        // Overwritten contents are dead above this pass, unless the pass reads them first.
+        for (const auto &access: pass.accesses) {
+            if (access.writes && !access.reads) {
+                needed[access.resource] = false;
+            }
+        }
+        for (const auto &access: pass.accesses) {
+            if (access.reads) {
+                needed[access.resource] = true;
+            }
+        }
+    }
+}
+
+void VulkanRenderGraph::allocateTransients() {
+    std::vector<RenderGraphResource> transients;
+
+    for (auto &resource: resources) {
+        resource.firstUse = UINT32_MAX;
+        resource.lastUse = 0;
+        resource.allStages = 0;
+        resource.allWrites = 0;
+    }
+
+    for (uint32_t position = 0; position < order.size(); position++) {
+        for (const auto &access: passes[order[position]].accesses) {
+            Resource &resource = resources[access.resource];
+
+            resource.firstUse = std::min(resource.firstUse, position);
+            resource.lastUse = std::max(resource.lastUse, position);
+            resource.allStages |= access.stages;
+            resource.allWrites |= access.access & WRITE_ACCESS;
+        }
+    }
+
+    for (RenderGraphResource i = 0; i < resources.size(); i++) {
+        Resource &resource = resources[i];
+
+        // Images only used by culled passes are never created.
+        if (resource.imported || resource.firstUse == UINT32_MAX) {
+            continue;
+        }
+
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = resource.desc.format;
+        imageInfo.extent = {resource.desc.extent.width, resource.desc.extent.height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = resource.usage;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        VK_CHECK_RESULT(vkCreateImage(device.logicalDevice, &imageInfo, nullptr, &resource.image))
+        vkGetImageMemoryRequirements(device.logicalDevice, resource.image, &resource.memoryRequirements);
+
+        unaliasedMemorySize += resource.memoryRequirements.size;
+        transients.push_back(i);
+    }
+
+    // Largest first, so smaller images fill the blocks the big ones opened.
+    std::stable_sort(transients.begin(), transients.end(), [this](RenderGraphResource a, RenderGraphResource b) {
+        return resources[a].memoryRequirements.size > resources[b].memoryRequirements.size;
+    });
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(device.physicalDevice, &memoryProperties);
+
+    auto deviceLocalTypes = [&memoryProperties](uint32_t typeBits) {
+        uint32_t types = 0;
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+            if ((typeBits & (1u << i)) != 0 &&
+                (memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0) {
+                types |= 1u << i;
+            }
+        }
+        return types;
+    };
+
+    for (RenderGraphResource index: transients) {
+        Resource &resource = resources[index];
+        uint32_t typeBits = deviceLocalTypes(resource.memoryRequirements.memoryTypeBits);
+
+        if (typeBits == 0) {
+            throw std::runtime_error("no device local memory for render graph image " + resource.name);
+        }
+
+        resource.memoryBlock = UINT32_MAX;
+
+        for (uint32_t b = 0; b < memoryBlocks.size() && resource.memoryBlock == UINT32_MAX; b++) {
+            MemoryBlock &block = memoryBlocks[b];
+
+            if ((block.memoryTypeBits & typeBits) == 0) {
+                continue;
+            }
+
+            bool overlaps = false;
+            for (RenderGraphResource occupant: block.occupants) {
+                overlaps |= resources[occupant].firstUse <= resource.lastUse &&
+                            resource.firstUse <= resources[occupant].lastUse;
+            }
+
+            if (!overlaps) {
+                resource.memoryBlock = b;
+            }
+        }
+
+        if (resource.memoryBlock == UINT32_MAX) {
+            memoryBlocks.push_back({VK_NULL_HANDLE, 0, typeBits, {}});
+            resource.memoryBlock = static_cast<uint32_t>(memoryBlocks.size() - 1);
+        }
+
+        // Everything is bound at offset 0, the block just has to be as large as its largest occupant.
+        MemoryBlock &block = memoryBlocks[resource.memoryBlock];
+        block.memoryTypeBits &= typeBits;
+        block.size = std::max(block.size, resource.memoryRequirements.size);
+        block.occupants.push_back(index);
+    }
+
+    for (auto &block: memoryBlocks) {
+        VkMemoryAllocateInfo allocateInfo = {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocateInfo.allocationSize = block.size;
+        allocateInfo.memoryTypeIndex = vtr::findMemoryType(block.memoryTypeBits, device.physicalDevice,
+                                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        block.memory = device.memoryTracker.allocate(MemoryCategory::Image, allocateInfo);
+        transientMemorySize += block.size;
+
+        // Occupants in frame order, buildBarriers() hands each one over from the one before it.
+        std::sort(block.occupants.begin(), block.occupants.end(), [this](RenderGraphResource a, RenderGraphResource b) {
+            return resources[a].firstUse < resources[b].firstUse;
+        });
+
+        for (RenderGraphResource occupant: block.occupants) {
+            Resource &resource = resources[occupant];
+
+            VK_CHECK_RESULT(vkBindImageMemory(device.logicalDevice, resource.image, block.memory, 0))
+
+            VkImageViewCreateInfo viewInfo = {};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = resource.image;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = resource.desc.format;
+            viewInfo.subresourceRange.aspectMask = aspectMask(resource.desc.format);
+            viewInfo.subresourceRange.levelCount = 1;
+            viewInfo.subresourceRange.layerCount = 1;
+
+            VK_CHECK_RESULT(vkCreateImageView(device.logicalDevice, &viewInfo, nullptr, &resource.imageView))
+        }
+    }
+}
+
+void VulkanRenderGraph::createRenderPasses() {
+    for (uint32_t position = 0; position < order.size(); position++) {
+        Pass &pass = passes[order[position]];
+
+        if (pass.attachments.empty()) {
+            continue;
+        }
+
+        std::vector<VkAttachmentDescription> descriptions;
+        std::vector<VkAttachmentReference> colorReferences;
+        VkAttachmentReference depthReference = {};
+        bool hasDepth = false;
+
+        pass.extent = resources[pass.attachments[0].resource].desc.extent;
+        pass.colorFormats.clear();
+        pass.renderingInfo = {};
+        pass.renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+
+        for (auto &attachment: pass.attachments) {
+            const Resource &resource = resources[attachment.resource];
+
+            if (resource.desc.extent.width != pass.extent.width || resource.desc.extent.height != pass.extent.height) {
+                throw std::runtime_error("attachments of pass " + pass.name + " differ in size");
+            }
+
+            // Contents only have to survive the pass if they leave the graph or a later pass reads them.
+            bool readLater = resource.imported;
+            for (uint32_t later = position + 1; later < order.size() && !readLater; later++) {
+                for (const auto &access: passes[order[later]].accesses) {
+                    readLater |= access.resource == attachment.resource && access.reads;
+                }
+            }
+
+            attachment.storeOp = readLater ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+            if (attachment.depth) {
+                pass.renderingInfo.depthAttachmentFormat = resource.desc.format;
+            } else {
+                pass.colorFormats.push_back(resource.desc.format);
+            }
+
+            VkImageLayout layout = attachment.depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+                                                    : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+            // Layouts are transitioned by the graph's barriers, the render pass itself never changes them.
+            VkAttachmentDescription description = {};
+            description.format = resource.desc.format;
+            description.samples = VK_SAMPLE_COUNT_1_BIT;
+            description.loadOp = attachment.loadOp;
+            description.storeOp = attachment.storeOp;
+            description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            description.initialLayout = layout;
+            description.finalLayout = layout;
+
+            VkAttachmentReference reference = {static_cast<uint32_t>(descriptions.size()), layout};
+            descriptions.push_back(description);
+
+            if (attachment.depth) {
+                depthReference = reference;
+                hasDepth = true;
+            } else {
+                colorReferences.push_back(reference);
+            }
+        }
+
+        pass.renderingInfo.colorAttachmentCount = static_cast<uint32_t>(pass.colorFormats.size());
+        pass.renderingInfo.pColorAttachmentFormats = pass.colorFormats.data();
+
+        if (device.dynamicRendering) {
+            continue;
+        }
+
+        VkSubpassDescription subpass = {};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
+        subpass.pColorAttachments = colorReferences.data();
+        subpass.pDepthStencilAttachment = hasDepth ? &depthReference : nullptr;
+
+        VkRenderPassCreateInfo renderPassInfo = {};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(descriptions.size());
+        renderPassInfo.pAttachments = descriptions.data();
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+
+        VK_CHECK_RESULT(vkCreateRenderPass(device.logicalDevice, &renderPassInfo, nullptr, &pass.renderPass))
+    }
+}
+
+void VulkanRenderGraph::buildBarriers() {
+    std::vector<ResourceState> states(resources.size());
+
+    for (RenderGraphResource i = 0; i < resources.size(); i++) {
+        const Resource &resource = resources[i];
+        ResourceState &state = states[i];
+        state = {};
+        state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (resource.imported || resource.firstUse == UINT32_MAX) {
+            continue;
+        }
+
+        // A transient inherits its memory from the previous occupant of its block, or from its own use in the
+        // previous frame when that is the only one. Either way its first use waits for that work to finish.
+        const std::vector<RenderGraphResource> &occupants = memoryBlocks[resource.memoryBlock].occupants;
+        size_t slot = std::find(occupants.begin(), occupants.end(), i) - occupants.begin();
+        const Resource &previous = resources[occupants[(slot + occupants.size() - 1) % occupants.size()]];
+
+        state.writeStages = previous.allStages;
+        state.writeAccess = previous.allWrites;
+    }
+
+    barriers.assign(order.size() + 1, BarrierBatch());
+    barrierCount = 0;
+
+    for (uint32_t position = 0; position < order.size(); position++) {
+        BarrierBatch &batch = barriers[position];
+
+        for (const auto &access: passes[order[position]].accesses) {
+            const Resource &resource = resources[access.resource];
+            ResourceState &state = states[access.resource];
+
+            VkPipelineStageFlags srcStages = 0;
+            VkAccessFlags srcAccess = 0;
+            bool needed = false;
+
+            if (!resource.isBuffer && access.layout != state.layout) {
+                // Transitions read and write the image, they wait on everything before them.
+                srcStages = state.writeStages | state.readStages;
+                srcAccess = state.writeAccess;
+                needed = true;
+            } else if (access.writes) {
+                // Reads before a write only need an execution dependency.
+                srcStages = state.writeStages | state.readStages;
+                srcAccess = state.writeAccess;
+                needed = srcStages != 0;
+            } else if (state.writeStages != 0) {
+                needed = (access.stages & ~state.visibleStages) != 0 || (access.access & ~state.visibleAccess) != 0;
+                srcStages = state.writeStages;
+                srcAccess = state.writeAccess;
+            }
+
+            if (needed) {
+                // First use of an imported image, its producer is synchronized by the caller through a semaphore
+                // waiting at the stages of this access, chaining onto them is enough.
+                if (srcStages == 0) {
+                    srcStages = access.stages;
+                }
+
+                batch.srcStages |= srcStages;
+                batch.dstStages |= access.stages;
+
+                if (resource.isBuffer) {
+                    batch.srcAccess |= srcAccess;
+                    batch.dstAccess |= access.access;
+                } else {
+                    batch.imageBarriers.push_back({access.resource, srcAccess, access.access, state.layout,
+                                                   access.layout});
+                }
+            }
+
+            if (access.writes) {
+                state.writeStages = access.stages;
+                state.writeAccess = access.access & WRITE_ACCESS;
+                state.readStages = 0;
+                state.visibleStages = 0;
+                state.visibleAccess = 0;
+            } else {
+                state.visibleStages |= access.stages;
+                state.visibleAccess |= access.access;
+            }
+
+            if (access.reads) {
+                state.readStages |= access.stages;
+            }
+
+            state.layout = resource.isBuffer ? VK_IMAGE_LAYOUT_UNDEFINED : access.layout;
+        }
+    }
+
+    BarrierBatch &final = barriers.back();
+
+    for (RenderGraphResource i = 0; i < resources.size(); i++) {
+        const Resource &resource = resources[i];
+        const ResourceState &state = states[i];
+
+        if (!resource.imported || resource.isBuffer || resource.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED ||
+            resource.finalLayout == state.layout || resource.firstUse == UINT32_MAX) {
+            continue;
+        }
+
+        VkPipelineStageFlags srcStages = state.writeStages | state.readStages;
+
+        final.srcStages |= srcStages != 0 ? srcStages
+                                          : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+        final.dstStages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        final.imageBarriers.push_back({i, state.writeAccess, 0, state.layout, resource.finalLayout});
+    }
+
+    for (const auto &batch: barriers) {
+        barrierCount += batch.empty() ? 0 : 1;
+    }
+}
+
+void VulkanRenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch &batch) {
+    if (batch.empty()) {
+        return;
+    }
+
+    VkMemoryBarrier memoryBarrier = {};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = batch.srcAccess;
+    memoryBarrier.dstAccessMask = batch.dstAccess;
+
+    uint32_t memoryBarrierCount = batch.srcAccess != 0 || batch.dstAccess != 0 ? 1 : 0;
+
+    std::vector<VkImageMemoryBarrier> imageBarriers(batch.imageBarriers.size());
+
+    for (size_t i = 0; i < batch.imageBarriers.size(); i++) {
+        const ImageBarrier &barrier = batch.imageBarriers[i];
+        const Resource &resource = resources[barrier.resource];
+
+        VkImageMemoryBarrier &imageBarrier = imageBarriers[i];
+        imageBarrier = {};
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageBarrier.srcAccessMask = barrier.srcAccess;
+        imageBarrier.dstAccessMask = barrier.dstAccess;
+        imageBarrier.oldLayout = barrier.oldLayout;
+        imageBarrier.newLayout = barrier.newLayout;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image = resource.image;
+        imageBarrier.subresourceRange.aspectMask = aspectMask(resource.desc.format);
+        imageBarrier.subresourceRange.levelCount = 1;
+        imageBarrier.subresourceRange.layerCount = 1;
+    }
+
+    vkCmdPipelineBarrier(commandBuffer, batch.srcStages, batch.dstStages, 0, memoryBarrierCount, &memoryBarrier, 0,
+                         nullptr, static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+
+void VulkanRenderGraph::beginRendering(VkCommandBuffer commandBuffer, Pass &pass) {
+    std::vector<VkRenderingAttachmentInfoKHR> colorAttachments;
+    VkRenderingAttachmentInfoKHR depthAttachment = {};
+    bool hasDepth = false;
+
+    for (const auto &attachment: pass.attachments) {
+        VkRenderingAttachmentInfoKHR info = {};
+        info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+        info.imageView = resources[attachment.resource].imageView;
+        info.imageLayout = attachment.depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+                                            : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        info.loadOp = attachment.loadOp;
+        info.storeOp = attachment.storeOp;
+        info.clearValue = attachment.clearValue;
+
+        if (attachment.depth) {
+            depthAttachment = info;
+            hasDepth = true;
+        } else {
+            colorAttachments.push_back(info);
+        }
+    }
+
+    VkRenderingInfoKHR renderingInfo = {};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+    renderingInfo.renderArea.offset = {0, 0};
+    renderingInfo.renderArea.extent = pass.extent;
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorAttachments.size());
+    renderingInfo.pColorAttachments = colorAttachments.data();
+    renderingInfo.pDepthAttachment = hasDepth ? &depthAttachment : nullptr;
+
+    device.cmdBeginRendering(commandBuffer, &renderingInfo);
+}
+
+VkFramebuffer VulkanRenderGraph::getFramebuffer(Pass &pass) {
+    std::vector<VkImageView> views;
+    for (const auto &attachment: pass.attachments) {
+        views.push_back(resources[attachment.resource].imageView);
+    }
+
+    auto cached = pass.framebuffers.find(views);
+    if (cached != pass.framebuffers.end()) {
+        return cached->second;
+    }
+
+    VkFramebufferCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    createInfo.renderPass = pass.renderPass;
+    createInfo.attachmentCount = static_cast<uint32_t>(views.size());
+    createInfo.pAttachments = views.data();
+    createInfo.width = pass.extent.width;
+    createInfo.height = pass.extent.height;
+    createInfo.layers = 1;
+
+    VkFramebuffer framebuffer;
+    VK_CHECK_RESULT(vkCreateFramebuffer(device.logicalDevice, &createInfo, nullptr, &framebuffer))
+
+    pass.framebuffers.emplace(views, framebuffer);
+
+    return framebuffer;
+}
+
+void VulkanRenderGraph::execute(VkCommandBuffer commandBuffer) {
+    if (!compiled) {
+        throw std::runtime_error("render graph executed before compile()");
+    }
+
+    for (uint32_t position = 0; position < order.size(); position++) {
+        Pass &pass = passes[order[position]];
+
+        // A pass's zone includes the barrier in front of it, the wait belongs to the pass.
+        uint32_t zone = 0;
+        if (gpuProfiler != nullptr) {
+            if (pass.zoneName == nullptr) {
+                pass.zoneName = vtr::Profiler::instance().intern(pass.name);
+            }
+
+            zone = gpuProfiler->beginZone(commandBuffer, pass.zoneName);
+        }
+
+        recordBarriers(commandBuffer, barriers[position]);
+        recordPass(commandBuffer, pass);
+
+        if (gpuProfiler != nullptr) {
+            gpuProfiler->endZone(commandBuffer, zone);
+        }
+    }
+
+    recordBarriers(commandBuffer, barriers.back());
+}
+
+void VulkanRenderGraph::recordPass(VkCommandBuffer commandBuffer, Pass &pass) {
+    if (pass.attachments.empty()) {
+        pass.callback(commandBuffer);
+        return;
+    }
+
+    if (device.dynamicRendering) {
+        beginRendering(commandBuffer, pass);
+        pass.callback(commandBuffer);
+        device.cmdEndRendering(commandBuffer);
+        return;
+    }
+
+    clearValues.clear();
+    for (const auto &attachment: pass.attachments) {
+        clearValues.push_back(attachment.clearValue);
+    }
+
+    VkRenderPassBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    beginInfo.renderPass = pass.renderPass;
+    beginInfo.framebuffer = getFramebuffer(pass);
+    beginInfo.renderArea.offset = {0, 0};
+    beginInfo.renderArea.extent = pass.extent;
+    beginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    beginInfo.pClearValues = clearValues.data();
+
+    vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    pass.callback(commandBuffer);
+    vkCmdEndRenderPass(commandBuffer);
+}
@@ -0,0 +1,269 @@
+#ifndef VULKAN_TRY_VULKANRENDERGRAPH_H
+#define VULKAN_TRY_VULKANRENDERGRAPH_H
+
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "VulkanDevice.h"
+#include "VulkanGpuProfiler.h"
+
+typedef uint32_t RenderGraphResource;
+typedef uint32_t RenderGraphPass;
+
+enum class RenderGraphUsage {
+    ColorAttachment,
+    DepthAttachment,
+    // Depth attachment bound read only, or sampled as depth.
+    DepthRead,
+    Sampled,
+    Storage,
+    TransferSource,
+    TransferDestination,
+    VertexBuffer,
+    IndexBuffer,
+    IndirectBuffer,
+    UniformBuffer
+};
+
+struct RenderGraphImageDesc {
+    VkFormat format;
+    VkExtent2D extent;
+    // Usage flags beyond the ones implied by how passes use the image.
+    VkImageUsageFlags extraUsage;
+};
+
+/*
+ * Frame graph over the passes of a frame. Passes declare the resources they read and write, compile() then:
+ *
+ *  - culls passes whose writes nobody reads, writes to imported resources and passes with side effects are kept,
+ *  - orders the remaining passes, dependencies follow declaration order: a read sees the last write declared
+ *    before it, so passes run in the order they were added,
+ *  - precomputes one batched pipeline barrier per pass, with layout transitions only where the layout changes
+ *    and no barrier at all between reads,
+ *  - allocates transient images, letting images whose lifetimes do not overlap share memory,
+ *  - drops stores of attachments nobody reads, and creates a render pass per rasterizing pass unless the device
+ *    has dynamic rendering, in which case attachments are bound at record time and nothing depends on the extent.
+ *
+ * The compiled graph is executed every frame until reset(). Imported resources, like the swapchain image, are
+ * rebound before each execute().
+ */
+class VulkanRenderGraph {
+public:
+    typedef std::function<void(VkCommandBuffer commandBuffer)> PassCallback;
+
+    explicit VulkanRenderGraph(VulkanDevice &device);
+
+    VulkanRenderGraph(const VulkanRenderGraph &) = delete;
+
+    VulkanRenderGraph &operator=(const VulkanRenderGraph &) = delete;
+
+    ~VulkanRenderGraph();
+
+    // Drops every pass, resource and Vulkan object, declarations start over.
+    void reset();
+
+    // Contents are undefined at the start of the frame, the image ends up in finalLayout.
+    RenderGraphResource importImage(const std::string &name, VkFormat format, VkExtent2D extent,
+                                    VkImageLayout finalLayout);
+
+    RenderGraphResource importBuffer(const std::string &name);
+
+    // Owned by the graph, lives for one frame only.
+    RenderGraphResource createImage(const std::string &name, const RenderGraphImageDesc &desc);
+
+    RenderGraphPass addPass(const std::string &name, PassCallback callback);
+
+    // Attachments are bound in declaration order, the callback runs inside the render pass.
+    void addColorAttachment(RenderGraphPass pass, RenderGraphResource image, VkAttachmentLoadOp loadOp,
+                            VkClearValue clearValue = {});
+
+    void addDepthAttachment(RenderGraphPass pass, RenderGraphResource image, VkAttachmentLoadOp loadOp,
+                            VkClearValue clearValue = {});
+
+    // stages may be 0 for usages that imply them, shader usages default to the fragment shader.
+    void read(RenderGraphPass pass, RenderGraphResource resource, RenderGraphUsage usage,
+              VkPipelineStageFlags stages = 0);
+
+    void write(RenderGraphPass pass, RenderGraphResource resource, RenderGraphUsage usage,
+               VkPipelineStageFlags stages = 0);
+
+    // Never culled, for passes whose results leave the graph some other way.
+    void setSideEffects(RenderGraphPass pass);
+
+    void compile();
+
+    inline bool isCompiled() const {
+        return compiled;
+    }
+
+    // Imported images only, the handles may change every frame.
+    void bindImage(RenderGraphResource resource, VkImage image, VkImageView imageView);
+
+    void execute(VkCommandBuffer commandBuffer);
+
+    // Every pass executed afterwards is a GPU zone named after it, nullptr stops that.
+    inline void setGpuProfiler(VulkanGpuProfiler *profiler) {
+        gpuProfiler = profiler;
+    }
+
+    // VK_NULL_HANDLE for culled or non rasterizing passes, and with dynamic rendering.
+    VkRenderPass getRenderPass(RenderGraphPass pass) const;
+
+    // Chain into VkGraphicsPipelineCreateInfo::pNext, nullptr when pipelines are created against getRenderPass().
+    const VkPipelineRenderingCreateInfoKHR *getPipelineRenderingInfo(RenderGraphPass pass) const;
+
+    VkImageView getImageView(RenderGraphResource resource) const;
+
+    VkExtent2D getExtent(RenderGraphPass pass) const;
+
+    inline uint32_t getCulledPassCount() const {
+        return culledPassCount;
+    }
+
+    inline uint32_t getBarrierCount() const {
+        return barrierCount;
+    }
+
+    // Memory backing transient images, and what it would take without aliasing.
+    inline VkDeviceSize getTransientMemorySize() const {
+        return transientMemorySize;
+    }
+
+    inline VkDeviceSize getUnaliasedMemorySize() const {
+        return unaliasedMemorySize;
+    }
+
+private:
+    struct Resource {
+        std::string name;
+        bool imported;
+        bool isBuffer;
+        RenderGraphImageDesc desc;
+        VkImageLayout finalLayout;
+        VkImageUsageFlags usage;
+
+        VkImage image;
+        VkImageView imageView;
+
+        // Transient images only, uses are indices into order.
+        uint32_t memoryBlock;
+        VkMemoryRequirements memoryRequirements;
+        uint32_t firstUse;
+        uint32_t lastUse;
+        // Everything the image is used for in a frame, whoever gets its memory next waits on this.
+        VkPipelineStageFlags allStages;
+        VkAccessFlags allWrites;
+    };
+
+    struct Access {
+        RenderGraphResource resource;
+        VkPipelineStageFlags stages;
+        VkAccessFlags access;
+        VkImageLayout layout;
+        bool reads;
+        bool writes;
+    };
+
+    struct Attachment {
+        RenderGraphResource resource;
+        VkAttachmentLoadOp loadOp;
+        VkClearValue clearValue;
+        bool depth;
+        VkAttachmentStoreOp storeOp;
+    };
+
+    struct Pass {
+        std::string name;
+        PassCallback callback;
+        std::vector<Access> accesses;
+        std::vector<Attachment> attachments;
+        bool sideEffects;
+        bool culled;
+        // Interned the first time the pass is profiled.
+        const char *zoneName;
+
+        VkRenderPass renderPass;
+        VkExtent2D extent;
+        std::vector<VkFormat> colorFormats;
+        VkPipelineRenderingCreateInfoKHR renderingInfo;
+        // Keyed by attachment views, imported views change from frame to frame.
+        std::map<std::vector<VkImageView>, VkFramebuffer> framebuffers;
+    };
+
+    // Image handles are resolved at execute() time since imported images are rebound every frame.
+    struct ImageBarrier {
+        RenderGraphResource resource;
+        VkAccessFlags srcAccess;
+        VkAccessFlags dstAccess;
+        VkImageLayout oldLayout;
+        VkImageLayout newLayout;
+    };
+
+    struct BarrierBatch {
+        VkPipelineStageFlags srcStages;
+        VkPipelineStageFlags dstStages;
+        // Buffer hazards, folded into one global memory barrier.
+        VkAccessFlags srcAccess;
+        VkAccessFlags dstAccess;
+        std::vector<ImageBarrier> imageBarriers;
+
+        inline bool empty() const {
+            return srcStages == 0 && dstStages == 0;
+        }
+    };
+
+    struct MemoryBlock {
+        VkDeviceMemory memory;
+        VkDeviceSize size;
+        uint32_t memoryTypeBits;
+        std::vector<RenderGraphResource> occupants;
+    };
+
+    VulkanDevice &device;
+    VulkanGpuProfiler *gpuProfiler = nullptr;
+
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+
+    bool compiled = false;
+
+    // Alive passes in execution order, barriers[i] runs before order[i], the last entry after all of them.
+    std::vector<RenderGraphPass> order;
+    std::vector<BarrierBatch> barriers;
+
+    std::vector<MemoryBlock> memoryBlocks;
+
+    // Scratch for execute(), kept so it does not allocate every frame.
+    std::vector<VkClearValue> clearValues;
+
+    uint32_t culledPassCount = 0;
+    uint32_t barrierCount = 0;
+    VkDeviceSize transientMemorySize = 0;
+    VkDeviceSize unaliasedMemorySize = 0;
+
+    void addAccess(RenderGraphPass pass, RenderGraphResource resource, RenderGraphUsage usage,
+                   VkPipelineStageFlags stages, bool writes);
+
+    void cullPasses();
+
+    void allocateTransients();
+
+    void createRenderPasses();
+
+    void buildBarriers();
+
+    void recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch &batch);
+
+    void recordPass(VkCommandBuffer commandBuffer, Pass &pass);
+
+    void beginRendering(VkCommandBuffer commandBuffer, Pass &pass);
+
+    VkFramebuffer getFramebuffer(Pass &pass);
+
+    void destroyObjects();
+};
+
+
+#endif //VULKAN_TRY_VULKANRENDERGRAPH_H
@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <functional>
+#include "VulkanSamplerCache.h"
+#include "VulkanHelper.h"
+
+namespace {
+    inline void hashCombine(size_t &seed, size_t value) {
+        seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+}
+
+bool SamplerState::operator==(const SamplerState &other) const {
+    return magFilter == other.magFilter && minFilter == other.minFilter && mipmapMode == other.mipmapMode &&
+           addressModeU == other.addressModeU && addressModeV == other.addressModeV &&
+           addressModeW == other.addressModeW && maxAnisotropy == other.maxAnisotropy && minLod == other.minLod &&
+           maxLod == other.maxLod && compareOp == other.compareOp;
+}
+
+size_t SamplerStateHash::operator()(const SamplerState &state) const {
+    size_t seed = 0;
+
+    hashCombine(seed, state.magFilter);
+    hashCombine(seed, state.minFilter);
+    hashCombine(seed, state.mipmapMode);
+    hashCombine(seed, state.addressModeU);
+    hashCombine(seed, state.addressModeV);
+    hashCombine(seed, state.addressModeW);
+    hashCombine(seed, std::hash<float>()(state.maxAnisotropy));
+    hashCombine(seed, std::hash<float>()(state.minLod));
+    hashCombine(seed, std::hash<float>()(state.maxLod));
+    hashCombine(seed, state.compareOp);
+
+    return seed;
+}
+
+VulkanSamplerCache::VulkanSamplerCache(VulkanDevice &device) : device(device) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device.physicalDevice, &properties);
+
+    maxSamplerAnisotropy = properties.limits.maxSamplerAnisotropy;
+}
+
+VulkanSamplerCache::~VulkanSamplerCache() {
+    for (auto &entry: samplers) {
+        vkDestroySampler(device.logicalDevice, entry.second, nullptr);
+    }
+}
+
+VkSampler VulkanSamplerCache::getSampler(const SamplerState &state) {
+    auto found = samplers.find(state);
+    if (found != samplers.end()) {
+        return found->second;
+    }
+
+    float anisotropy = std::min(state.maxAnisotropy, maxSamplerAnisotropy);
+
+    VkSamplerCreateInfo samplerInfo = {};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = state.magFilter;
+    samplerInfo.minFilter = state.minFilter;
+    samplerInfo.mipmapMode = state.mipmapMode;
+    samplerInfo.addressModeU = state.addressModeU;
+    samplerInfo.addressModeV = state.addressModeV;
+    samplerInfo.addressModeW = state.addressModeW;
+    samplerInfo.mipLodBias = 0.0f;
+    samplerInfo.anisotropyEnable = anisotropy > 1.0f ? VK_TRUE : VK_FALSE;
+    samplerInfo.maxAnisotropy = std::max(anisotropy, 1.0f);
+    samplerInfo.compareEnable = state.compareOp != VK_COMPARE_OP_NEVER ? VK_TRUE : VK_FALSE;
+    samplerInfo.compareOp = state.compareOp;
+    samplerInfo.minLod = state.minLod;
+    samplerInfo.maxLod = state.maxLod;
+    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+
+    VkSampler sampler;
+    VK_CHECK_RESULT(vkCreateSampler(device.logicalDevice, &samplerInfo, nullptr, &sampler))
+
+    samplers.emplace(state, sampler);
+
+    return sampler;
+}
@@ -0,0 +1,58 @@
+#ifndef VULKAN_TRY_VULKANSAMPLERCACHE_H
+#define VULKAN_TRY_VULKANSAMPLERCACHE_H
+
+#include <vulkan/vulkan.h>
+#include <unordered_map>
+#include "VulkanDevice.h"
+
+struct SamplerState {
+    VkFilter magFilter = VK_FILTER_LINEAR;
+    VkFilter minFilter = VK_FILTER_LINEAR;
+    VkSamplerMipmapMode mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    VkSamplerAddressMode addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    VkSamplerAddressMode addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    VkSamplerAddressMode addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    // 1 or less turns anisotropic filtering off, larger values are clamped to the device limit.
+    float maxAnisotropy = 1.0f;
+    float minLod = 0.0f;
+    float maxLod = VK_LOD_CLAMP_NONE;
+    // VK_COMPARE_OP_NEVER turns depth comparison off.
+    VkCompareOp compareOp = VK_COMPARE_OP_NEVER;
+
+    bool operator==(const SamplerState &other) const;
+};
+
+struct SamplerStateHash {
+    size_t operator()(const SamplerState &state) const;
+};
+
+/*
+ * Samplers are few and immutable, so every distinct state gets exactly one VkSampler, created on first use and
+ * shared by every texture asking for the same state. Not thread safe, use it from the render thread.
+ */
+class VulkanSamplerCache {
+public:
+    explicit VulkanSamplerCache(VulkanDevice &device);
+
+    VulkanSamplerCache(const VulkanSamplerCache &) = delete;
+
+    VulkanSamplerCache &operator=(const VulkanSamplerCache &) = delete;
+
+    ~VulkanSamplerCache();
+
+    VkSampler getSampler(const SamplerState &state);
+
+    inline size_t size() const {
+        return samplers.size();
+    }
+
+private:
+    VulkanDevice &device;
+
+    float maxSamplerAnisotropy;
+
+    std::unordered_map<SamplerState, VkSampler, SamplerStateHash> samplers;
+};
+
+
+#endif //VULKAN_TRY_VULKANSAMPLERCACHE_H
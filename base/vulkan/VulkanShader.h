@@ -2,41 +2,45 @@
 #define VULKAN_TRY_VULKANSHADER_H
 
 
-#include <vector>
 #include <stdexcept>
-#include <fstream>
 #include <vulkan/vulkan.h>
+#include "../shader/ShaderRegistry.h"
 
-static std::vector<char> readFile(const std::string &filename) {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+static VkShaderModule createShaderModule(const VkDevice &device, const vtr::EmbeddedShader &shader) {
+    VkShaderModuleCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = shader.size;
+    createInfo.pCode = shader.code;
 
-    if (!file.is_open()) {
-        throw std::runtime_error("failed to open file!");
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+        throw std::runtime_error(std::string("failed to create shader module ") + shader.name);
     }
 
-    size_t fileSize = (size_t) file.tellg();
-    std::vector<char> buffer(fileSize);
+    return shaderModule;
+}
 
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
+// Compute pipelines do not go through VulkanPipelineCache, they are few and built once.
+static VkPipeline createComputePipeline(const VkDevice &device, VkPipelineLayout layout, const char *shaderName) {
+    VkShaderModule shaderModule = createShaderModule(device, vtr::getShader(shaderName));
 
-    file.close();
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = layout;
 
-    return buffer;
-}
+    VkPipeline pipeline;
+    VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+    vkDestroyShaderModule(device, shaderModule, nullptr);
 
-static VkShaderModule createShaderModule(const VkDevice &device, const std::vector<char> &code) {
-    VkShaderModuleCreateInfo createInfo = {};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
-
-    VkShaderModule shaderModule;
-    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create shader module!");
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error(std::string("failed to create compute pipeline ") + shaderName);
     }
 
-    return shaderModule;
+    return pipeline;
 }
 
 #endif //VULKAN_TRY_VULKANSHADER_H
@@ -0,0 +1,149 @@
+#include <stdexcept>
+#include "VulkanSubmitScheduler.h"
+#include "VulkanHelper.h"
+
+void VulkanSubmitScheduler::enqueue(VkQueue queue, SubmitWork work) {
+    for (auto &queueWork: queues) {
+        if (queueWork.queue == queue) {
+            queueWork.work.push_back(std::move(work));
+            return;
+        }
+    }
+
+    queues.push_back({queue, {}, {}, 0});
+    queues.back().work.push_back(std::move(work));
+}
+
+void VulkanSubmitScheduler::flush() {
+    // Merge every queue's work into calls first, so waits can be matched against signals of any queue.
+    uint32_t batchCount = 0;
+    size_t remaining = 0;
+
+    for (auto &queueWork: queues) {
+        queueWork.calls.clear();
+        queueWork.nextCall = 0;
+
+        uint32_t callBegin = batchCount;
+
+        for (auto &work: queueWork.work) {
+            Batch *batch = batchCount > callBegin ? &batches[batchCount - 1] : nullptr;
+
+            // Waits go before every command buffer of their batch, signals after every one.
+            bool split = batch == nullptr || !batch->signalSemaphores.empty() ||
+                         (!work.waitSemaphores.empty() && !batch->commandBuffers.empty());
+
+            if (split) {
+                if (batchCount == batches.size()) {
+                    batches.emplace_back();
+                }
+
+                batch = &batches[batchCount++];
+                batch->commandBuffers.clear();
+                batch->waitSemaphores.clear();
+                batch->waitStages.clear();
+                batch->signalSemaphores.clear();
+            }
+
+            batch->commandBuffers.insert(batch->commandBuffers.end(), work.commandBuffers.begin(),
+                                         work.commandBuffers.end());
+            batch->waitSemaphores.insert(batch->waitSemaphores.end(), work.waitSemaphores.begin(),
+                                         work.waitSemaphores.end());
+            batch->waitStages.insert(batch->waitStages.end(), work.waitStages.begin(), work.waitStages.end());
+            batch->signalSemaphores.insert(batch->signalSemaphores.end(), work.signalSemaphores.begin(),
+                                           work.signalSemaphores.end());
+
+            if (work.fence != VK_NULL_HANDLE) {
+                queueWork.calls.push_back({callBegin, batchCount - callBegin, work.fence});
+                callBegin = batchCount;
+            }
+        }
+
+        if (batchCount > callBegin) {
+            queueWork.calls.push_back({callBegin, batchCount - callBegin, VK_NULL_HANDLE});
+        }
+
+        queueWork.work.clear();
+        remaining += queueWork.calls.size();
+    }
+
+    // Each queue submits until it reaches a call waiting on another queue, then the next queue gets its turn.
+    while (remaining > 0) {
+        bool progress = false;
+
+        for (auto &queueWork: queues) {
+            while (queueWork.nextCall < queueWork.calls.size() &&
+                   canSubmit(queueWork, queueWork.calls[queueWork.nextCall])) {
+                submit(queueWork.queue, queueWork.calls[queueWork.nextCall]);
+                queueWork.nextCall++;
+                remaining--;
+                progress = true;
+            }
+        }
+
+        if (!progress) {
+            throw std::runtime_error("Submitted work waits on semaphores in a cycle");
+        }
+    }
+
+    stats.flushes++;
+}
+
+bool VulkanSubmitScheduler::isSignaledLater(const QueueWork &waiting, VkSemaphore semaphore) const {
+    for (const auto &queueWork: queues) {
+        if (&queueWork == &waiting) {
+            continue;
+        }
+
+        for (size_t i = queueWork.nextCall; i < queueWork.calls.size(); i++) {
+            const Call &call = queueWork.calls[i];
+
+            for (uint32_t j = call.firstBatch; j < call.firstBatch + call.batchCount; j++) {
+                for (VkSemaphore signal: batches[j].signalSemaphores) {
+                    if (signal == semaphore) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+bool VulkanSubmitScheduler::canSubmit(const QueueWork &queueWork, const Call &call) const {
+    for (uint32_t i = call.firstBatch; i < call.firstBatch + call.batchCount; i++) {
+        for (VkSemaphore semaphore: batches[i].waitSemaphores) {
+            if (isSignaledLater(queueWork, semaphore)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void VulkanSubmitScheduler::submit(VkQueue queue, const Call &call) {
+    submitInfos.resize(call.batchCount);
+
+    for (uint32_t i = 0; i < call.batchCount; i++) {
+        const Batch &batch = batches[call.firstBatch + i];
+
+        VkSubmitInfo &submitInfo = submitInfos[i];
+        submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.waitSemaphoreCount = static_cast<uint32_t>(batch.waitSemaphores.size());
+        submitInfo.pWaitSemaphores = batch.waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = batch.waitStages.data();
+        submitInfo.commandBufferCount = static_cast<uint32_t>(batch.commandBuffers.size());
+        submitInfo.pCommandBuffers = batch.commandBuffers.data();
+        submitInfo.signalSemaphoreCount = static_cast<uint32_t>(batch.signalSemaphores.size());
+        submitInfo.pSignalSemaphores = batch.signalSemaphores.data();
+
+        stats.commandBuffers += batch.commandBuffers.size();
+    }
+
+    VK_CHECK_RESULT(vkQueueSubmit(queue, call.batchCount, submitInfos.data(), call.fence))
+
+    stats.submits++;
+    stats.batches += call.batchCount;
+}
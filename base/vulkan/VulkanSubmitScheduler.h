@@ -0,0 +1,89 @@
+#ifndef VULKAN_TRY_VULKANSUBMITSCHEDULER_H
+#define VULKAN_TRY_VULKANSUBMITSCHEDULER_H
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+// Command buffers submitted together, with what they wait for and what they signal once done.
+struct SubmitWork {
+    std::vector<VkCommandBuffer> commandBuffers;
+    std::vector<VkSemaphore> waitSemaphores;
+    // One per wait semaphore.
+    std::vector<VkPipelineStageFlags> waitStages;
+    std::vector<VkSemaphore> signalSemaphores;
+    VkFence fence = VK_NULL_HANDLE;
+};
+
+struct SubmitStats {
+    uint64_t flushes;
+    // vkQueueSubmit calls, VkSubmitInfo batches and command buffers they carried.
+    uint64_t submits;
+    uint64_t batches;
+    uint64_t commandBuffers;
+};
+
+/*
+ * Collects the work of every subsystem for a frame and submits it per queue with as few vkQueueSubmit calls and
+ * batches as ordering allows. Work stays in enqueue order on its queue. Consecutive work shares a batch unless that
+ * would move a wait in front of earlier command buffers or hold back a signal until later ones. A call ends at
+ * every fence, since a call has only one.
+ *
+ * Calls are made per queue in order, but across queues a call waiting on a semaphore goes after the call of another
+ * queue that signals it, whichever was enqueued first. Semaphores nothing in the flush signals, like the swapchain's,
+ * are taken as already signaled. Fences only signal once flush() has run. Render thread only.
+ */
+class VulkanSubmitScheduler {
+public:
+    void enqueue(VkQueue queue, SubmitWork work);
+
+    // Once per frame, after the frame's work is enqueued. Throws like VK_CHECK_RESULT when a submit fails, and
+    // when queues wait on each other in a cycle.
+    void flush();
+
+    // Summed over every flush.
+    inline const SubmitStats &getStats() const {
+        return stats;
+    }
+
+private:
+    // One vkQueueSubmit, a range of batches.
+    struct Call {
+        uint32_t firstBatch;
+        uint32_t batchCount;
+        VkFence fence;
+    };
+
+    struct QueueWork {
+        VkQueue queue;
+        std::vector<SubmitWork> work;
+        std::vector<Call> calls;
+        // First call not submitted yet.
+        size_t nextCall;
+    };
+
+    // Merged work, the VkSubmitInfo is filled once every batch of a call is final.
+    struct Batch {
+        std::vector<VkCommandBuffer> commandBuffers;
+        std::vector<VkSemaphore> waitSemaphores;
+        std::vector<VkPipelineStageFlags> waitStages;
+        std::vector<VkSemaphore> signalSemaphores;
+    };
+
+    // Kept between frames so their vectors keep their capacity.
+    std::vector<QueueWork> queues;
+    std::vector<Batch> batches;
+    std::vector<VkSubmitInfo> submitInfos;
+
+    SubmitStats stats = {};
+
+    // Whether a call of another queue not submitted yet signals semaphore.
+    bool isSignaledLater(const QueueWork &waiting, VkSemaphore semaphore) const;
+
+    bool canSubmit(const QueueWork &queueWork, const Call &call) const;
+
+    void submit(VkQueue queue, const Call &call);
+};
+
+
+#endif //VULKAN_TRY_VULKANSUBMITSCHEDULER_H
@@ -35,6 +35,11 @@ void VulkanSwapChain::createSwapChain() {
     createInfo.imageArrayLayers = 1;
     createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
+    transferSource = (swapChainSupportDetails.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) != 0;
+    if (transferSource) {
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+
     QueueFamilyIndices &queueFamilyIndices = vulkanDevice->queueFamilyIndices;
 
     if (queueFamilyIndices.graphicsFamily.value() != queueFamilyIndices.presentFamily.value()) {
@@ -81,6 +86,14 @@ VkSurfaceFormatKHR VulkanSwapChain::chooseSwapSurfaceFormat(const std::vector<Vk
 }
 
 VkPresentModeKHR VulkanSwapChain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR> &presentModes) {
+    if (!vsync) {
+        for (const auto &presentMode: presentModes) {
+            if (presentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
+                return presentMode;
+            }
+        }
+    }
+
     for (const auto &presentMode: presentModes) {
         if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
             return presentMode;
@@ -6,6 +6,8 @@
 
 class VulkanSwapChain {
 public:
+    std::vector<VkImage> images;
+
     std::vector<VkImageView> imageViews;
 
     VkSwapchainKHR swapChain;
@@ -14,6 +16,12 @@ public:
 
     uint32_t imageCount;
 
+    // Images can be copied from, for readback. Not every surface allows it.
+    bool transferSource = false;
+
+    // Without vsync presents never wait for the display, set before initSwapChain().
+    bool vsync = true;
+
     VulkanSwapChain() = default;
 
     void initSwapChain(VulkanDevice *device, const VkSurfaceKHR& surface, const VkExtent2D& extent);
@@ -25,8 +33,6 @@ private:
 
     VkSurfaceKHR surface;
 
-    std::vector<VkImage> images;
-
     VkExtent2D windowExtent;
 
     void createSwapChain();
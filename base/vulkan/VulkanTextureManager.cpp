@@ -0,0 +1,605 @@
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+#include "VulkanTextureManager.h"
+#include "VulkanHelper.h"
+#include "../log/Logger.h"
+
+namespace {
+    // Preference order, desktop GPUs sample BC, mobile ones ASTC or ETC2.
+    const char *const variantSuffixes[] = {".bc.ktx2", ".astc.ktx2", ".etc2.ktx2", ".ktx2"};
+
+    const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                              VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+}
+
+const VulkanTextureManager::FormatInfo VulkanTextureManager::formatTable[] = {
+        {VK_FORMAT_R8G8B8A8_UNORM,              FormatFamily::Uncompressed, 1, 1, 4},
+        {VK_FORMAT_R8G8B8A8_SRGB,               FormatFamily::Uncompressed, 1, 1, 4},
+        {VK_FORMAT_B8G8R8A8_UNORM,              FormatFamily::Uncompressed, 1, 1, 4},
+        {VK_FORMAT_B8G8R8A8_SRGB,               FormatFamily::Uncompressed, 1, 1, 4},
+        {VK_FORMAT_BC1_RGBA_UNORM_BLOCK,        FormatFamily::BC,           4, 4, 8},
+        {VK_FORMAT_BC1_RGBA_SRGB_BLOCK,         FormatFamily::BC,           4, 4, 8},
+        {VK_FORMAT_BC3_UNORM_BLOCK,             FormatFamily::BC,           4, 4, 16},
+        {VK_FORMAT_BC3_SRGB_BLOCK,              FormatFamily::BC,           4, 4, 16},
+        {VK_FORMAT_BC4_UNORM_BLOCK,             FormatFamily::BC,           4, 4, 8},
+        {VK_FORMAT_BC5_UNORM_BLOCK,             FormatFamily::BC,           4, 4, 16},
+        {VK_FORMAT_BC7_UNORM_BLOCK,             FormatFamily::BC,           4, 4, 16},
+        {VK_FORMAT_BC7_SRGB_BLOCK,              FormatFamily::BC,           4, 4, 16},
+        {VK_FORMAT_ASTC_4x4_UNORM_BLOCK,        FormatFamily::ASTC,         4, 4, 16},
+        {VK_FORMAT_ASTC_4x4_SRGB_BLOCK,         FormatFamily::ASTC,         4, 4, 16},
+        {VK_FORMAT_ASTC_6x6_UNORM_BLOCK,        FormatFamily::ASTC,         6, 6, 16},
+        {VK_FORMAT_ASTC_6x6_SRGB_BLOCK,         FormatFamily::ASTC,         6, 6, 16},
+        {VK_FORMAT_ASTC_8x8_UNORM_BLOCK,        FormatFamily::ASTC,         8, 8, 16},
+        {VK_FORMAT_ASTC_8x8_SRGB_BLOCK,         FormatFamily::ASTC,         8, 8, 16},
+        {VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK,     FormatFamily::ETC2,         4, 4, 8},
+        {VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK,      FormatFamily::ETC2,         4, 4, 8},
+        {VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK,   FormatFamily::ETC2,         4, 4, 16},
+        {VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK,    FormatFamily::ETC2,         4, 4, 16},
+};
+
+VulkanTextureManager::VulkanTextureManager(VulkanDevice &device, vtr::JobSystem &jobSystem,
+                                           VkDeviceSize uploadBudget)
+        : device(device), jobSystem(jobSystem), uploadBudget(uploadBudget) {
+    // Compressed families also need their device feature, which VulkanDevice enables whenever it exists.
+    for (const FormatInfo &info: formatTable) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(device.physicalDevice, info.format, &properties);
+
+        bool enabled = info.family == FormatFamily::Uncompressed ||
+                       (info.family == FormatFamily::BC && device.enabledFeatures.textureCompressionBC) ||
+                       (info.family == FormatFamily::ASTC && device.enabledFeatures.textureCompressionASTC_LDR) ||
+                       (info.family == FormatFamily::ETC2 && device.enabledFeatures.textureCompressionETC2);
+
+        bool sampled = (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+
+        formatFeatures.push_back(enabled && sampled ? properties.optimalTilingFeatures : 0);
+    }
+
+    VkCommandPoolCreateInfo poolCreateInfo = {};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolCreateInfo.queueFamilyIndex = device.queueFamilyIndices.graphicsFamily.value();
+    poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    VK_CHECK_RESULT(vkCreateCommandPool(device.logicalDevice, &poolCreateInfo, nullptr, &commandPool))
+
+    for (auto &slot: slots) {
+        vtr::createBuffer(device.logicalDevice, device.physicalDevice, device.memoryTracker, MemoryCategory::Staging,
+                          uploadBudget, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, slot.buffer,
+                          slot.memory);
+
+        void *mapping;
+        VK_CHECK_RESULT(vkMapMemory(device.logicalDevice, slot.memory, 0, uploadBudget, 0, &mapping))
+        slot.mapping = static_cast<uint8_t *>(mapping);
+
+        VkCommandBufferAllocateInfo allocateInfo = {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandPool = commandPool;
+        allocateInfo.commandBufferCount = 1;
+
+        VK_CHECK_RESULT(vkAllocateCommandBuffers(device.logicalDevice, &allocateInfo, &slot.commandBuffer))
+
+        VkFenceCreateInfo fenceCreateInfo = {};
+        fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        VK_CHECK_RESULT(vkCreateFence(device.logicalDevice, &fenceCreateInfo, nullptr, &slot.fence))
+
+        slot.submitted = false;
+    }
+}
+
+VulkanTextureManager::~VulkanTextureManager() {
+    // Loads still running write to loaded, let them finish first.
+    jobSystem.wait(&loadCounter);
+
+    for (auto &slot: slots) {
+        if (slot.submitted) {
+            vkWaitForFences(device.logicalDevice, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+        }
+
+        vkDestroyFence(device.logicalDevice, slot.fence, nullptr);
+        vkDestroyBuffer(device.logicalDevice, slot.buffer, nullptr);
+        device.memoryTracker.free(slot.memory);
+    }
+
+    vkDestroyCommandPool(device.logicalDevice, commandPool, nullptr);
+
+    for (auto &retired: retiredViews) {
+        vkDestroyImageView(device.logicalDevice, retired.view, nullptr);
+    }
+
+    for (auto &record: textures) {
+        if (record.state == TextureState::Uploading || record.state == TextureState::Resident) {
+            if (record.texture.view != VK_NULL_HANDLE) {
+                vkDestroyImageView(device.logicalDevice, record.texture.view, nullptr);
+            }
+
+            vkDestroyImage(device.logicalDevice, record.texture.image, nullptr);
+            device.memoryTracker.free(record.texture.memory);
+        }
+    }
+}
+
+bool VulkanTextureManager::hasVariant(const std::string &basePath) {
+    for (const char *suffix: variantSuffixes) {
+        if (access((basePath + suffix).c_str(), R_OK) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+TextureHandle VulkanTextureManager::requestTexture(const std::string &basePath) {
+    auto handle = static_cast<TextureHandle>(textures.size());
+
+    TextureRecord record = {};
+    record.path = basePath;
+    record.state = TextureState::Loading;
+    record.requestTime = std::chrono::steady_clock::now();
+    textures.push_back(record);
+
+    jobSystem.run([this, handle, basePath]() { loadTexture(handle, basePath); }, &loadCounter);
+
+    return handle;
+}
+
+const VulkanTextureManager::FormatInfo *VulkanTextureManager::findFormat(VkFormat format) const {
+    for (const FormatInfo &info: formatTable) {
+        if (info.format == format) {
+            return &info;
+        }
+    }
+
+    return nullptr;
+}
+
+VkDeviceSize VulkanTextureManager::levelSize(const FormatInfo &info, VkExtent2D extent, uint32_t level) {
+    uint32_t width = std::max(extent.width >> level, 1u);
+    uint32_t height = std::max(extent.height >> level, 1u);
+
+    VkDeviceSize blocksX = (width + info.blockWidth - 1) / info.blockWidth;
+    VkDeviceSize blocksY = (height + info.blockHeight - 1) / info.blockHeight;
+
+    return blocksX * blocksY * info.blockBytes;
+}
+
+void VulkanTextureManager::loadTexture(TextureHandle handle, const std::string &basePath) {
+    LoadedTexture result = {handle, std::string(), nullptr, nullptr};
+
+    for (const char *suffix: variantSuffixes) {
+        std::string path = basePath + suffix;
+
+        if (access(path.c_str(), R_OK) != 0) {
+            continue;
+        }
+
+        try {
+            std::unique_ptr<vtr::Ktx2File> file(new vtr::Ktx2File(path));
+            const vtr::Ktx2Header &header = file->getHeader();
+
+            const FormatInfo *info = findFormat(static_cast<VkFormat>(header.vkFormat));
+            if (info == nullptr || formatFeatures[info - formatTable] == 0) {
+                LOG_VERBOSE("Skipping %s, the device cannot sample format %u", path.c_str(), header.vkFormat);
+                continue;
+            }
+
+            VkExtent2D extent = {header.pixelWidth, header.pixelHeight};
+
+            for (uint32_t i = 0; i < file->getLevelCount(); i++) {
+                if (file->getLevel(i).byteLength != levelSize(*info, extent, i)) {
+                    throw std::runtime_error("level " + std::to_string(i) + " does not match its format");
+                }
+
+                // Fault the level in here so the render thread only ever copies resident pages.
+                const auto *data = reinterpret_cast<const volatile uint8_t *>(file->getLevelData(i));
+                for (uint64_t offset = 0; offset < file->getLevel(i).byteLength; offset += 4096) {
+                    (void) data[offset];
+                }
+            }
+
+            result.path = path;
+            result.file = std::move(file);
+            result.formatInfo = info;
+            break;
+        } catch (const std::exception &exception) {
+            LOG_ERROR("Failed to stream %s: %s", path.c_str(), exception.what());
+        }
+    }
+
+    if (!result.file) {
+        LOG_ERROR("No usable variant of texture %s", basePath.c_str());
+    }
+
+    std::lock_guard<std::mutex> lock(loadedMutex);
+    loaded.push_back(std::move(result));
+}
+
+void VulkanTextureManager::update() {
+    updateCount++;
+
+    // Every frame recorded before the view was retired has signaled its fence by now.
+    while (!retiredViews.empty() && updateCount - retiredViews.front().retiredAt >= MAX_FRAMES_IN_FLIGHT) {
+        vkDestroyImageView(device.logicalDevice, retiredViews.front().view, nullptr);
+        retiredViews.pop_front();
+    }
+
+    retireUploads();
+    beginUploads();
+
+    if (pendingTextures.empty()) {
+        return;
+    }
+
+    for (auto &slot: slots) {
+        if (!slot.submitted) {
+            submitUpload(slot);
+            return;
+        }
+    }
+}
+
+const StreamedTexture *VulkanTextureManager::getTexture(TextureHandle handle) const {
+    if (handle >= textures.size()) {
+        return nullptr;
+    }
+
+    const TextureRecord &record = textures[handle];
+    if (record.state != TextureState::Uploading && record.state != TextureState::Resident) {
+        return nullptr;
+    }
+
+    return record.texture.residentLevel < record.texture.levelCount ? &record.texture : nullptr;
+}
+
+void VulkanTextureManager::retireUploads() {
+    for (auto &slot: slots) {
+        if (!slot.submitted || vkGetFenceStatus(device.logicalDevice, slot.fence) != VK_SUCCESS) {
+            continue;
+        }
+
+        VK_CHECK_RESULT(vkResetFences(device.logicalDevice, 1, &slot.fence))
+        slot.submitted = false;
+
+        for (auto &landed: slot.landing) {
+            TextureRecord &record = textures[landed.handle];
+            record.texture.residentLevel = std::min(record.texture.residentLevel, landed.level);
+        }
+
+        // One new view per texture, however many of its levels landed together.
+        for (auto &landed: slot.landing) {
+            TextureRecord &record = textures[landed.handle];
+            if (landed.level != record.texture.residentLevel) {
+                continue;
+            }
+
+            createView(record.texture);
+
+            if (record.texture.residentLevel == 0) {
+                record.state = TextureState::Resident;
+
+                std::chrono::duration<double, std::milli> elapsed =
+                        std::chrono::steady_clock::now() - record.requestTime;
+                LOG_INFO("Streamed %s in %.1f ms", record.path.c_str(), elapsed.count());
+            }
+        }
+
+        slot.landing.clear();
+    }
+}
+
+void VulkanTextureManager::beginUploads() {
+    std::vector<LoadedTexture> ready;
+    {
+        std::lock_guard<std::mutex> lock(loadedMutex);
+        ready.swap(loaded);
+    }
+
+    for (auto &loadedTexture: ready) {
+        TextureRecord &record = textures[loadedTexture.handle];
+
+        if (!loadedTexture.file) {
+            record.state = TextureState::Failed;
+            continue;
+        }
+
+        const vtr::Ktx2Header &header = loadedTexture.file->getHeader();
+        const FormatInfo &info = *loadedTexture.formatInfo;
+        StreamedTexture &texture = record.texture;
+
+        texture.format = info.format;
+        texture.extent = {header.pixelWidth, header.pixelHeight};
+        texture.levelCount = loadedTexture.file->getLevelCount();
+        texture.view = VK_NULL_HANDLE;
+
+        // Levels are copied one block row at a time at least.
+        VkDeviceSize rowBytes = VkDeviceSize((texture.extent.width + info.blockWidth - 1) / info.blockWidth) *
+                                info.blockBytes;
+        if (rowBytes > uploadBudget) {
+            LOG_ERROR("Texture %s is too wide for the upload budget", loadedTexture.path.c_str());
+            record.state = TextureState::Failed;
+            continue;
+        }
+
+        uint32_t fullChain = 1;
+        for (uint32_t largest = std::max(texture.extent.width, texture.extent.height); largest > 1; largest >>= 1) {
+            fullChain++;
+        }
+
+        bool generateMips = info.family == FormatFamily::Uncompressed && texture.levelCount == 1 && fullChain > 1;
+        if (generateMips && (formatFeatures[&info - formatTable] & blitFeatures) != blitFeatures) {
+            LOG_WARNING("Format of %s cannot be blitted, it is sampled without mips", loadedTexture.path.c_str());
+            generateMips = false;
+        }
+
+        if (generateMips) {
+            texture.levelCount = fullChain;
+        }
+
+        // Over the soft budget the largest stored levels are left out and the texture streams in at a lower
+        // resolution, rather than failing an allocation later on.
+        uint32_t fileLevels = loadedTexture.file->getLevelCount();
+        VkExtent2D fileExtent = texture.extent;
+        uint32_t skippedLevels = 0;
+        VkMemoryAllocateInfo allocateInfo = {};
+
+        while (true) {
+            createImage(texture, generateMips);
+
+            VkMemoryRequirements requirements;
+            vkGetImageMemoryRequirements(device.logicalDevice, texture.image, &requirements);
+
+            allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocateInfo.allocationSize = requirements.size;
+            allocateInfo.memoryTypeIndex = vtr::findMemoryType(requirements.memoryTypeBits, device.physicalDevice,
+                                                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+            if (skippedLevels + 1 >= fileLevels ||
+                device.memoryTracker.fits(allocateInfo.memoryTypeIndex, requirements.size)) {
+                break;
+            }
+
+            vkDestroyImage(device.logicalDevice, texture.image, nullptr);
+
+            skippedLevels++;
+            texture.extent = {std::max(fileExtent.width >> skippedLevels, 1u),
+                              std::max(fileExtent.height >> skippedLevels, 1u)};
+            texture.levelCount = fileLevels - skippedLevels;
+        }
+
+        if (skippedLevels > 0) {
+            LOG_WARNING("Streaming %s without its %u largest mips, device memory is over the soft budget",
+                        loadedTexture.path.c_str(), skippedLevels);
+        }
+
+        texture.residentLevel = texture.levelCount;
+        texture.memory = device.memoryTracker.allocate(MemoryCategory::Image, allocateInfo);
+
+        VK_CHECK_RESULT(vkBindImageMemory(device.logicalDevice, texture.image, texture.memory, 0))
+
+        PendingTexture pending;
+        pending.handle = loadedTexture.handle;
+        pending.formatInfo = &info;
+        pending.nextLevel = fileLevels - skippedLevels - 1;
+        pending.skippedLevels = skippedLevels;
+        pending.rowsCopied = 0;
+        pending.generateMips = generateMips;
+        pending.file = std::move(loadedTexture.file);
+
+        for (uint32_t i = 0; i <= pending.nextLevel; i++) {
+            pendingBytes += levelSize(info, texture.extent, i);
+        }
+
+        record.path = loadedTexture.path;
+        record.state = TextureState::Uploading;
+        pendingTextures.push_back(std::move(pending));
+    }
+}
+
+size_t VulkanTextureManager::nextPending() const {
+    size_t best = 0;
+    VkDeviceSize bestSize = UINT64_MAX;
+
+    // Finish a level that is halfway in first, otherwise the smallest missing level of any texture goes next.
+    for (size_t i = 0; i < pendingTextures.size(); i++) {
+        const PendingTexture &pending = pendingTextures[i];
+
+        if (pending.rowsCopied > 0) {
+            return i;
+        }
+
+        VkDeviceSize size = levelSize(*pending.formatInfo, textures[pending.handle].texture.extent, pending.nextLevel);
+        if (size < bestSize) {
+            best = i;
+            bestSize = size;
+        }
+    }
+
+    return best;
+}
+
+void VulkanTextureManager::submitUpload(StagingSlot &slot) {
+    VK_CHECK_RESULT(vkResetCommandBuffer(slot.commandBuffer, 0))
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    VK_CHECK_RESULT(vkBeginCommandBuffer(slot.commandBuffer, &beginInfo))
+
+    VkDeviceSize stagingOffset = 0;
+
+    while (!pendingTextures.empty() && stagingOffset < uploadBudget) {
+        size_t index = nextPending();
+        PendingTexture &pending = pendingTextures[index];
+        const FormatInfo &info = *pending.formatInfo;
+        const StreamedTexture &texture = textures[pending.handle].texture;
+        uint32_t level = pending.nextLevel;
+
+        uint32_t width = std::max(texture.extent.width >> level, 1u);
+        uint32_t height = std::max(texture.extent.height >> level, 1u);
+        uint32_t blockRows = (height + info.blockHeight - 1) / info.blockHeight;
+        VkDeviceSize rowBytes = VkDeviceSize((width + info.blockWidth - 1) / info.blockWidth) * info.blockBytes;
+
+        auto rows = static_cast<uint32_t>(std::min<VkDeviceSize>(blockRows - pending.rowsCopied,
+                                                                 (uploadBudget - stagingOffset) / rowBytes));
+        if (rows == 0) {
+            break;
+        }
+
+        if (pending.rowsCopied == 0) {
+            // Smaller levels may already be sampled, only this one is discarded.
+            transitionLevels(slot.commandBuffer, texture.image, level, 1, VK_IMAGE_LAYOUT_UNDEFINED,
+                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        }
+
+        VkDeviceSize chunk = rows * rowBytes;
+        const uint8_t *source = pending.file->getLevelData(level + pending.skippedLevels);
+        memcpy(slot.mapping + stagingOffset, source + pending.rowsCopied * rowBytes, (size_t) chunk);
+
+        uint32_t firstRow = pending.rowsCopied * info.blockHeight;
+
+        VkBufferImageCopy region = {};
+        region.bufferOffset = stagingOffset;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = level;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {0, static_cast<int32_t>(firstRow), 0};
+        region.imageExtent = {width, std::min(rows * info.blockHeight, height - firstRow), 1};
+
+        vkCmdCopyBufferToImage(slot.commandBuffer, slot.buffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               1, &region);
+
+        // Chunks start 16 byte aligned in staging memory, which is a whole number of blocks for every format.
+        stagingOffset += (chunk + 15) & ~VkDeviceSize(15);
+        pending.rowsCopied += rows;
+        pendingBytes -= chunk;
+
+        if (pending.rowsCopied < blockRows) {
+            continue;
+        }
+
+        if (pending.generateMips) {
+            generateMipChain(slot.commandBuffer, texture);
+        } else {
+            transitionLevels(slot.commandBuffer, texture.image, level, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+                             VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        }
+
+        slot.landing.push_back({pending.handle, level});
+
+        if (level == 0) {
+            // Everything is in staging memory, the file is not needed anymore.
+            pendingTextures.erase(pendingTextures.begin() + static_cast<std::ptrdiff_t>(index));
+        } else {
+            pending.nextLevel--;
+            pending.rowsCopied = 0;
+        }
+    }
+
+    VK_CHECK_RESULT(vkEndCommandBuffer(slot.commandBuffer))
+
+    // Same queue as drawing and enqueued ahead of the frame, submission order makes the levels visible to it.
+    device.submitScheduler.enqueue(device.graphicsQueue, {{slot.commandBuffer}, {}, {}, {}, slot.fence});
+    slot.submitted = true;
+}
+
+void VulkanTextureManager::transitionLevels(VkCommandBuffer commandBuffer, VkImage image, uint32_t baseLevel,
+                                            uint32_t levelCount, VkImageLayout oldLayout, VkImageLayout newLayout,
+                                            VkAccessFlags srcAccess, VkAccessFlags dstAccess,
+                                            VkPipelineStageFlags srcStages, VkPipelineStageFlags dstStages) {
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = baseLevel;
+    barrier.subresourceRange.levelCount = levelCount;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void VulkanTextureManager::generateMipChain(VkCommandBuffer commandBuffer, const StreamedTexture &texture) {
+    transitionLevels(commandBuffer, texture.image, 1, texture.levelCount - 1, VK_IMAGE_LAYOUT_UNDEFINED,
+                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+                     VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    // Each level is blitted from the one above it, which is then done and handed to the shaders.
+    for (uint32_t level = 1; level < texture.levelCount; level++) {
+        transitionLevels(commandBuffer, texture.image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+                         VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        VkImageBlit blit = {};
+        blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1};
+        blit.srcOffsets[1] = {static_cast<int32_t>(std::max(texture.extent.width >> (level - 1), 1u)),
+                              static_cast<int32_t>(std::max(texture.extent.height >> (level - 1), 1u)), 1};
+        blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+        blit.dstOffsets[1] = {static_cast<int32_t>(std::max(texture.extent.width >> level, 1u)),
+                              static_cast<int32_t>(std::max(texture.extent.height >> level, 1u)), 1};
+
+        vkCmdBlitImage(commandBuffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture.image,
+                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        transitionLevels(commandBuffer, texture.image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT,
+                         VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    }
+
+    transitionLevels(commandBuffer, texture.image, texture.levelCount - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+                     VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+}
+
+void VulkanTextureManager::createImage(StreamedTexture &texture, bool generateMips) {
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = texture.format;
+    imageInfo.extent = {texture.extent.width, texture.extent.height, 1};
+    imageInfo.mipLevels = texture.levelCount;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                      (generateMips ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0);
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VK_CHECK_RESULT(vkCreateImage(device.logicalDevice, &imageInfo, nullptr, &texture.image))
+}
+
+void VulkanTextureManager::createView(StreamedTexture &texture) {
+    if (texture.view != VK_NULL_HANDLE) {
+        retiredViews.push_back({texture.view, updateCount});
+    }
+
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = texture.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = texture.format;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = texture.residentLevel;
+    viewInfo.subresourceRange.levelCount = texture.levelCount - texture.residentLevel;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    VK_CHECK_RESULT(vkCreateImageView(device.logicalDevice, &viewInfo, nullptr, &texture.view))
+}
@@ -0,0 +1,193 @@
+#ifndef VULKAN_TRY_VULKANTEXTUREMANAGER_H
+#define VULKAN_TRY_VULKANTEXTUREMANAGER_H
+
+#include <vulkan/vulkan.h>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "VulkanDevice.h"
+#include "../texture/Ktx2File.h"
+#include "../thread/JobSystem.h"
+
+typedef uint32_t TextureHandle;
+
+struct StreamedTexture {
+    VkImage image;
+    VkDeviceMemory memory;
+
+    // Covers residentLevel and every smaller mip, replaced whenever a larger level lands, so descriptors holding
+    // it have to be rewritten when residentLevel changes.
+    VkImageView view;
+
+    VkFormat format;
+    VkExtent2D extent;
+    uint32_t levelCount;
+
+    // Largest mip that can be sampled, it only ever goes down.
+    uint32_t residentLevel;
+};
+
+/*
+ * Streams KTX2 textures in without blocking the render thread. Of the variants
+ *
+ *   <base>.bc.ktx2, <base>.astc.ktx2, <base>.etc2.ktx2, <base>.ktx2
+ *
+ * the first one that exists and whose format the device can sample is loaded, so one asset can ship in every
+ * block compression family and each GPU takes its own. Files are mapped and validated on job system workers, the
+ * render thread then copies at most uploadBudget bytes per frame, always the smallest level still missing across
+ * all textures. A texture is usable once its smallest mip has landed and sharpens as larger ones follow.
+ *
+ * Uncompressed sources with a single level get the rest of their mip chain blitted on the GPU. Textures that would
+ * push device memory over the soft budget of the memory tracker are streamed without their largest mips.
+ */
+class VulkanTextureManager {
+public:
+    // Uploads in flight at once, each one owns uploadBudget bytes of staging memory.
+    static const uint32_t STAGING_SLOTS = 2;
+
+    VulkanTextureManager(VulkanDevice &device, vtr::JobSystem &jobSystem, VkDeviceSize uploadBudget);
+
+    VulkanTextureManager(const VulkanTextureManager &) = delete;
+
+    VulkanTextureManager &operator=(const VulkanTextureManager &) = delete;
+
+    ~VulkanTextureManager();
+
+    // True when any variant of basePath exists, requestTexture() fails otherwise.
+    static bool hasVariant(const std::string &basePath);
+
+    TextureHandle requestTexture(const std::string &basePath);
+
+    // Call once per frame after waiting for the frame fence, retires finished uploads and enqueues the next one for
+    // the frame.
+    void update();
+
+    // nullptr until the smallest mip is resident, failed loads stay nullptr. The texture stays where it is for the
+    // lifetime of the manager, later requests included, update() only raises its resident level.
+    const StreamedTexture *getTexture(TextureHandle handle) const;
+
+    inline VkDeviceSize getPendingBytes() const {
+        return pendingBytes;
+    }
+
+private:
+    enum class TextureState {
+        Loading, Uploading, Resident, Failed
+    };
+
+    enum class FormatFamily {
+        Uncompressed, BC, ASTC, ETC2
+    };
+
+    struct FormatInfo {
+        VkFormat format;
+        FormatFamily family;
+        uint32_t blockWidth;
+        uint32_t blockHeight;
+        uint32_t blockBytes;
+    };
+
+    struct TextureRecord {
+        std::string path;
+        TextureState state;
+        StreamedTexture texture;
+        std::chrono::steady_clock::time_point requestTime;
+    };
+
+    struct LoadedTexture {
+        TextureHandle handle;
+        std::string path;
+        std::unique_ptr<vtr::Ktx2File> file;
+        const FormatInfo *formatInfo;
+    };
+
+    struct PendingTexture {
+        TextureHandle handle;
+        std::unique_ptr<vtr::Ktx2File> file;
+        const FormatInfo *formatInfo;
+        // Counts down to 0, rows are block rows of that level copied so far.
+        uint32_t nextLevel;
+        // Largest levels of the file left out to stay under the memory soft budget.
+        uint32_t skippedLevels;
+        uint32_t rowsCopied;
+        bool generateMips;
+    };
+
+    struct LandedLevel {
+        TextureHandle handle;
+        uint32_t level;
+    };
+
+    struct StagingSlot {
+        VkBuffer buffer;
+        VkDeviceMemory memory;
+        uint8_t *mapping;
+        VkCommandBuffer commandBuffer;
+        VkFence fence;
+        bool submitted;
+        std::vector<LandedLevel> landing;
+    };
+
+    struct RetiredView {
+        VkImageView view;
+        uint64_t retiredAt;
+    };
+
+    static const FormatInfo formatTable[];
+
+    VulkanDevice &device;
+    vtr::JobSystem &jobSystem;
+    VkDeviceSize uploadBudget;
+
+    // Parallel to formatTable, 0 for formats the device cannot sample. Read by loader jobs, written only here.
+    std::vector<VkFormatFeatureFlags> formatFeatures;
+
+    VkCommandPool commandPool;
+    StagingSlot slots[STAGING_SLOTS];
+
+    // A deque, so requests never move the records getTexture() hands out.
+    std::deque<TextureRecord> textures;
+
+    // Written by job system workers, drained by update().
+    std::mutex loadedMutex;
+    std::vector<LoadedTexture> loaded;
+    vtr::JobCounter loadCounter;
+
+    std::vector<PendingTexture> pendingTextures;
+    VkDeviceSize pendingBytes = 0;
+
+    // Views replaced by a larger resident level, destroyed once no frame in flight can still use them.
+    std::deque<RetiredView> retiredViews;
+    uint64_t updateCount = 0;
+
+    const FormatInfo *findFormat(VkFormat format) const;
+
+    static VkDeviceSize levelSize(const FormatInfo &info, VkExtent2D extent, uint32_t level);
+
+    void loadTexture(TextureHandle handle, const std::string &basePath);
+
+    void retireUploads();
+
+    void beginUploads();
+
+    size_t nextPending() const;
+
+    void submitUpload(StagingSlot &slot);
+
+    static void transitionLevels(VkCommandBuffer commandBuffer, VkImage image, uint32_t baseLevel,
+                                 uint32_t levelCount, VkImageLayout oldLayout, VkImageLayout newLayout,
+                                 VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStages,
+                                 VkPipelineStageFlags dstStages);
+
+    static void generateMipChain(VkCommandBuffer commandBuffer, const StreamedTexture &texture);
+
+    void createImage(StreamedTexture &texture, bool generateMips);
+
+    void createView(StreamedTexture &texture);
+};
+
+
+#endif //VULKAN_TRY_VULKANTEXTUREMANAGER_H
@@ -0,0 +1,21 @@
+#ifndef VULKAN_TRY_WINDOWEVENT_H
+#define VULKAN_TRY_WINDOWEVENT_H
+
+#include <cstdint>
+
+// Input only. Resizes and close requests are never dropped, they are handed over outside of the event queue.
+enum class WindowEventType : uint8_t {
+    Key
+};
+
+struct WindowEvent {
+    WindowEventType type;
+
+    // Key
+    int key;
+    int scancode;
+    int action;
+    int mods;
+};
+
+#endif //VULKAN_TRY_WINDOWEVENT_H
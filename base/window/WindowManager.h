@@ -7,12 +7,16 @@
 
 class WindowManager {
 public:
+    virtual ~WindowManager() = default;
+
     virtual std::vector<const char *> getRequiredInstanceExtensions() = 0;
 
     virtual VkResult createSurface(VkInstance instance, VkSurfaceKHR *surfaceKhr) = 0;
 
     virtual void setResizeCallback(void *application, void *callback) = 0;
 
+    virtual void setKeyCallback(void *callback) = 0;
+
     virtual void pollEvents() = 0;
 
     virtual bool shouldClose() = 0;
@@ -20,6 +24,9 @@ public:
     virtual VkExtent2D getWindowExtent() = 0;
 
     virtual void waitEvents() = 0;
+
+    // Wakes a thread blocked in waitEvents(), may be called from any thread.
+    virtual void postEmptyEvent() = 0;
 };
 
 
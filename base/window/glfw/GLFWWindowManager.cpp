@@ -19,6 +19,10 @@ void GLFWWindowManager::setResizeCallback(void *application, void *callback) {
     glfwSetFramebufferSizeCallback(window, (GLFWframebuffersizefun) callback);
 }
 
+void GLFWWindowManager::setKeyCallback(void *callback) {
+    glfwSetKeyCallback(window, (GLFWkeyfun) callback);
+}
+
 std::vector<const char *> GLFWWindowManager::getRequiredInstanceExtensions() {
     uint32_t glfwExtensionCount = 0;
     const char **glfwRequiredInstanceExtensions;
@@ -46,3 +50,7 @@ VkResult GLFWWindowManager::createSurface(VkInstance instance, VkSurfaceKHR *sur
 void GLFWWindowManager::waitEvents() {
     glfwWaitEvents();
 }
+
+void GLFWWindowManager::postEmptyEvent() {
+    glfwPostEmptyEvent();
+}
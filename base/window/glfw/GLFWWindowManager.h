@@ -31,12 +31,16 @@ public:
 
     void setResizeCallback(void *application, void *callback) override;
 
+    void setKeyCallback(void *callback) override;
+
     std::vector<const char *> getRequiredInstanceExtensions() override;
 
     VkExtent2D getWindowExtent() override;
 
     void waitEvents() override;
 
+    void postEmptyEvent() override;
+
 private:
     int width;
     int height;
@@ -0,0 +1,23 @@
+#include "HeadlessWindowManager.h"
+
+HeadlessWindowManager::HeadlessWindowManager(uint32_t width, uint32_t height) {
+    extent = {width, height};
+}
+
+std::vector<const char *> HeadlessWindowManager::getRequiredInstanceExtensions() {
+    return {VK_KHR_SURFACE_EXTENSION_NAME, VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME};
+}
+
+VkResult HeadlessWindowManager::createSurface(VkInstance instance, VkSurfaceKHR *surfaceKhr) {
+    auto createHeadlessSurface = reinterpret_cast<PFN_vkCreateHeadlessSurfaceEXT>(
+            vkGetInstanceProcAddr(instance, "vkCreateHeadlessSurfaceEXT"));
+
+    if (createHeadlessSurface == nullptr) {
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+    }
+
+    VkHeadlessSurfaceCreateInfoEXT createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT;
+
+    return createHeadlessSurface(instance, &createInfo, nullptr, surfaceKhr);
+}
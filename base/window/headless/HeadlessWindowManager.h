@@ -0,0 +1,47 @@
+#ifndef VULKAN_TRY_HEADLESSWINDOWMANAGER_H
+#define VULKAN_TRY_HEADLESSWINDOWMANAGER_H
+
+#include <vector>
+#include "../WindowManager.h"
+
+/*
+ * No window at all, the surface comes from VK_EXT_headless_surface. Presenting to it never waits for a display,
+ * so everything else, swapchain included, runs exactly as it does with a window. Never resized and never closed.
+ */
+class HeadlessWindowManager : public WindowManager {
+public:
+    HeadlessWindowManager(uint32_t width, uint32_t height);
+
+    std::vector<const char *> getRequiredInstanceExtensions() override;
+
+    VkResult createSurface(VkInstance instance, VkSurfaceKHR *surfaceKhr) override;
+
+    inline void setResizeCallback(void *application, void *callback) override {
+    }
+
+    inline void setKeyCallback(void *callback) override {
+    }
+
+    inline void pollEvents() override {
+    }
+
+    inline bool shouldClose() override {
+        return false;
+    }
+
+    inline VkExtent2D getWindowExtent() override {
+        return extent;
+    }
+
+    inline void waitEvents() override {
+    }
+
+    inline void postEmptyEvent() override {
+    }
+
+private:
+    VkExtent2D extent;
+};
+
+
+#endif //VULKAN_TRY_HEADLESSWINDOWMANAGER_H
@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "../base/scene/FrustumCuller.h"
+
+using namespace vtr;
+
+/*
+ * Culls 100k to 1M random spheres and boxes against a perspective camera and compares the SIMD culler with a plain
+ * per-object loop. Both must agree on the visible set.
+ */
+
+namespace {
+    const uint32_t ITERATIONS = 20;
+
+    float random(float range) {
+        return (static_cast<float>(rand()) / RAND_MAX * 2.0f - 1.0f) * range;
+    }
+
+    uint32_t referenceSpheres(const Frustum &frustum, const SphereBounds &bounds, std::vector<uint32_t> &visible) {
+        visible.clear();
+
+        for (uint32_t i = 0; i < bounds.size(); i++) {
+            bool inside = true;
+            for (const auto &plane: frustum.planes) {
+                float distance = plane.x * bounds.centerX[i] + plane.y * bounds.centerY[i] +
+                                 plane.z * bounds.centerZ[i] + plane.w;
+                if (distance <= -bounds.radius[i]) {
+                    inside = false;
+                    break;
+                }
+            }
+
+            if (inside) {
+                visible.push_back(i);
+            }
+        }
+
+        return static_cast<uint32_t>(visible.size());
+    }
+
+    template<typename F>
+    double measure(F &&function) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < ITERATIONS; i++) {
+            function();
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        return std::chrono::duration<double, std::milli>(end - start).count() / ITERATIONS;
+    }
+}
+
+int main() {
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+                                 glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum = Frustum::fromViewProjection(projection * view);
+
+    printf("%-10s %12s %12s %12s %10s %10s\n", "objects", "reference", "spheres", "aabbs", "speedup", "visible");
+
+    for (uint32_t count: {100000u, 250000u, 500000u, 1000000u}) {
+        srand(count);
+
+        SphereBounds spheres;
+        AabbBounds boxes;
+        spheres.resize(count);
+        boxes.resize(count);
+
+        for (uint32_t i = 0; i < count; i++) {
+            spheres.centerX[i] = boxes.centerX[i] = random(400.0f);
+            spheres.centerY[i] = boxes.centerY[i] = random(400.0f);
+            spheres.centerZ[i] = boxes.centerZ[i] = random(400.0f);
+            boxes.extentX[i] = boxes.extentY[i] = boxes.extentZ[i] = std::fabs(random(2.0f));
+            spheres.radius[i] = boxes.extentX[i] * 1.7320508f;
+        }
+
+        std::vector<uint32_t> expected, visible, visibleBoxes;
+        expected.reserve(count);
+        visible.reserve(count + 8);
+        visibleBoxes.reserve(count + 8);
+
+        uint32_t visibleCount = 0;
+
+        double referenceTime = measure([&]() { referenceSpheres(frustum, spheres, expected); });
+        double sphereTime = measure([&]() { visibleCount = FrustumCuller::cullSpheres(frustum, spheres, visible); });
+        double boxTime = measure([&]() { FrustumCuller::cullAabbs(frustum, boxes, visibleBoxes); });
+
+        if (visibleCount != expected.size() || !std::equal(expected.begin(), expected.end(), visible.begin())) {
+            printf("mismatch between SIMD and reference sphere culling at %u objects\n", count);
+            return 1;
+        }
+
+        printf("%-10u %10.3fms %10.3fms %10.3fms %9.2fx %10zu\n", count, referenceTime, sphereTime, boxTime,
+               referenceTime / sphereTime, expected.size());
+    }
+
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "../base/scene/DrawList.h"
+
+using namespace vtr;
+
+/*
+ * Sorts 10k to 1M draws with keys spread like a frame's, a few pipelines, some hundred materials and meshes and
+ * random depth, and compares the radix sort with std::stable_sort. Both must produce the same order.
+ */
+
+namespace {
+    const uint32_t ITERATIONS = 20;
+
+    uint64_t randomKey() {
+        return DrawKey::pack(0, rand() % 8, rand() % 300, rand() % 500,
+                             DrawKey::quantizeDepth(static_cast<float>(rand()) / RAND_MAX));
+    }
+
+    template<typename F>
+    double measure(F &&function) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < ITERATIONS; i++) {
+            function();
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        return std::chrono::duration<double, std::milli>(end - start).count() / ITERATIONS;
+    }
+}
+
+int main() {
+    printf("%-10s %12s %12s %10s\n", "draws", "stable_sort", "radix", "speedup");
+
+    for (uint32_t count: {10000u, 100000u, 250000u, 1000000u}) {
+        srand(count);
+
+        std::vector<uint64_t> keys(count);
+        for (auto &key: keys) {
+            key = randomKey();
+        }
+
+        std::vector<DrawPacket> expected;
+        double referenceMs = measure([&]() {
+            expected.clear();
+            for (uint32_t i = 0; i < count; i++) {
+                expected.push_back({keys[i], i});
+            }
+
+            std::stable_sort(expected.begin(), expected.end(), [](const DrawPacket &a, const DrawPacket &b) {
+                return a.key < b.key;
+            });
+        });
+
+        DrawList drawList;
+        double radixMs = measure([&]() {
+            drawList.clear();
+            for (uint32_t i = 0; i < count; i++) {
+                drawList.add(keys[i], i);
+            }
+
+            drawList.sort();
+        });
+
+        for (uint32_t i = 0; i < count; i++) {
+            if (drawList[i].key != expected[i].key || drawList[i].index != expected[i].index) {
+                fprintf(stderr, "radix sort disagrees at %u of %u draws\n", i, count);
+                return 1;
+            }
+        }
+
+        printf("%-10u %10.3f ms %10.3f ms %9.2fx\n", count, referenceMs, radixMs, referenceMs / radixMs);
+    }
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "../base/thread/JobSystem.h"
+
+using namespace vtr;
+
+/*
+ * Synthetic frame: an animation pass over all objects, a culling pass after it in batches small enough to need more
+ * jobs than one thread's pool holds, and a batch of command recording jobs depending on culling. Reports frame time
+ * and speedup from one thread up to all hardware threads.
+ */
+
+namespace {
+    const uint32_t OBJECT_COUNT = 1 << 20;
+    const uint32_t BATCH_SIZE = 4096;
+    // 16384 batches, four times JobSystem::JOB_POOL_SIZE.
+    const uint32_t CULL_BATCH_SIZE = 64;
+    const uint32_t RECORDING_JOBS = 64;
+    const uint32_t RECORDING_WORK = 20000;
+    const uint32_t WARMUP_FRAMES = 10;
+    const uint32_t MEASURED_FRAMES = 100;
+
+    struct Scene {
+        std::vector<float> positions;
+        std::vector<float> velocities;
+        std::vector<uint8_t> visible;
+        std::vector<float> recorded;
+    };
+
+    void animate(Scene &scene, uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            scene.positions[i] += scene.velocities[i] * (1.0f / 60.0f);
+            scene.velocities[i] = std::sin(scene.positions[i]);
+        }
+    }
+
+    void cull(Scene &scene, uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            float d = scene.positions[i] * 0.7f - 0.25f;
+            scene.visible[i] = d * d < 0.5f;
+        }
+    }
+
+    void record(Scene &scene, uint32_t index) {
+        float value = static_cast<float>(index);
+        for (uint32_t i = 0; i < RECORDING_WORK; i++) {
+            value = std::sqrt(value * value + 1.0f) * 0.999f;
+        }
+        scene.recorded[index] = value;
+    }
+
+    void frame(JobSystem &jobs, Scene &scene) {
+        // The calling thread plays the main thread and helps until the frame is done.
+        jobs.parallelFor(OBJECT_COUNT, BATCH_SIZE, [&scene](uint32_t begin, uint32_t end) {
+            animate(scene, begin, end);
+        });
+
+        JobCounter culling, recording;
+
+        jobs.run([&jobs, &scene]() {
+            jobs.parallelFor(OBJECT_COUNT, CULL_BATCH_SIZE, [&scene](uint32_t begin, uint32_t end) {
+                cull(scene, begin, end);
+            });
+        }, &culling);
+
+        for (uint32_t i = 0; i < RECORDING_JOBS; i++) {
+            jobs.runAfter(&culling, [&scene, i]() { record(scene, i); }, &recording);
+        }
+
+        jobs.wait(&recording);
+        jobs.wait(&culling);
+    }
+}
+
+int main(int argc, char **argv) {
+    uint32_t maxThreads = argc > 1 ? static_cast<uint32_t>(atoi(argv[1])) : std::thread::hardware_concurrency();
+    maxThreads = maxThreads == 0 ? 1 : maxThreads;
+
+    Scene scene;
+    scene.positions.assign(OBJECT_COUNT, 0.5f);
+    scene.velocities.assign(OBJECT_COUNT, 1.0f);
+    scene.visible.assign(OBJECT_COUNT, 0);
+    scene.recorded.assign(RECORDING_JOBS, 0.0f);
+
+    printf("%-8s %12s %10s\n", "threads", "frame (ms)", "speedup");
+
+    double baseline = 0.0;
+    for (uint32_t threads = 1; threads <= maxThreads; threads++) {
+        JobSystem jobs(threads - 1);
+
+        for (uint32_t i = 0; i < WARMUP_FRAMES; i++) {
+            frame(jobs, scene);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < MEASURED_FRAMES; i++) {
+            frame(jobs, scene);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        double frameTime = std::chrono::duration<double, std::milli>(end - start).count() / MEASURED_FRAMES;
+        if (threads == 1) {
+            baseline = frameTime;
+        }
+
+        printf("%-8u %12.3f %9.2fx\n", threads, frameTime, baseline / frameTime);
+    }
+
+    return 0;
+}
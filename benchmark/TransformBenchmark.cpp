@@ -0,0 +1,59 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "../base/scene/TransformStore.h"
+
+using namespace vtr;
+
+/*
+ * Updates a hierarchy of one million transforms, 1024 roots with random subtrees below them. Every root moves each
+ * frame, so the whole hierarchy is recomputed. Target is below 2 ms per frame on one core.
+ */
+
+namespace {
+    const uint32_t TRANSFORM_COUNT = 1 << 20;
+    const uint32_t ROOT_COUNT = 1024;
+    const uint32_t FRAMES = 50;
+}
+
+int main() {
+    TransformStore transforms;
+    transforms.reserve(TRANSFORM_COUNT);
+
+    srand(42);
+
+    uint32_t perRoot = TRANSFORM_COUNT / ROOT_COUNT;
+    for (uint32_t root = 0; root < ROOT_COUNT; root++) {
+        uint32_t rootIndex = transforms.add(TransformStore::NO_PARENT, glm::vec3(root, 0.0f, 0.0f),
+                                            glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+
+        for (uint32_t i = 1; i < perRoot; i++) {
+            uint32_t parent = rootIndex + rand() % i;
+            transforms.add(parent, glm::vec3(0.0f, 1.0f, 0.0f), glm::quat(0.9238795f, 0.0f, 0.3826834f, 0.0f),
+                           glm::vec3(0.99f));
+        }
+    }
+
+    transforms.update();
+
+    double total = 0.0;
+    for (uint32_t frame = 0; frame < FRAMES; frame++) {
+        for (uint32_t root = 0; root < ROOT_COUNT; root++) {
+            transforms.setPosition(root * perRoot, glm::vec3(root, frame * 0.01f, 0.0f));
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        transforms.update();
+        auto end = std::chrono::steady_clock::now();
+
+        total += std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    uint32_t begin, end;
+    transforms.getUpdatedRange(begin, end);
+
+    printf("%u transforms, %u updated per frame, %.3f ms per update\n", transforms.size(), end - begin,
+           total / FRAMES);
+
+    return 0;
+}
@@ -0,0 +1,38 @@
+# Writes a SPIR-V binary as a constexpr word array to a header.
+# Usage: cmake -DINPUT=<file.spv> -DOUTPUT=<file.h> -DSYMBOL=<name> -P EmbedSpirv.cmake
+
+file(READ "${INPUT}" hex HEX)
+string(LENGTH "${hex}" hexLength)
+
+math(EXPR remainder "${hexLength} % 8")
+if (hexLength EQUAL 0 OR NOT remainder EQUAL 0)
+    message(FATAL_ERROR "${INPUT} is not a SPIR-V binary")
+endif ()
+
+# SPIR-V is a stream of little endian words, eight words to a line.
+string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1u, " words "${hex}")
+# CMake regular expressions have no repetition counts, hence the spelled out words.
+set(word "0x........u, ")
+string(REGEX REPLACE "(${word}${word}${word}${word}${word}${word}${word}${word})" "\\1\n            " words "${words}")
+string(REGEX REPLACE " +\n" "\n" words "${words}")
+string(STRIP "${words}" words)
+
+get_filename_component(inputName "${INPUT}" NAME)
+string(TOUPPER "${SYMBOL}" guard)
+
+file(WRITE "${OUTPUT}.tmp"
+        "// Generated from ${inputName} by cmake/EmbedSpirv.cmake, do not edit.\n"
+        "#ifndef VULKAN_TRY_SPIRV_${guard}_H\n"
+        "#define VULKAN_TRY_SPIRV_${guard}_H\n\n"
+        "namespace vtr {\n"
+        "    namespace spirv {\n"
+        "        alignas(16) constexpr uint32_t ${SYMBOL}[] = {\n"
+        "            ${words}\n"
+        "        };\n"
+        "    }\n"
+        "}\n\n"
+        "#endif //VULKAN_TRY_SPIRV_${guard}_H\n")
+
+# Leaves the header untouched when the SPIR-V did not change, so nothing including it rebuilds.
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different "${OUTPUT}.tmp" "${OUTPUT}")
+file(REMOVE "${OUTPUT}.tmp")
@@ -1,10 +1,99 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <stdexcept>
 #include "Application.h"
+#include "base/log/Profiler.h"
 
-int main() {
-    Application app;
+static void printUsage(const char *program) {
+    std::cerr << "usage: " << program << " [--batch frames] [--timestep seconds] [--output path.y4m|path.rgba]"
+              << " [--size WIDTHxHEIGHT] [--views count] [--trace path.json]" << std::endl;
+}
+
+// The whole argument as a count. std::stoul alone takes "-1" and "12abc", and throws on the rest.
+static bool parseCount(const char *text, uint32_t &count) {
+    try {
+        size_t end;
+        unsigned long value = std::stoul(text, &end);
+
+        if (text[0] == '-' || text[end] != '\0' || value > UINT32_MAX) {
+            return false;
+        }
+
+        count = static_cast<uint32_t>(value);
+        return true;
+    } catch (const std::logic_error &) {
+        return false;
+    }
+}
+
+static bool parseSeconds(const char *text, double &seconds) {
+    try {
+        size_t end;
+        double value = std::stod(text, &end);
+
+        if (text[end] != '\0' || !std::isfinite(value)) {
+            return false;
+        }
+
+        seconds = value;
+        return true;
+    } catch (const std::logic_error &) {
+        return false;
+    }
+}
+
+int main(int argc, char **argv) {
+    BatchOptions batch;
+    std::string tracePath;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+
+        if (strcmp(argv[i], "--batch") == 0 && hasValue && parseCount(argv[++i], batch.frameCount)) {
+            continue;
+        } else if (strcmp(argv[i], "--timestep") == 0 && hasValue && parseSeconds(argv[++i], batch.timestep)) {
+            continue;
+        } else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+            batch.outputPath = argv[++i];
+        } else if (strcmp(argv[i], "--size") == 0 && hasValue &&
+                   sscanf(argv[++i], "%ux%u", &batch.width, &batch.height) == 2) {
+            continue;
+        } else if (strcmp(argv[i], "--views") == 0 && hasValue && parseCount(argv[++i], batch.viewCount)) {
+            continue;
+        } else if (strcmp(argv[i], "--trace") == 0 && hasValue) {
+            tracePath = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Several views are headless only, interactively there is a single window.
+    if (!(batch.timestep > 0.0) || batch.width == 0 || batch.height == 0 || batch.viewCount == 0 ||
+        (batch.viewCount > 1 && batch.frameCount == 0)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Enabled before the application exists, so startup is in the trace and the GPU zones are set up.
+    if (!tracePath.empty()) {
+#ifndef VTR_PROFILER
+        std::cerr << "built without VTR_PROFILER, the trace only has startup stages and GPU zones" << std::endl;
+#endif
+        vtr::Profiler::instance().setThreadName("main");
+        vtr::Profiler::instance().setEnabled(true);
+    }
+
+    Application app(batch);
 
     app.mainLoop();
 
+    if (!tracePath.empty() && !vtr::Profiler::instance().writeTrace(tracePath)) {
+        return 1;
+    }
+
     return 0;
 }
@@ -0,0 +1,319 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include "../../base/mesh/MeshWriter.h"
+#include "../../base/mesh/MeshQuantization.h"
+#include "../../base/mesh/MeshSimplifier.h"
+
+using namespace vtr;
+
+/*
+ * Offline converter from Wavefront OBJ to the engine mesh container. Vertices are quantized to 16 bytes unless
+ * --float (32 bytes) or --positions (positions only, 12 bytes) is given. Up to --lods levels of detail are
+ * generated by edge collapse, each with about half the triangles of the previous one, --lods 1 writes LOD 0 only.
+ *
+ *   MeshConverter [--float | --positions] [--lods count] input.obj output.mesh
+ */
+
+namespace {
+    struct Corner {
+        uint32_t position;
+        uint32_t uv;
+        uint32_t normal;
+
+        bool operator==(const Corner &other) const {
+            return position == other.position && uv == other.uv && normal == other.normal;
+        }
+    };
+
+    struct CornerHash {
+        size_t operator()(const Corner &corner) const {
+            return (static_cast<size_t>(corner.position) * 73856093u) ^ (static_cast<size_t>(corner.uv) * 19349663u) ^
+                   (static_cast<size_t>(corner.normal) * 83492791u);
+        }
+    };
+
+    const uint32_t MISSING = UINT32_MAX;
+
+    // OBJ indices are 1 based, negative ones count back from the last element.
+    uint32_t resolveIndex(const std::string &token, uint32_t count) {
+        if (token.empty()) {
+            return MISSING;
+        }
+
+        long index = strtol(token.c_str(), nullptr, 10);
+
+        if (index < 0) {
+            index += static_cast<long>(count);
+        } else {
+            index -= 1;
+        }
+
+        if (index < 0 || index >= static_cast<long>(count)) {
+            throw std::runtime_error("face references missing element " + token);
+        }
+
+        return static_cast<uint32_t>(index);
+    }
+
+    // Splits v, v/vt, v//vn and v/vt/vn.
+    Corner parseCorner(const std::string &token, uint32_t positionCount, uint32_t uvCount, uint32_t normalCount) {
+        size_t first = token.find('/');
+        size_t second = first == std::string::npos ? std::string::npos : token.find('/', first + 1);
+
+        Corner corner = {};
+        corner.position = resolveIndex(token.substr(0, first), positionCount);
+        corner.uv = first == std::string::npos ? MISSING :
+                    resolveIndex(token.substr(first + 1, second - first - 1), uvCount);
+        corner.normal = second == std::string::npos ? MISSING : resolveIndex(token.substr(second + 1), normalCount);
+
+        if (corner.position == MISSING) {
+            throw std::runtime_error("face corner without position " + token);
+        }
+
+        return corner;
+    }
+
+    // Area weighted smooth normals, used when the file has none.
+    void generateNormals(MeshData &mesh) {
+        mesh.normals.assign(mesh.positions.size(), 0.0f);
+
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+            const float *a = &mesh.positions[mesh.indices[i] * 3];
+            const float *b = &mesh.positions[mesh.indices[i + 1] * 3];
+            const float *c = &mesh.positions[mesh.indices[i + 2] * 3];
+
+            float ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+            float ac[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+            float cross[3] = {ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2],
+                              ab[0] * ac[1] - ab[1] * ac[0]};
+
+            for (size_t corner = 0; corner < 3; corner++) {
+                for (int axis = 0; axis < 3; axis++) {
+                    mesh.normals[mesh.indices[i + corner] * 3 + axis] += cross[axis];
+                }
+            }
+        }
+
+        for (size_t i = 0; i < mesh.normals.size(); i += 3) {
+            float *normal = &mesh.normals[i];
+            float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+            if (length > 0.0f) {
+                normal[0] /= length;
+                normal[1] /= length;
+                normal[2] /= length;
+            } else {
+                normal[2] = 1.0f;
+            }
+        }
+    }
+
+    MeshData loadObj(const std::string &path) {
+        std::ifstream file(path);
+
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open " + path);
+        }
+
+        std::vector<float> positions, uvs, normals;
+        std::vector<Corner> corners;
+        std::vector<uint32_t> cornerIndices;
+        std::unordered_map<Corner, uint32_t, CornerHash> cornerLookup;
+
+        std::string line;
+
+        while (std::getline(file, line)) {
+            std::istringstream stream(line);
+            std::string keyword;
+            stream >> keyword;
+
+            if (keyword == "v" || keyword == "vn") {
+                float x = 0.0f, y = 0.0f, z = 0.0f;
+                stream >> x >> y >> z;
+
+                std::vector<float> &target = keyword == "v" ? positions : normals;
+                target.push_back(x);
+                target.push_back(y);
+                target.push_back(z);
+            } else if (keyword == "vt") {
+                float u = 0.0f, v = 0.0f;
+                stream >> u >> v;
+
+                uvs.push_back(u);
+                uvs.push_back(v);
+            } else if (keyword == "f") {
+                std::vector<uint32_t> polygon;
+                std::string token;
+
+                while (stream >> token) {
+                    Corner corner = parseCorner(token, static_cast<uint32_t>(positions.size() / 3),
+                                                static_cast<uint32_t>(uvs.size() / 2),
+                                                static_cast<uint32_t>(normals.size() / 3));
+
+                    auto found = cornerLookup.find(corner);
+                    if (found == cornerLookup.end()) {
+                        found = cornerLookup.emplace(corner, static_cast<uint32_t>(corners.size())).first;
+                        corners.push_back(corner);
+                    }
+
+                    polygon.push_back(found->second);
+                }
+
+                for (size_t i = 2; i < polygon.size(); i++) {
+                    cornerIndices.push_back(polygon[0]);
+                    cornerIndices.push_back(polygon[i - 1]);
+                    cornerIndices.push_back(polygon[i]);
+                }
+            }
+        }
+
+        bool hasNormals = !corners.empty();
+        for (const auto &corner: corners) {
+            hasNormals &= corner.normal != MISSING;
+        }
+
+        MeshData mesh;
+        mesh.indices = cornerIndices;
+
+        if (hasNormals || !uvs.empty()) {
+            // Every distinct v/vt/vn combination becomes a vertex.
+            mesh.vertexCount = static_cast<uint32_t>(corners.size());
+
+            for (const auto &corner: corners) {
+                mesh.positions.insert(mesh.positions.end(), &positions[corner.position * 3],
+                                      &positions[corner.position * 3] + 3);
+
+                if (corner.uv != MISSING) {
+                    mesh.uvs.insert(mesh.uvs.end(), &uvs[corner.uv * 2], &uvs[corner.uv * 2] + 2);
+                } else {
+                    mesh.uvs.insert(mesh.uvs.end(), 2, 0.0f);
+                }
+
+                if (hasNormals) {
+                    mesh.normals.insert(mesh.normals.end(), &normals[corner.normal * 3],
+                                        &normals[corner.normal * 3] + 3);
+                }
+            }
+        } else {
+            // Positions only, keep the vertices of the file and share them between faces.
+            mesh.vertexCount = static_cast<uint32_t>(positions.size() / 3);
+            mesh.positions = positions;
+
+            for (auto &index: mesh.indices) {
+                index = corners[index].position;
+            }
+        }
+
+        if (!hasNormals) {
+            generateNormals(mesh);
+        }
+
+        return mesh;
+    }
+
+    // Largest object space position error and normal angle error introduced by quantization.
+    void reportQuantizationError(const MeshData &mesh) {
+        float min[3], max[3];
+        for (int axis = 0; axis < 3; axis++) {
+            min[axis] = max[axis] = mesh.positions.empty() ? 0.0f : mesh.positions[axis];
+        }
+        for (size_t i = 0; i < mesh.positions.size(); i++) {
+            min[i % 3] = std::min(min[i % 3], mesh.positions[i]);
+            max[i % 3] = std::max(max[i % 3], mesh.positions[i]);
+        }
+
+        float positionError = 0.0f, normalError = 0.0f, uvError = 0.0f;
+
+        for (uint32_t i = 0; i < mesh.vertexCount; i++) {
+            for (int axis = 0; axis < 3; axis++) {
+                float extent = max[axis] - min[axis];
+                float decoded = min[axis] + quantizeUnorm16(mesh.positions[i * 3 + axis], min[axis], extent) /
+                                            65535.0f * extent;
+                positionError = std::max(positionError, std::fabs(decoded - mesh.positions[i * 3 + axis]));
+            }
+
+            int16_t encoded[2];
+            float decoded[3];
+            encodeOctahedral(&mesh.normals[i * 3], encoded);
+            decodeOctahedral(encoded, decoded);
+
+            float dot = decoded[0] * mesh.normals[i * 3] + decoded[1] * mesh.normals[i * 3 + 1] +
+                        decoded[2] * mesh.normals[i * 3 + 2];
+            normalError = std::max(normalError, std::acos(std::min(1.0f, std::max(-1.0f, dot))));
+
+            for (size_t component = 0; component < 2 && !mesh.uvs.empty(); component++) {
+                float uv = mesh.uvs[i * 2 + component];
+                uvError = std::max(uvError, std::fabs(halfToFloat(floatToHalf(uv)) - uv));
+            }
+        }
+
+        printf("max error: position %g, normal %.4f degrees, uv %g\n", positionError, normalError * 57.29578f,
+               uvError);
+    }
+
+    bool endsWith(const std::string &value, const std::string &suffix) {
+        return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+}
+
+int main(int argc, char **argv) {
+    uint32_t vertexFormat = MESH_VERTEX_QUANTIZED;
+    uint32_t lodCount = MESH_MAX_LODS;
+    int argument = 1;
+
+    for (; argument < argc - 2; argument++) {
+        if (strcmp(argv[argument], "--float") == 0) {
+            vertexFormat = MESH_VERTEX_STANDARD_F32;
+        } else if (strcmp(argv[argument], "--positions") == 0) {
+            vertexFormat = MESH_VERTEX_POSITION_F32;
+        } else if (strcmp(argv[argument], "--lods") == 0 && argument + 1 < argc - 2) {
+            lodCount = static_cast<uint32_t>(strtoul(argv[++argument], nullptr, 10));
+        } else {
+            break;
+        }
+    }
+
+    if (argc - argument != 2 || lodCount < 1 || lodCount > MESH_MAX_LODS) {
+        fprintf(stderr, "usage: %s [--float | --positions] [--lods 1-%u] input.obj output.mesh\n", argv[0],
+                MESH_MAX_LODS);
+        return 1;
+    }
+
+    std::string input = argv[argument];
+    std::string output = argv[argument + 1];
+
+    try {
+        if (!endsWith(input, ".obj")) {
+            throw std::runtime_error("unsupported input format, expected .obj");
+        }
+
+        MeshData mesh = loadObj(input);
+        mesh.vertexFormat = vertexFormat;
+        MeshSimplifier::buildLodChain(mesh.positions.data(), mesh.vertexCount, mesh.indices, mesh.lods, lodCount);
+        writeMeshFile(output, mesh);
+
+        printf("%s: %u vertices, %u triangles, %u bytes per vertex\n", output.c_str(), mesh.vertexCount,
+               mesh.lods[0].indexCount / 3, meshVertexStride(vertexFormat));
+
+        for (size_t lod = 1; lod < mesh.lods.size(); lod++) {
+            printf("LOD %zu: %u triangles, error %g\n", lod, mesh.lods[lod].indexCount / 3, mesh.lods[lod].error);
+        }
+
+        if (vertexFormat == MESH_VERTEX_QUANTIZED) {
+            reportQuantizationError(mesh);
+        }
+    } catch (const std::exception &exception) {
+        fprintf(stderr, "%s\n", exception.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,2 +0,0 @@
-glslc shader.vert -o vert.spv
-glslc shader.frag -o frag.spv
\ No newline at end of file
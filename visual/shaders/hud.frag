@@ -0,0 +1,13 @@
+#version 450
+
+// The atlas only holds coverage, glyphs and rectangles take their color from the vertex.
+layout(binding = 0) uniform sampler2D atlas;
+
+layout(location = 0) in vec2 inUv;
+layout(location = 1) in vec4 inColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = vec4(inColor.rgb, inColor.a * texture(atlas, inUv).r);
+}
@@ -0,0 +1,21 @@
+#version 450
+
+// Overlay quads in pixels from the top left corner, y points down like in clip space.
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec2 inUv;
+layout(location = 2) in vec4 inColor;
+
+layout(push_constant) uniform Constants {
+    // 2 / extent.
+    vec2 scale;
+} constants;
+
+layout(location = 0) out vec2 outUv;
+layout(location = 1) out vec4 outColor;
+
+void main() {
+    gl_Position = vec4(inPosition * constants.scale - 1.0, 0.0, 1.0);
+
+    outUv = inUv;
+    outColor = inColor;
+}
@@ -0,0 +1,12 @@
+#version 450
+
+// Added on top of the scene, round and fading out with age.
+layout(location = 0) in vec2 inCorner;
+layout(location = 1) in float inFade;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    float falloff = max(1.0 - dot(inCorner, inCorner), 0.0);
+    outColor = vec4(vec3(1.0, 0.55, 0.2) * falloff * inFade * 0.25, 0.0);
+}
@@ -0,0 +1,34 @@
+#version 450
+
+// Expands each particle to a quad facing the screen, six vertices per instance and no vertex input.
+struct Particle {
+    vec4 position;
+    vec4 velocity;
+};
+
+layout(std430, binding = 0) readonly buffer Particles {
+    Particle particles[];
+};
+
+layout(push_constant) uniform Constants {
+    mat4 viewProjection;
+    // Half the quad's edge, in clip space units.
+    float size;
+} constants;
+
+layout(location = 0) out vec2 outCorner;
+layout(location = 1) out float outFade;
+
+const vec2 corners[6] = vec2[](vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+                               vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0));
+
+void main() {
+    Particle particle = particles[gl_InstanceIndex];
+    vec2 corner = corners[gl_VertexIndex];
+
+    gl_Position = constants.viewProjection * vec4(particle.position.xyz, 1.0);
+    gl_Position.xy += corner * constants.size;
+
+    outCorner = corner;
+    outFade = 1.0 - clamp(particle.position.w / particle.velocity.w, 0.0, 1.0);
+}
@@ -2,7 +2,8 @@
 #extension GL_ARB_separate_shader_objects : enable
 
 layout(location = 0) in vec3 inPosition;
+layout(location = 1) in mat4 inWorld;
 
 void main() {
-    gl_Position = vec4(inPosition, 1.0);
+    gl_Position = inWorld * vec4(inPosition, 1.0);
 }
\ No newline at end of file
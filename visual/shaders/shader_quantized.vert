@@ -0,0 +1,34 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Mesh bounds, the position is unorm16 within them.
+layout(push_constant) uniform Dequantization {
+    vec4 positionOffset;
+    vec4 positionScale;
+} dequantization;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in mat4 inWorld;
+// Octahedral, snorm16.
+layout(location = 5) in vec2 inNormal;
+// Half floats, widened by the vertex fetch.
+layout(location = 6) in vec2 inUv;
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) out vec2 outUv;
+
+vec3 decodeOctahedral(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -fold : fold;
+    normal.y += normal.y >= 0.0 ? -fold : fold;
+    return normalize(normal);
+}
+
+void main() {
+    vec3 position = dequantization.positionOffset.xyz + inPosition * dequantization.positionScale.xyz;
+
+    gl_Position = inWorld * vec4(position, 1.0);
+    outNormal = mat3(inWorld) * decodeOctahedral(inNormal);
+    outUv = inUv;
+}
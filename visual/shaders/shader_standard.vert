@@ -0,0 +1,16 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in mat4 inWorld;
+layout(location = 5) in vec3 inNormal;
+layout(location = 6) in vec2 inUv;
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) out vec2 outUv;
+
+void main() {
+    gl_Position = inWorld * vec4(inPosition, 1.0);
+    outNormal = mat3(inWorld) * inNormal;
+    outUv = inUv;
+}